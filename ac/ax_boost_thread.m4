@@ -0,0 +1,111 @@
+# ===========================================================================
+#             http://autoconf-archive.cryp.to/ax_boost_thread.html
+# ===========================================================================
+#
+# SYNOPSIS
+#
+#   AX_BOOST_THREAD
+#
+# DESCRIPTION
+#
+#   Test for Thread library from the Boost C++ libraries. The macro requires
+#   a preceding call to AX_BOOST_BASE. Further documentation is available at
+#   <http://randspringer.de/boost/index.html>.
+#
+#   This macro calls:
+#
+#     AC_SUBST(BOOST_THREAD_LIB)
+#
+#   And sets:
+#
+#     HAVE_BOOST_THREAD
+#
+# LAST MODIFICATION
+#
+#   2008-04-12
+#
+# COPYLEFT
+#
+#   Copyright (c) 2008 Thomas Porschberg <thomas@randspringer.de>
+#   Copyright (c) 2008 Michael Tindal
+#
+#   Copying and distribution of this file, with or without modification, are
+#   permitted in any medium without royalty provided the copyright notice
+#   and this notice are preserved.
+
+AC_DEFUN([AX_BOOST_THREAD],
+[
+    AC_ARG_WITH([boost-thread],
+    AS_HELP_STRING([--with-boost-thread=special-lib],
+                   [specify a certain version of the Boost thread library for the linker e.g. --with-boost-thread=boost_thread-gcc-mt-d-1_33_1 ]),
+        [
+        if test "$withval" = "no"; then
+            want_boost="no"
+        elif test "$withval" = "yes"; then
+            want_boost="yes"
+            ax_boost_user_thread_lib=""
+        else
+            want_boost="yes"
+            ax_boost_user_thread_lib="$withval"
+        fi
+        ],
+        [want_boost="yes"]
+    )
+
+    if test "x$want_boost" != "xyes"; then
+        AC_MSG_ERROR(The Boost thread library is required for building MKVToolNix)
+    fi
+    AC_REQUIRE([AC_PROG_CC])
+    CPPFLAGS_SAVED="$CPPFLAGS"
+    CPPFLAGS="$CPPFLAGS $BOOST_CPPFLAGS"
+    export CPPFLAGS
+
+    LDFLAGS_SAVED="$LDFLAGS"
+    LDFLAGS="$LDFLAGS $BOOST_LDFLAGS"
+    export LDFLAGS
+
+    AC_CACHE_CHECK(whether the Boost::Thread library is available,
+                   ax_cv_boost_thread,
+    [AC_LANG_PUSH([C++])
+         AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[@%:@include <boost/thread/thread.hpp>]],
+                                            [[boost::thread_group thrds; return 0;]])],
+               ax_cv_boost_thread=yes, ax_cv_boost_thread=no)
+     AC_LANG_POP([C++])
+    ])
+    if test "x$ax_cv_boost_thread" = "xyes"; then
+        AC_DEFINE(HAVE_BOOST_THREAD,,[define if the Boost::Thread library is available])
+        BOOSTLIBDIR=`echo $BOOST_LDFLAGS | sed -e 's/@<:@^\/@:>@*//'`
+        if test "x$ax_boost_user_thread_lib" = "x"; then
+            for libextension in `ls $BOOSTLIBDIR/libboost_thread*.{so,a,dylib}* 2>/dev/null | sed 's,.*/,,' | sed -e 's;^lib\(boost_thread.*\)\.so.*$;\1;' -e 's;^lib\(boost_thread.*\)\.a*$;\1;' -e 's;^lib\(boost_thread.*\)\.dylib.*$;\1;'` ; do
+                 ax_lib=${libextension}
+                AC_CHECK_LIB($ax_lib, exit,
+                             [BOOST_THREAD_LIB="-l$ax_lib"; AC_SUBST(BOOST_THREAD_LIB) link_thread="yes"; break],
+                             [link_thread="no"])
+            done
+            if test "x$link_thread" != "xyes"; then
+            for libextension in `ls $BOOSTLIBDIR/boost_thread*.{dll,a}* 2>/dev/null | sed 's,.*/,,' | sed -e 's;^\(boost_thread.*\)\.dll.*$;\1;' -e 's;^\(boost_thread.*\)\.a*$;\1;'` ; do
+                 ax_lib=${libextension}
+                AC_CHECK_LIB($ax_lib, exit,
+                             [BOOST_THREAD_LIB="-l$ax_lib"; AC_SUBST(BOOST_THREAD_LIB) link_thread="yes"; break],
+                             [link_thread="no"])
+            done
+            fi
+
+        else
+           for ax_lib in $ax_boost_user_thread_lib boost_thread-$ax_boost_user_thread_lib; do
+                  AC_CHECK_LIB($ax_lib, main,
+                               [BOOST_THREAD_LIB="-l$ax_lib"; AC_SUBST(BOOST_THREAD_LIB) link_thread="yes"; break],
+                               [link_thread="no"])
+           done
+        fi
+        if test "x$link_thread" != "xyes"; then
+            if test "x$ax_lib" = "x" ; then
+                ax_lib="the Boost thread library"
+            fi
+            AC_MSG_ERROR(Could not link against $ax_lib !)
+        fi
+    fi
+
+    CPPFLAGS="$CPPFLAGS_SAVED"
+    LDFLAGS="$LDFLAGS_SAVED"
+])
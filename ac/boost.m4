@@ -20,6 +20,13 @@ if test x"$ax_cv_boost_regex" != "xyes"; then
   AC_MSG_ERROR(The Boost Regex Library was not found.)
 fi
 
+# boost::thread must be present.
+AX_BOOST_THREAD()
+
+if test x"$ax_cv_boost_thread" != "xyes"; then
+  AC_MSG_ERROR(The Boost Thread Library was not found.)
+fi
+
 AX_BOOST_CHECK_HEADERS([boost/property_tree/ptree.hpp],,[
   AC_MSG_ERROR([Boost's property tree library is required but wasn't found])
 ])
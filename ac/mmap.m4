@@ -0,0 +1,24 @@
+dnl
+dnl Check for mmap and its definitions
+dnl
+AC_ARG_ENABLE(mmap,
+  AC_HELP_STRING([--disable-mmap],[do not use mmap for reading input files (auto)]),,
+  [enable_mmap=yes])
+
+if test x"$enable_mmap" != "xno" ; then
+  AC_CACHE_CHECK([for mmap], [ac_cv_mmap],[
+    ac_cv_mmap="no"
+    AC_LANG_PUSH(C++)
+    AC_TRY_COMPILE([
+#include <sys/types.h>
+#include <sys/mman.h>
+      ],[
+        void *p = mmap(0, 0, PROT_READ | PROT_WRITE, MAP_PRIVATE, 0, 0);
+        munmap(p, 0);
+      ],[ac_cv_mmap="yes"])
+    AC_LANG_POP
+  ])
+  if test x"$ac_cv_mmap" = "xyes" ; then
+    AC_DEFINE([HAVE_MMAP], 1, [define if mmap and its definitions are available])
+  fi
+fi
@@ -363,6 +363,9 @@ class EBML_DLL_API EbmlSemanticContext {
 		const EbmlCallbacks *MasterElt;
 };
 
+/// EbmlElement::SetAllocationFunctions() is available
+#define LIBEBML_HAS_ALLOCATION_FUNCTIONS 1
+
 /*!
 	\class EbmlElement
 	\brief Hold basic informations about an EBML element (ID + length)
@@ -372,6 +375,14 @@ class EBML_DLL_API EbmlElement {
 		EbmlElement(uint64 aDefaultSize, bool bValueSet = false);
 		virtual ~EbmlElement();
 
+		/*!
+			\brief allocate all elements with the given functions instead of the global operator new/delete (e.g. from a memory pool)
+			\note the functions must be set before the first element is created on the heap
+		*/
+		static void SetAllocationFunctions(void *(*Allocate)(size_t Size), void (*Release)(void *Ptr));
+		static void *operator new(size_t Size);
+		static void operator delete(void *Ptr);
+
 		/// Set the minimum length that will be used to write the element size (-1 = optimal)
 		void SetSizeLength(int NewSizeLength) {SizeLength = NewSizeLength;}
 		int GetSizeLength() const {return SizeLength;}
@@ -222,6 +222,32 @@ const EbmlSemantic & EbmlSemanticContext::GetSemantic(size_t i) const
 }
 
 
+static void *(*AllocateFunction)(size_t Size) = NULL;
+static void (*ReleaseFunction)(void *Ptr) = NULL;
+
+void EbmlElement::SetAllocationFunctions(void *(*Allocate)(size_t Size), void (*Release)(void *Ptr))
+{
+	AllocateFunction = Allocate;
+	ReleaseFunction = Release;
+}
+
+void *EbmlElement::operator new(size_t Size)
+{
+	if (AllocateFunction != NULL)
+		return AllocateFunction(Size);
+	return ::operator new(Size);
+}
+
+void EbmlElement::operator delete(void *Ptr)
+{
+	if (Ptr == NULL)
+		return;
+	if (ReleaseFunction != NULL)
+		ReleaseFunction(Ptr);
+	else
+		::operator delete(Ptr);
+}
+
 EbmlElement::EbmlElement(uint64 aDefaultSize, bool bValueSet)
  :DefaultSize(aDefaultSize)
  ,SizeLength(0) ///< write optimal size by default
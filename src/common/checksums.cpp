@@ -16,6 +16,19 @@
 
 #include "common/common_pch.h"
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && ((4 < __GNUC__) || ((4 == __GNUC__) && (9 <= __GNUC_MINOR__)))))
+# define HAVE_CRC_PCLMUL
+# include <cpuid.h>
+# include <smmintrin.h>
+# include <wmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+# define HAVE_CRC_ARMV8
+# include <arm_acle.h>
+#endif
+
 #include "common/bswap.h"
 #include "common/checksums.h"
 #include "common/endian.h"
@@ -74,11 +87,22 @@ static struct {
   { 0, 32, 0x04C11DB7 },
   { 1, 32, 0xEDB88320 },
 };
-static uint32_t s_crc_table[CRC_MAX][257];
+// Eight tables of 256 entries each for processing eight bytes at a
+// time ("slicing-by-8").
+static uint32_t s_crc_table[CRC_MAX][8 * 256];
+static bool s_crc_table_initialized[CRC_MAX];
+static boost::mutex s_crc_table_mutex;
+
 #ifdef COMP_MSC
 #pragma warning(disable:4146)	//unary minus operator applied to unsigned type, result still unsigned
 #endif
 
+/** \brief Fills a CRC table
+
+   \a ctx_size must either be large enough for 257 entries (one table,
+   one byte at a time) or for 2048 entries (eight tables, eight bytes at
+   a time). ::crc_calc distinguishes the two by the entry at index 256.
+*/
 int
 crc_init(uint32_t *ctx,
          int le,
@@ -91,7 +115,7 @@ crc_init(uint32_t *ctx,
   if ((bits < 8) || (bits > 32) || (poly >= (1LL<<bits)))
     return -1;
 
-  if ((ctx_size != sizeof(uint32_t) * 257) && (ctx_size != sizeof(uint32_t) * 1024))
+  if ((ctx_size != sizeof(uint32_t) * 257) && (ctx_size != sizeof(uint32_t) * 8 * 256))
     return -1;
 
   for (i = 0; i < 256; i++) {
@@ -109,9 +133,11 @@ crc_init(uint32_t *ctx,
 
   ctx[256] = 1;
 
-  if(ctx_size >= sizeof(uint32_t) * 1024)
+  // Entry 0 of the second table is always 0 which tells crc_calc() that
+  // all eight tables are present.
+  if (ctx_size >= sizeof(uint32_t) * 8 * 256)
     for (i = 0; i < 256; i++)
-      for(j=0; j<3; j++)
+      for (j = 0; j < 7; j++)
         ctx[256 * (j + 1) + i] = (ctx[256 * j + i] >> 8) ^ ctx[ctx[256 * j + i] & 0xff];
 
   return 0;
@@ -119,34 +145,265 @@ crc_init(uint32_t *ctx,
 
 const uint32_t *
 crc_get_table(crc_type_e crc_id){
-  if (!s_crc_table[crc_id][256])
+  boost::lock_guard<boost::mutex> lock(s_crc_table_mutex);
+
+  if (!s_crc_table_initialized[crc_id]) {
     if (crc_init(s_crc_table[crc_id], s_crc_table_params[crc_id].le, s_crc_table_params[crc_id].bits, s_crc_table_params[crc_id].poly, sizeof(s_crc_table[crc_id])) < 0)
       return NULL;
+    s_crc_table_initialized[crc_id] = true;
+  }
 
   return s_crc_table[crc_id];
 }
 
+static uint32_t
+crc_calc_bytewise(const uint32_t *ctx,
+                  uint32_t crc,
+                  const unsigned char *buffer,
+                  size_t length) {
+  const uint8_t *end = buffer + length;
+
+  while(buffer < end)
+    crc = ctx[((uint8_t)crc) ^ *buffer++] ^ (crc >> 8);
+
+  return crc;
+}
+
+static inline uint32_t
+load_uint32_le(const unsigned char *buffer) {
+#if defined(ARCH_LITTLEENDIAN)
+  uint32_t value;
+  memcpy(&value, buffer, sizeof(value));
+  return value;
+#else
+  return get_uint32_le(buffer);
+#endif
+}
+
+static uint32_t
+crc_calc_slicing_by_8(const uint32_t *ctx,
+                      uint32_t crc,
+                      const unsigned char *buffer,
+                      size_t length) {
+  if (ctx[256])
+    return crc_calc_bytewise(ctx, crc, buffer, length);
+
+  for (; 8 <= length; buffer += 8, length -= 8) {
+    uint32_t low  = crc ^ load_uint32_le(buffer);
+    uint32_t high = load_uint32_le(buffer + 4);
+    crc           =   ctx[7 * 256 + ( low         & 0xff)]
+                    ^ ctx[6 * 256 + ((low   >>  8) & 0xff)]
+                    ^ ctx[5 * 256 + ((low   >> 16) & 0xff)]
+                    ^ ctx[4 * 256 + ( low   >> 24        )]
+                    ^ ctx[3 * 256 + ( high        & 0xff)]
+                    ^ ctx[2 * 256 + ((high  >>  8) & 0xff)]
+                    ^ ctx[1 * 256 + ((high  >> 16) & 0xff)]
+                    ^ ctx[0 * 256 + ( high  >> 24        )];
+  }
+
+  return crc_calc_bytewise(ctx, crc, buffer, length);
+}
+
+#if defined(HAVE_CRC_PCLMUL)
+/* CRC-32 (IEEE, bit-reflected) folding with carry-less multiplication
+   as described in Intel's paper "Fast CRC Computation for Generic
+   Polynomials Using PCLMULQDQ Instruction". Processes a multiple of 16
+   bytes, at least 64.
+*/
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t
+crc_calc_32_ieee_le_pclmul(uint32_t crc,
+                           const unsigned char *buffer,
+                           size_t length) {
+  static const uint64_t k1k2[] __attribute__((aligned(16))) = { 0x0154442bd4ull, 0x01c6e41596ull };
+  static const uint64_t k3k4[] __attribute__((aligned(16))) = { 0x01751997d0ull, 0x00ccaa009eull };
+  static const uint64_t k5k0[] __attribute__((aligned(16))) = { 0x0163cd6124ull, 0x0000000000ull };
+  static const uint64_t poly[] __attribute__((aligned(16))) = { 0x01db710641ull, 0x01f7011641ull };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x00));
+  x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x10));
+  x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x20));
+  x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+
+  buffer += 64;
+  length -= 64;
+
+  // Fold four blocks of 16 bytes in parallel.
+  while (64 <= length) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+    y5 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x00));
+    y6 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x10));
+    y7 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x20));
+    y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 0x30));
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+    buffer += 64;
+    length -= 64;
+  }
+
+  // Fold the four blocks into one.
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Fold the remaining blocks of 16 bytes.
+  while (16 <= length) {
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer));
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    buffer += 16;
+    length -= 16;
+  }
+
+  // Fold 128 bits to 64 bits.
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+static bool
+crc_hardware_supported() {
+  unsigned int eax, ebx, ecx, edx;
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+
+  return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+static uint32_t
+crc_calc_32_ieee_le_hardware(const uint32_t *ctx,
+                             uint32_t crc,
+                             const unsigned char *buffer,
+                             size_t length) {
+  if (64 > length)
+    return crc_calc_slicing_by_8(ctx, crc, buffer, length);
+
+  size_t folded_length = length & ~static_cast<size_t>(15);
+  crc                  = crc_calc_32_ieee_le_pclmul(crc, buffer, folded_length);
+
+  return crc_calc_slicing_by_8(ctx, crc, buffer + folded_length, length - folded_length);
+}
+
+#elif defined(HAVE_CRC_ARMV8)
+static bool
+crc_hardware_supported() {
+  return true;
+}
+
+static uint32_t
+crc_calc_32_ieee_le_hardware(const uint32_t *,
+                             uint32_t crc,
+                             const unsigned char *buffer,
+                             size_t length) {
+  for (; 8 <= length; buffer += 8, length -= 8)
+    crc = __crc32d(crc, get_uint64_le(buffer));
+
+  while (length--)
+    crc = __crc32b(crc, *buffer++);
+
+  return crc;
+}
+
+#else
+static bool
+crc_hardware_supported() {
+  return false;
+}
+
+static uint32_t
+crc_calc_32_ieee_le_hardware(const uint32_t *ctx,
+                             uint32_t crc,
+                             const unsigned char *buffer,
+                             size_t length) {
+  return crc_calc_slicing_by_8(ctx, crc, buffer, length);
+}
+#endif
+
+/** \brief Whether or not an implementation can be used on this CPU
+
+   The hardware implementation only exists for CRC_32_IEEE_LE. It uses
+   PCLMULQDQ on x86 and the CRC32 instructions on ARMv8.
+*/
+bool
+crc_implementation_available(crc_implementation_e implementation) {
+  static bool s_hardware_supported = crc_hardware_supported();
+
+  return (CRC_IMPLEMENTATION_HARDWARE != implementation) || s_hardware_supported;
+}
+
 uint32_t
-crc_calc(const uint32_t *ctx,
+crc_calc(crc_implementation_e implementation,
+         const uint32_t *ctx,
          uint32_t crc,
          const unsigned char *buffer,
          size_t length) {
-  const uint8_t *end = buffer + length;
+  if (CRC_IMPLEMENTATION_BYTEWISE == implementation)
+    return crc_calc_bytewise(ctx, crc, buffer, length);
 
-  if (!ctx[256])
-    while (buffer < (end - 3)){
-      crc    ^= get_uint32_le(buffer);
-      crc     =   ctx[3 * 256 + ( crc        & 0xff)]
-                ^ ctx[2 * 256 + ((crc >>  8) & 0xff)]
-                ^ ctx[1 * 256 + ((crc >> 16) & 0xff)]
-                ^ ctx[0 * 256 + ((crc >> 24)       )];
-      buffer += 4;
-    }
+  if (   (CRC_IMPLEMENTATION_HARDWARE == implementation)
+      && (s_crc_table[CRC_32_IEEE_LE] == ctx)
+      && crc_implementation_available(CRC_IMPLEMENTATION_HARDWARE))
+    return crc_calc_32_ieee_le_hardware(ctx, crc, buffer, length);
 
-  while(buffer < end)
-    crc = ctx[((uint8_t)crc) ^ *buffer++] ^ (crc >> 8);
+  return crc_calc_slicing_by_8(ctx, crc, buffer, length);
+}
 
-  return crc;
+uint32_t
+crc_calc(const uint32_t *ctx,
+         uint32_t crc,
+         const unsigned char *buffer,
+         size_t length) {
+  return crc_calc(CRC_IMPLEMENTATION_HARDWARE, ctx, crc, buffer, length);
 }
 
 static const uint32_t crc_mpeg2_table[256] = {
@@ -27,9 +27,17 @@ enum crc_type_e {
   CRC_MAX        = CRC_32_IEEE_LE + 1,
 };
 
+enum crc_implementation_e {
+  CRC_IMPLEMENTATION_BYTEWISE,
+  CRC_IMPLEMENTATION_SLICING_BY_8,
+  CRC_IMPLEMENTATION_HARDWARE,
+};
+
 int crc_init(uint32_t *ctx, int le, int bits, uint32_t poly, unsigned int ctx_size);
 const uint32_t * crc_get_table(crc_type_e crc_id);
 uint32_t crc_calc(const uint32_t *ctx, uint32_t start_crc, const unsigned char *buffer, size_t length);
+uint32_t crc_calc(crc_implementation_e implementation, const uint32_t *ctx, uint32_t start_crc, const unsigned char *buffer, size_t length);
+bool crc_implementation_available(crc_implementation_e implementation);
 uint32_t crc_calc_mpeg2(unsigned char *data, int len);
 
 #endif // __MTX_COMMON_CHECKSUMS_H
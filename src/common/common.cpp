@@ -21,6 +21,7 @@
 #include <matroska/KaxVersion.h>
 #include <matroska/FileKax.h>
 
+#include "common/ebml_arena.h"
 #include "common/mm_io.h"
 #include "common/random.h"
 #include "common/stereo_mode.h"
@@ -98,6 +99,7 @@ mtx_common_cleanup() {
 
 void
 mtx_common_init() {
+  ebml_arena_c::init();
   matroska_init();
 
   atexit(mtx_common_cleanup);
@@ -16,6 +16,9 @@
 #include <matroska/KaxContentEncoding.h>
 #include <matroska/KaxTracks.h>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+
 #include "common/ac3.h"
 #include "common/compression.h"
 #include "common/dirac.h"
@@ -56,20 +59,19 @@ static const int compression_method_map[] = {
 # include <lzoutil.h>
 #endif
 
+// Each thread compressing with LZO gets its own work memory which is
+// kept for all following calls.
+static boost::thread_specific_ptr<memory_c> s_lzo_work_memory;
+
 lzo_compressor_c::lzo_compressor_c()
   : compressor_c(COMPRESSION_LZO)
 {
   int result;
   if ((result = lzo_init()) != LZO_E_OK)
     mxerror(boost::format(Y("lzo_init() failed. Result: %1%\n")) % result);
-
-  wrkmem = (lzo_bytep)lzo_malloc(LZO1X_999_MEM_COMPRESS);
-  if (NULL == wrkmem)
-    mxerror(Y("lzo_malloc(LZO1X_999_MEM_COMPRESS) failed.\n"));
 }
 
 lzo_compressor_c::~lzo_compressor_c() {
-  safefree(wrkmem);
 }
 
 void
@@ -83,17 +85,20 @@ lzo_compressor_c::compress(memory_cptr &buffer) {
   unsigned char *dst   = (unsigned char *)safemalloc(size * 2);
   lzo_uint lzo_dstsize = size * 2;
 
+  if (NULL == s_lzo_work_memory.get())
+    s_lzo_work_memory.reset(new memory_c(safemalloc(LZO1X_999_MEM_COMPRESS), LZO1X_999_MEM_COMPRESS, true));
+
   int result;
-  if ((result = lzo1x_999_compress(buffer->get_buffer(), buffer->get_size(), dst, &lzo_dstsize, wrkmem)) != LZO_E_OK)
-    mxerror(boost::format(Y("LZO compression failed. Result: %1%\n")) % result);
+  if ((result = lzo1x_999_compress(buffer->get_buffer(), buffer->get_size(), dst, &lzo_dstsize, s_lzo_work_memory->get_buffer())) != LZO_E_OK) {
+    safefree(dst);
+    throw mtx::compression_x(boost::format(Y("LZO compression failed. Result: %1%")) % result);
+  }
 
   int dstsize = lzo_dstsize;
 
   mxverb(3, boost::format("lzo_compressor_c: Compression from %1% to %2%, %3%%%\n") % size % dstsize % (dstsize * 100 / size));
 
-  raw_size        += size;
-  compressed_size += dstsize;
-  items++;
+  add_stats(size, dstsize);
 
   buffer = memory_cptr(new memory_c((unsigned char *)saferealloc(dst, dstsize), dstsize, true));
 }
@@ -157,7 +162,7 @@ zlib_compressor_c::compress(memory_cptr &buffer) {
   int result      = deflateInit(&c_stream, 9);
 
   if (Z_OK != result)
-    mxerror(boost::format(Y("deflateInit() failed. Result: %1%\n")) % result);
+    throw mtx::compression_x(boost::format(Y("deflateInit() failed. Result: %1%")) % result);
 
   c_stream.next_in   = (Bytef *)buffer->get_buffer();
   c_stream.avail_in  = buffer->get_size();
@@ -171,8 +176,11 @@ zlib_compressor_c::compress(memory_cptr &buffer) {
     c_stream.avail_out = 4000;
     result             = deflate(&c_stream, Z_FINISH);
 
-    if ((Z_OK != result) && (Z_STREAM_END != result))
-      mxerror(boost::format(Y("Zlib decompression failed. Result: %1%\n")) % result);
+    if ((Z_OK != result) && (Z_STREAM_END != result)) {
+      deflateEnd(&c_stream);
+      safefree(dst);
+      throw mtx::compression_x(boost::format(Y("Zlib compression failed. Result: %1%")) % result);
+    }
 
   } while ((c_stream.avail_out == 0) && (result != Z_STREAM_END));
 
@@ -224,8 +232,10 @@ bzlib_compressor_c::compress(memory_cptr &buffer) {
   c_stream.opaque    = NULL;
 
   int result         = BZ2_bzCompressInit(&c_stream, 9, 0, 30);
-  if (BZ_OK != result)
-    mxerror(boost::format(Y("BZ2_bzCompressInit() failed. Result: %1%\n")) % result);
+  if (BZ_OK != result) {
+    safefree(dst);
+    throw mtx::compression_x(boost::format(Y("BZ2_bzCompressInit() failed. Result: %1%")) % result);
+  }
 
   c_stream.next_in   = (char *)buffer->get_buffer();
   c_stream.next_out  = (char *)dst;
@@ -233,8 +243,11 @@ bzlib_compressor_c::compress(memory_cptr &buffer) {
   c_stream.avail_out = 2 * size;
   result             = BZ2_bzCompress(&c_stream, BZ_FINISH);
 
-  if (BZ_STREAM_END != result)
-    mxerror(boost::format(Y("bzip2 compression failed. Result: %1%\n")) % result);
+  if (BZ_STREAM_END != result) {
+    BZ2_bzCompressEnd(&c_stream);
+    safefree(dst);
+    throw mtx::compression_x(boost::format(Y("bzip2 compression failed. Result: %1%")) % result);
+  }
 
   BZ2_bzCompressEnd(&c_stream);
 
@@ -242,9 +255,7 @@ bzlib_compressor_c::compress(memory_cptr &buffer) {
 
   mxverb(3, boost::format("bzlib_compressor_c: Compression from %1% to %2%, %3%%%\n") % size % dstsize % (dstsize * 100 / size));
 
-  raw_size        += size;
-  compressed_size += dstsize;
-  items++;
+  add_stats(size, dstsize);
 
   buffer = memory_cptr(new memory_c((unsigned char *)saferealloc(dst, dstsize), dstsize, true));
 }
@@ -301,7 +312,9 @@ header_removal_compressor_c::compress(memory_cptr &buffer) {
   if (buffer->is_free()) {
     memmove(buffer_ptr, buffer_ptr + size, new_size);
     buffer->set_size(new_size);
-  } else
+  } else if (buffer->is_owned())
+    buffer = buffer->slice(size, new_size);
+  else
     buffer = clone_memory(buffer_ptr + size, new_size);
 }
 
@@ -412,6 +425,16 @@ compressor_c::~compressor_c() {
          % raw_size % compressed_size % items % (compressed_size * 100.0 / raw_size) % (compressed_size / items));
 }
 
+void
+compressor_c::add_stats(int64_t raw,
+                        int64_t compressed) {
+  boost::lock_guard<boost::mutex> lock(m_stats_mutex);
+
+  raw_size        += raw;
+  compressed_size += compressed;
+  items++;
+}
+
 void
 compressor_c::set_track_headers(KaxContentEncoding &c_encoding) {
   KaxContentCompression *c_comp = &GetChild<KaxContentCompression>(c_encoding);
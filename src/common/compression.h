@@ -19,6 +19,8 @@
 #include <matroska/KaxContentEncoding.h>
 #include <matroska/KaxTracks.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include "common/memory.h"
 #include "common/error.h"
 
@@ -66,6 +68,7 @@ class compressor_c {
 protected:
   compression_method_e method;
   int64_t raw_size, compressed_size, items;
+  boost::mutex m_stats_mutex;
 
 public:
   compressor_c(compression_method_e n_method):
@@ -84,10 +87,19 @@ public:
   virtual void compress(memory_cptr &/* buffer */) {
   };
 
+  // Whether or not compress() may be called from several threads at
+  // the same time.
+  virtual bool can_compress_in_parallel() const {
+    return false;
+  }
+
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
+
+protected:
+  void add_stats(int64_t raw, int64_t compressed);
 };
 
 #ifdef HAVE_LZO
@@ -99,15 +111,16 @@ public:
 #endif
 
 class lzo_compressor_c: public compressor_c {
-protected:
-  lzo_byte *wrkmem;
-
 public:
   lzo_compressor_c();
   virtual ~lzo_compressor_c();
 
   virtual void decompress(memory_cptr &buffer);
   virtual void compress(memory_cptr &buffer);
+
+  virtual bool can_compress_in_parallel() const {
+    return true;
+  }
 };
 #endif // HAVE_LZO
 
@@ -120,6 +133,9 @@ public:
 
   virtual void decompress(memory_cptr &buffer);
   virtual void compress(memory_cptr &buffer);
+  virtual bool can_compress_in_parallel() const {
+    return true;
+  }
 };
 
 #if defined(HAVE_BZLIB_H)
@@ -132,6 +148,9 @@ public:
 
   virtual void decompress(memory_cptr &buffer);
   virtual void compress(memory_cptr &buffer);
+  virtual bool can_compress_in_parallel() const {
+    return true;
+  }
 };
 #endif // HAVE_BZLIB_H
 
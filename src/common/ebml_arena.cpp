@@ -0,0 +1,204 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the memory pool for EBML elements
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <ebml/EbmlElement.h>
+
+#include "common/ebml_arena.h"
+
+using namespace libebml;
+
+// Each element is preceeded by a pointer to the chunk it was allocated
+// from. Elements allocated from the heap store NULL instead. The size
+// keeps the elements aligned to 16 bytes.
+static const size_t s_header_size          = 16;
+static const size_t s_chunk_size           = 128 * 1024;
+static const size_t s_max_arena_allocation = 4 * 1024;
+static const size_t s_max_free_chunks      = 4;
+
+static void dont_delete_arena(ebml_arena_c *) { }
+static boost::thread_specific_ptr<ebml_arena_c> s_current_arena(dont_delete_arena);
+
+// Protects the chunks' counters and arena pointers as well as the
+// arenas' chunk lists. A single mutex is used so that an element can
+// be released safely while its arena is being destroyed.
+static boost::mutex s_chunk_mutex;
+
+ebml_arena_c::ebml_arena_c()
+  : m_current_chunk(NULL)
+  , m_num_allocations(0)
+  , m_num_heap_allocations(0)
+  , m_num_chunks_allocated(0)
+  , m_num_chunks_reused(0)
+  , m_debug(debugging_requested("ebml_arena"))
+{
+}
+
+ebml_arena_c::~ebml_arena_c() {
+  mxdebug_if(m_debug,
+             boost::format("ebml_arena: %1% elements allocated from the arena and %2% from the heap; %3% chunks allocated and %4% reused\n")
+             % m_num_allocations % m_num_heap_allocations % m_num_chunks_allocated % m_num_chunks_reused);
+
+  boost::mutex::scoped_lock lock(s_chunk_mutex);
+
+  for (auto chunk : m_chunks) {
+    if (0 == chunk->m_live)
+      ::operator delete(chunk);
+    else
+      chunk->m_arena = NULL;
+  }
+}
+
+/** \brief Installs the allocation functions in libebml
+
+   Has to be called before the first element is created.
+*/
+void
+ebml_arena_c::init() {
+#if defined(LIBEBML_HAS_ALLOCATION_FUNCTIONS)
+  EbmlElement::SetAllocationFunctions(allocate_element, release_element);
+#endif
+}
+
+/** \brief Whether or not elements can be allocated from an arena
+
+   Only the bundled libebml lets applications replace the element
+   allocation.
+*/
+bool
+ebml_arena_c::is_available() {
+#if defined(LIBEBML_HAS_ALLOCATION_FUNCTIONS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void *
+ebml_arena_c::allocate(size_t size) {
+  size_t needed = s_header_size + ((size + s_header_size - 1) & ~(s_header_size - 1));
+
+  if (needed > s_max_arena_allocation) {
+    ++m_num_heap_allocations;
+    return allocate_from_heap(size);
+  }
+
+  boost::mutex::scoped_lock lock(s_chunk_mutex);
+
+  if ((NULL == m_current_chunk) || ((m_current_chunk->m_used + needed) > s_chunk_size))
+    switch_chunk();
+
+  unsigned char *ptr = reinterpret_cast<unsigned char *>(m_current_chunk) + chunk_data_offset() + m_current_chunk->m_used;
+  *reinterpret_cast<chunk_t **>(ptr) = m_current_chunk;
+
+  m_current_chunk->m_used += needed;
+  ++m_current_chunk->m_live;
+  ++m_num_allocations;
+
+  return ptr + s_header_size;
+}
+
+void
+ebml_arena_c::switch_chunk() {
+  if (!m_free_chunks.empty()) {
+    m_current_chunk = m_free_chunks.back();
+    m_free_chunks.pop_back();
+    ++m_num_chunks_reused;
+    return;
+  }
+
+  m_current_chunk = create_chunk(this);
+  m_chunks.insert(m_current_chunk);
+  ++m_num_chunks_allocated;
+}
+
+void
+ebml_arena_c::chunk_emptied(chunk_t *chunk) {
+  chunk->m_used = 0;
+
+  // The current chunk is simply filled from the start again.
+  if (chunk == m_current_chunk)
+    return;
+
+  if (s_max_free_chunks > m_free_chunks.size()) {
+    m_free_chunks.push_back(chunk);
+    return;
+  }
+
+  m_chunks.erase(chunk);
+  ::operator delete(chunk);
+}
+
+size_t
+ebml_arena_c::chunk_data_offset() {
+  return (sizeof(chunk_t) + s_header_size - 1) & ~(s_header_size - 1);
+}
+
+ebml_arena_c::chunk_t *
+ebml_arena_c::create_chunk(ebml_arena_c *arena) {
+  chunk_t *chunk = static_cast<chunk_t *>(::operator new(chunk_data_offset() + s_chunk_size));
+  chunk->m_arena = arena;
+  chunk->m_used  = 0;
+  chunk->m_live  = 0;
+
+  return chunk;
+}
+
+void *
+ebml_arena_c::allocate_from_heap(size_t size) {
+  unsigned char *ptr                 = static_cast<unsigned char *>(::operator new(s_header_size + size));
+  *reinterpret_cast<chunk_t **>(ptr) = NULL;
+
+  return ptr + s_header_size;
+}
+
+void *
+ebml_arena_c::allocate_element(size_t size) {
+  ebml_arena_c *arena = s_current_arena.get();
+  return NULL == arena ? allocate_from_heap(size) : arena->allocate(size);
+}
+
+void
+ebml_arena_c::release_element(void *ptr) {
+  unsigned char *start = static_cast<unsigned char *>(ptr) - s_header_size;
+  chunk_t *chunk       = *reinterpret_cast<chunk_t **>(start);
+
+  if (NULL == chunk) {
+    ::operator delete(start);
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(s_chunk_mutex);
+
+  if (0 < --chunk->m_live)
+    return;
+
+  if (NULL != chunk->m_arena)
+    chunk->m_arena->chunk_emptied(chunk);
+  else
+    ::operator delete(chunk);
+}
+
+ebml_arena_scope_c::ebml_arena_scope_c(ebml_arena_c *arena)
+  : m_previous_arena(s_current_arena.get())
+{
+  s_current_arena.reset(arena);
+}
+
+ebml_arena_scope_c::~ebml_arena_scope_c() {
+  s_current_arena.reset(m_previous_arena);
+}
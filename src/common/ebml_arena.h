@@ -0,0 +1,86 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for the memory pool for EBML elements
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_EBML_ARENA_H
+#define __MTX_COMMON_EBML_ARENA_H
+
+#include "common/common_pch.h"
+
+#include <set>
+#include <vector>
+
+/* Allocates EBML elements from large chunks of memory instead of
+   allocating each element on the heap. Elements are allocated from the
+   arena that is active in the current thread (see ebml_arena_scope_c)
+   and from the heap if none is. Releasing elements can happen at any
+   time and in any order: a chunk is reused as soon as all elements
+   allocated from it have been released. This is the case after each
+   cluster for readers that delete a cluster before reading the next
+   one.
+
+   An arena must only be active in one thread at a time, but elements
+   may be released from any thread, e.g. by mkvinfo's worker threads
+   while the main thread reads the next cluster. The chunks' counters
+   and the list of free chunks are therefore protected by a mutex.
+   Chunks that still contain elements when the arena is destroyed are
+   freed along with their last element.
+*/
+class ebml_arena_c {
+protected:
+  struct chunk_t {
+    ebml_arena_c *m_arena;
+    size_t m_used, m_live;
+  };
+
+  std::set<chunk_t *> m_chunks;
+  std::vector<chunk_t *> m_free_chunks;
+  chunk_t *m_current_chunk;
+
+  uint64_t m_num_allocations, m_num_heap_allocations, m_num_chunks_allocated, m_num_chunks_reused;
+  bool m_debug;
+
+public:
+  ebml_arena_c();
+  ~ebml_arena_c();
+
+  void *allocate(size_t size);
+
+  static void init();
+  static bool is_available();
+
+protected:
+  void switch_chunk();
+  void chunk_emptied(chunk_t *chunk);
+
+  static size_t chunk_data_offset();
+  static chunk_t *create_chunk(ebml_arena_c *arena);
+  static void *allocate_from_heap(size_t size);
+  static void *allocate_element(size_t size);
+  static void release_element(void *ptr);
+};
+typedef counted_ptr<ebml_arena_c> ebml_arena_cptr;
+
+/* Makes an arena the active one in the current thread for as long as
+   the object exists. NULL means that elements are allocated from the
+   heap.
+*/
+class ebml_arena_scope_c {
+protected:
+  ebml_arena_c *m_previous_arena;
+
+public:
+  ebml_arena_scope_c(ebml_arena_c *arena);
+  ~ebml_arena_scope_c();
+};
+
+#endif // __MTX_COMMON_EBML_ARENA_H
@@ -0,0 +1,115 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   reassembling frames from a byte stream
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/frame_reassembler.h"
+
+frame_reassembler_c::frame_reassembler_c(size_t block_size)
+  : m_storage_size(0)
+  , m_block_size(block_size)
+  , m_data(NULL)
+  , m_filled(0)
+{
+}
+
+void
+frame_reassembler_c::add(const unsigned char *buffer,
+                         size_t size) {
+  if (0 == size)
+    return;
+
+  unsigned char *storage = static_cast<unsigned char *>(m_storage.get());
+  if (   m_packet.is_set()
+      || (NULL == m_data)
+      || (NULL == storage)
+      || ((m_data + m_filled + size) > (storage + m_storage_size)))
+    relocate(size);
+
+  memcpy(m_data + m_filled, buffer, size);
+  m_filled += size;
+}
+
+void
+frame_reassembler_c::add(memory_cptr &packet) {
+  // Only a buffer the packet owns may outlive the packet. Everything else,
+  // e.g. a reader's read buffer, is copied.
+  if ((0 == m_filled) && packet->is_owned() && (0 != packet->get_size())) {
+    m_packet = packet;
+    m_data   = packet->get_buffer();
+    m_filled = packet->get_size();
+    return;
+  }
+
+  add(packet->get_buffer(), packet->get_size());
+}
+
+void
+frame_reassembler_c::remove(size_t num) {
+  if (num > m_filled)
+    mxerror("frame_reassembler_c: num > m_filled. Should not have happened. Please file a bug report.\n");
+
+  m_data   += num;
+  m_filled -= num;
+
+  if ((0 == m_filled) && m_packet.is_set()) {
+    m_packet.clear();
+    m_data = NULL;
+  }
+}
+
+memory_cptr
+frame_reassembler_c::slice(size_t offset,
+                           size_t size) {
+  assert((offset + size) <= m_filled);
+
+  if (m_packet.is_set())
+    return m_packet->slice(m_data - m_packet->get_buffer() + offset, size);
+
+  return memory_c::borrow(m_data + offset, size, m_storage);
+}
+
+memory_cptr
+frame_reassembler_c::get_frame(size_t size) {
+  memory_cptr frame = slice(0, size);
+  remove(size);
+
+  return frame;
+}
+
+/** \brief Moves the unconsumed data to the start of a block
+
+   Afterwards at least \a size_to_add bytes can be appended to the
+   unconsumed data. The current block is reused if no frame refers to it
+   anymore and if it is big enough.
+*/
+void
+frame_reassembler_c::relocate(size_t size_to_add) {
+  size_t needed          = m_filled + size_to_add;
+  unsigned char *storage = static_cast<unsigned char *>(m_storage.get());
+
+  if ((NULL == storage) || (1 != m_storage.use_count()) || (m_storage_size < needed)) {
+    m_storage_size = std::max(m_block_size, needed);
+    memory_owner_t new_storage(safemalloc(m_storage_size), safefree);
+    storage        = static_cast<unsigned char *>(new_storage.get());
+
+    if (0 != m_filled)
+      memcpy(storage, m_data, m_filled);
+    m_storage      = new_storage;
+
+  } else if ((0 != m_filled) && (m_data != storage))
+    memmove(storage, m_data, m_filled);
+
+  m_data = storage;
+  m_packet.clear();
+}
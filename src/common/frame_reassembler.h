@@ -0,0 +1,67 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for reassembling frames from a byte stream
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_FRAME_REASSEMBLER_H
+#define __MTX_COMMON_FRAME_REASSEMBLER_H
+
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+
+/** \brief Collects a byte stream and cuts frames out of it
+
+   The data that has not been consumed yet is always available as one
+   contiguous buffer so that headers can be searched for in place. The
+   frames handed out are slices of that buffer and share its ownership;
+   they are not copied.
+
+   The data is stored in a block that is written to sequentially. When
+   new data does not fit behind the unconsumed data anymore then only
+   the unconsumed data, usually an incomplete frame, is moved to the
+   start of the block. The block is reused if none of the frames cut out
+   of it is still alive; otherwise a new one is allocated and the old one
+   is released together with its last frame.
+
+   A packet that is added while no unconsumed data is left is used
+   directly without copying it if it owns its buffer.
+*/
+class frame_reassembler_c {
+private:
+  memory_owner_t m_storage;
+  size_t m_storage_size, m_block_size;
+  memory_cptr m_packet;
+  unsigned char *m_data;
+  size_t m_filled;
+
+public:
+  frame_reassembler_c(size_t block_size = 512 * 1024);
+
+  void add(const unsigned char *buffer, size_t size);
+  void add(memory_cptr &packet);
+  void remove(size_t num);
+  memory_cptr slice(size_t offset, size_t size);
+  memory_cptr get_frame(size_t size);
+
+  unsigned char *get_buffer() const {
+    return m_data;
+  }
+
+  size_t get_size() const {
+    return m_filled;
+  }
+
+private:
+  void relocate(size_t size_to_add);
+};
+
+#endif // __MTX_COMMON_FRAME_REASSEMBLER_H
@@ -20,6 +20,8 @@
 #include <ebml/EbmlVoid.h>
 #include <ebml/StdIOCallback.h>
 
+#include <matroska/KaxBlock.h>
+
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/kax_file.h"
@@ -32,7 +34,23 @@ kax_file_c::kax_file_c(mm_io_cptr &in)
   , m_es(new EbmlStream(*m_in))
   , m_debug_read_next(debugging_requested("kax_file") || debugging_requested("kax_file_read_next"))
   , m_debug_resync(debugging_requested("kax_file") || debugging_requested("kax_file_resync"))
+  , m_filter_blocks(false)
 {
+  if (ebml_arena_c::is_available() && debugging_requested("ebml_arena"))
+    m_arena = ebml_arena_cptr(new ebml_arena_c);
+}
+
+/** \brief Restricts the blocks read from clusters to certain tracks
+
+   Clusters returned by \c read_next_level1_element() and
+   \c read_next_cluster() will only contain BlockGroups and SimpleBlocks
+   belonging to one of the tracks in \a track_numbers. The data of all
+   other blocks is skipped without being read.
+*/
+void
+kax_file_c::set_wanted_block_tracks(const std::set<int64_t> &track_numbers) {
+  m_filter_blocks       = true;
+  m_wanted_block_tracks = track_numbers;
 }
 
 EbmlElement *
@@ -123,9 +141,15 @@ kax_file_c::read_one_element() {
   if (NULL == callbacks)
     callbacks = &EBML_CLASS_CALLBACK(KaxSegment);
 
+  bool is_cluster  = EbmlId(*l1) == EBML_ID(KaxCluster);
   EbmlElement *l2 = NULL;
   try {
-    l1->Read(*m_es.get_object(), EBML_INFO_CONTEXT(*callbacks), upper_lvl_el, l2, true);
+    ebml_arena_scope_c arena_scope(is_cluster ? m_arena.get_object() : NULL);
+
+    if (m_filter_blocks && l1->IsFiniteSize() && is_cluster)
+      read_cluster_data(*static_cast<KaxCluster *>(l1));
+    else
+      l1->Read(*m_es.get_object(), EBML_INFO_CONTEXT(*callbacks), upper_lvl_el, l2, true);
 
   } catch (libebml::CRTError &e) {
     mxdebug_if(m_debug_resync, boost::format("exception reading element data: %1% (%2%)\n") % e.what() % e.getError());
@@ -143,6 +167,93 @@ kax_file_c::read_one_element() {
   return l1;
 }
 
+/** \brief Reads a cluster's children one by one
+
+   Children that are neither BlockGroups nor SimpleBlocks are read
+   completely. Blocks are only read if they belong to one of the wanted
+   tracks. The decision is based on the track number at the start of the
+   block's header so that the frame data of unwanted blocks never has to
+   be read.
+*/
+void
+kax_file_c::read_cluster_data(KaxCluster &cluster) {
+  uint64_t end_pos = cluster.GetElementPosition() + cluster.HeadSize() + cluster.GetSize();
+
+  // Get rid of the mandatory children created along with the cluster
+  // just like EbmlMaster::Read() does.
+  while (0 < cluster.ListSize()) {
+    delete cluster[0];
+    cluster.Remove(0);
+  }
+
+  while (m_in->getFilePointer() < end_pos) {
+    int upper_lvl_el = 0;
+    EbmlElement *l2  = m_es->FindNextElement(EBML_CLASS_CONTEXT(KaxCluster), upper_lvl_el, end_pos - m_in->getFilePointer(), true);
+
+    if (NULL == l2)
+      break;
+
+    if ((0 != upper_lvl_el) || !l2->IsFiniteSize()) {
+      delete l2;
+      break;
+    }
+
+    uint64_t l2_end_pos = l2->GetElementPosition() + l2->HeadSize() + l2->GetSize();
+
+    if (   (   (EbmlId(*l2) == EBML_ID(KaxBlockGroup))
+            || (EbmlId(*l2) == EBML_ID(KaxSimpleBlock)))
+        && !is_wanted_block(*l2)) {
+      delete l2;
+      m_in->setFilePointer(l2_end_pos, seek_beginning);
+      continue;
+    }
+
+    EbmlElement *l3 = NULL;
+    m_in->setFilePointer(l2->GetElementPosition() + l2->HeadSize(), seek_beginning);
+    l2->Read(*m_es.get_object(), EBML_CONTEXT(l2), upper_lvl_el, l3, true);
+    delete l3;
+
+    cluster.PushElement(*l2);
+    m_in->setFilePointer(l2_end_pos, seek_beginning);
+  }
+}
+
+/** \brief Determines whether a BlockGroup or SimpleBlock is wanted
+
+   Only the element's header and the track number are read. The file
+   pointer is left somewhere within the element.
+*/
+bool
+kax_file_c::is_wanted_block(EbmlElement &element) {
+  uint64_t pos     = element.GetElementPosition() + element.HeadSize();
+  uint64_t end_pos = pos + element.GetSize();
+
+  m_in->setFilePointer(pos, seek_beginning);
+
+  // A BlockGroup's Block can be preceded by other children.
+  if (EbmlId(element) == EBML_ID(KaxBlockGroup)) {
+    while (true) {
+      if (m_in->getFilePointer() >= end_pos)
+        return false;
+
+      vint_c id   = vint_c::read_ebml_id(m_in);
+      vint_c size = vint_c::read(m_in);
+
+      if (!id.is_valid() || !size.is_valid() || size.is_unknown())
+        return true;
+
+      if (EBML_ID_VALUE(EBML_ID(KaxBlock)) == id.m_value)
+        break;
+
+      m_in->skip(size.m_value);
+    }
+  }
+
+  vint_c track_number = vint_c::read(m_in);
+
+  return !track_number.is_valid() || (m_wanted_block_tracks.find(track_number.m_value) != m_wanted_block_tracks.end());
+}
+
 bool
 kax_file_c::is_level1_element_id(vint_c id) const {
   const EbmlSemanticContext &context = EBML_CLASS_CONTEXT(KaxSegment);
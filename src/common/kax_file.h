@@ -16,9 +16,12 @@
 
 #include "common.h"
 
+#include <set>
+
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxCluster.h>
 
+#include "common/ebml_arena.h"
 #include "common/mm_io.h"
 #include "common/vint.h"
 
@@ -34,6 +37,15 @@ protected:
 
   bool m_debug_read_next, m_debug_resync;
 
+  // Only blocks of these tracks are read from clusters if
+  // m_filter_blocks is set. All other blocks are skipped.
+  bool m_filter_blocks;
+  std::set<int64_t> m_wanted_block_tracks;
+
+  // The children of clusters are allocated from this arena if
+  // "--debug ebml_arena" is given.
+  ebml_arena_cptr m_arena;
+
 public:
   kax_file_c(mm_io_cptr &in);
   virtual ~kax_file_c();
@@ -43,6 +55,8 @@ public:
   virtual bool is_level1_element_id(vint_c id) const;
   virtual bool is_global_element_id(vint_c id) const;
 
+  virtual void set_wanted_block_tracks(const std::set<int64_t> &track_numbers);
+
   virtual EbmlElement *read_next_level1_element(uint32_t wanted_id = 0);
   virtual KaxCluster *read_next_cluster();
 
@@ -53,6 +67,8 @@ public:
 
 protected:
   virtual EbmlElement *read_one_element();
+  virtual void read_cluster_data(KaxCluster &cluster);
+  virtual bool is_wanted_block(EbmlElement &element);
 
   virtual EbmlElement *read_next_level1_element_internal(uint32_t wanted_id = 0);
   virtual EbmlElement *resync_to_level1_element_internal(uint32_t wanted_id = 0);
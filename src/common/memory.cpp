@@ -33,6 +33,8 @@ memory_c::resize(size_t new_size)
     its_counter->ptr     = tmp;
     its_counter->is_free = true;
     its_counter->size    = new_size;
+    its_counter->offset  = 0;
+    its_counter->owner.reset();
   }
 }
 
@@ -47,6 +49,27 @@ memory_c::add(unsigned char *new_buffer,
   memcpy(get_buffer() + previous_size, new_buffer, new_size);
 }
 
+/** \brief Returns a part of the buffer without copying it
+
+   The returned object shares the ownership of the buffer with this
+   object. If this object does not own its buffer yet then it is copied
+   once so that both objects can refer to it safely.
+*/
+memory_cptr
+memory_c::slice(size_t offset,
+                size_t size) {
+  assert((offset + size) <= get_size());
+
+  grab();
+
+  if (its_counter->is_free) {
+    its_counter->owner   = memory_owner_t(its_counter->ptr, safefree);
+    its_counter->is_free = false;
+  }
+
+  return borrow(get_buffer() + offset, size, its_counter->owner);
+}
+
 memory_cptr
 lace_memory_xiph(const std::vector<memory_cptr> &blocks) {
   size_t i, size = 1;
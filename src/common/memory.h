@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <deque>
+#include <memory>
 
 #include "common/error.h"
 
@@ -84,6 +85,14 @@ class memory_c;
 typedef counted_ptr<memory_c> memory_cptr;
 typedef std::vector<memory_cptr> memories_c;
 
+/* Shared ownership of a buffer that several memory_c objects point into,
+   e.g. the frames sliced out of a bigger buffer or out of a memory mapped
+   file. The buffer is released once the last of them has been deleted.
+   Its reference count is thread safe so that such objects can be handed
+   from one thread to another.
+*/
+typedef std::shared_ptr<void> memory_owner_t;
+
 class memory_c {
 public:
   typedef unsigned char X;
@@ -148,8 +157,12 @@ public:
     return its_counter && its_counter->is_free;
   }
 
+  bool is_owned() const {
+    return its_counter && (its_counter->is_free || its_counter->owner);
+  }
+
   void grab() {
-    if (!its_counter || its_counter->is_free)
+    if (!its_counter || its_counter->is_free || its_counter->owner)
       return;
 
     its_counter->ptr      = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
@@ -169,6 +182,8 @@ public:
     add(new_buffer->get_buffer(), new_buffer->get_size());
   }
 
+  memory_cptr slice(size_t offset, size_t size);
+
   operator const unsigned char *() const {
     return its_counter ? its_counter->ptr : NULL;
   }
@@ -190,6 +205,12 @@ public:
     return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
   };
 
+  static memory_cptr borrow(void *buffer, size_t size, const memory_owner_t &owner) {
+    memory_cptr mem(new memory_c(buffer, size, false));
+    mem->its_counter->owner = owner;
+    return mem;
+  }
+
 private:
   struct counter {
     X *ptr;
@@ -197,6 +218,7 @@ private:
     bool is_free;
     unsigned count;
     size_t offset;
+    memory_owner_t owner;
 
     counter(X *p = NULL,
             size_t s = 0,
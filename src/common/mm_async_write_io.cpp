@@ -0,0 +1,342 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation for asynchronous writing
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <errno.h>
+#if !defined(SYS_WINDOWS)
+# include <fcntl.h>
+# include <stdlib.h>
+# include <unistd.h>
+#endif
+
+#include <boost/thread/locks.hpp>
+
+#include "common/locale.h"
+#include "common/mm_async_write_io.h"
+
+#if defined(O_DIRECT)
+// Both the file positions and the buffers used for direct I/O must be
+// aligned to the file system's block size. This value is safe for all
+// common file systems.
+static const size_t s_direct_io_alignment = 4096;
+#endif
+
+mm_async_write_io_c::mm_async_write_io_c(const std::string &file_name,
+                                         size_t num_blocks,
+                                         size_t block_size,
+                                         bool direct)
+  : m_out(new mm_file_io_c(file_name, MODE_CREATE))
+  , m_file_name(file_name)
+  , m_direct_fd(-1)
+  , m_block_size(std::max<size_t>(block_size, 1))
+  , m_pos(0)
+  , m_size(0)
+  , m_writing(false)
+  , m_stop(false)
+{
+#if defined(O_DIRECT)
+  if (direct) {
+    m_block_size = (m_block_size + s_direct_io_alignment - 1) / s_direct_io_alignment * s_direct_io_alignment;
+    m_direct_fd  = ::open(g_cc_local_utf8->native(file_name).c_str(), O_WRONLY | O_DIRECT);
+
+    if (-1 == m_direct_fd)
+      mxverb(2, boost::format("mm_async_write_io_c: direct I/O is not possible for '%1%' (%2%); using normal file I/O\n") % file_name % strerror(errno));
+  }
+#endif
+
+  size_t i;
+  for (i = 0; std::max<size_t>(num_blocks, 2) > i; ++i) {
+    unsigned char *buffer = NULL;
+
+#if defined(O_DIRECT)
+    if ((-1 != m_direct_fd) && (0 != posix_memalign(reinterpret_cast<void **>(&buffer), s_direct_io_alignment, m_block_size))) {
+      ::close(m_direct_fd);
+      m_direct_fd = -1;
+      buffer      = NULL;
+    }
+#endif
+
+    if (NULL == buffer)
+      buffer = safemalloc(m_block_size);
+
+    m_buffers.push_back(buffer);
+    m_free_buffers.push_back(buffer);
+  }
+
+  m_thread = boost::thread(&mm_async_write_io_c::run, this);
+}
+
+mm_async_write_io_c::~mm_async_write_io_c() {
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+mm_io_cptr
+mm_async_write_io_c::open(const std::string &file_name,
+                          size_t num_blocks,
+                          size_t block_size,
+                          bool direct) {
+  return mm_io_cptr(new mm_async_write_io_c(file_name, num_blocks, block_size, direct));
+}
+
+bool
+mm_async_write_io_c::is_direct_io_available() {
+#if defined(O_DIRECT)
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64
+mm_async_write_io_c::getFilePointer() {
+  return m_pos;
+}
+
+void
+mm_async_write_io_c::setFilePointer(int64 offset,
+                                    seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? static_cast<int64_t>(m_size) + offset
+    :                          static_cast<int64_t>(m_pos)  + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x();
+
+  if (static_cast<uint64_t>(new_pos) == m_pos)
+    return;
+
+  submit_current_block();
+  m_pos = new_pos;
+}
+
+bool
+mm_async_write_io_c::eof() {
+  return m_pos >= m_size;
+}
+
+int64_t
+mm_async_write_io_c::get_size() {
+  return m_size;
+}
+
+void
+mm_async_write_io_c::flush() {
+  submit_current_block();
+  wait_until_idle();
+  m_out->flush();
+}
+
+int
+mm_async_write_io_c::truncate(int64_t pos) {
+  flush();
+  m_size = pos;
+
+  return m_out->truncate(pos);
+}
+
+/** \brief Writes all outstanding blocks and closes the file
+
+   Errors that occured while writing in the background are reported
+   here at the latest.
+*/
+void
+mm_async_write_io_c::close() {
+  if (NULL == m_out)
+    return;
+
+  submit_current_block();
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_writer_cond.notify_all();
+  m_thread.join();
+
+#if !defined(SYS_WINDOWS)
+  if (-1 != m_direct_fd)
+    ::close(m_direct_fd);
+#endif
+  m_direct_fd = -1;
+
+  delete m_out;
+  m_out = NULL;
+
+  for (auto buffer : m_buffers)
+    free(buffer);
+  m_buffers.clear();
+  m_free_buffers.clear();
+
+  rethrow_writer_exception();
+}
+
+uint32
+mm_async_write_io_c::_read(void *,
+                           size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+size_t
+mm_async_write_io_c::_write(const void *buffer,
+                            size_t size) {
+  size_t bytes_written = size;
+  size_t buffer_offset = 0;
+
+  while (0 != size) {
+    if (NULL == m_current.m_buffer) {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while (m_free_buffers.empty() && !m_exception)
+        m_main_cond.wait(lock);
+
+      rethrow_writer_exception();
+
+      m_current            = block_t(m_free_buffers.front(), m_block_size);
+      m_current.m_position = m_pos;
+      m_free_buffers.pop_front();
+
+#if defined(O_DIRECT)
+      size_t misalignment = m_pos % s_direct_io_alignment;
+      if ((-1 != m_direct_fd) && (0 != misalignment))
+        m_current.m_capacity = s_direct_io_alignment - misalignment;
+#endif
+    }
+
+    size_t bytes_to_write = std::min(size, m_current.m_capacity - m_current.m_fill);
+    memcpy(m_current.m_buffer + m_current.m_fill, static_cast<const unsigned char *>(buffer) + buffer_offset, bytes_to_write);
+    buffer_offset    += bytes_to_write;
+    m_current.m_fill += bytes_to_write;
+    m_pos            += bytes_to_write;
+    size             -= bytes_to_write;
+    m_size            = std::max(m_size, m_pos);
+
+    if (m_current.m_fill == m_current.m_capacity)
+      submit_current_block();
+  }
+
+  return bytes_written;
+}
+
+void
+mm_async_write_io_c::submit_current_block() {
+  if (NULL == m_current.m_buffer)
+    return;
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if (0 == m_current.m_fill)
+      m_free_buffers.push_back(m_current.m_buffer);
+    else
+      m_pending.push_back(m_current);
+  }
+
+  m_current = block_t();
+  m_writer_cond.notify_all();
+}
+
+void
+mm_async_write_io_c::wait_until_idle() {
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while ((!m_pending.empty() || m_writing) && !m_exception)
+    m_main_cond.wait(lock);
+
+  rethrow_writer_exception();
+}
+
+void
+mm_async_write_io_c::rethrow_writer_exception() {
+  if (m_exception)
+    std::rethrow_exception(m_exception);
+}
+
+void
+mm_async_write_io_c::run() {
+  while (true) {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while (m_pending.empty() && !m_stop)
+      m_writer_cond.wait(lock);
+
+    if (m_pending.empty())
+      break;
+
+    block_t block = m_pending.front();
+    m_pending.pop_front();
+    m_writing = true;
+    lock.unlock();
+
+    std::exception_ptr exception;
+    try {
+      write_block(block);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+    m_writing = false;
+    m_free_buffers.push_back(block.m_buffer);
+
+    if (exception) {
+      // Nothing else will be written after an error.
+      m_exception = exception;
+      for (auto &pending : m_pending)
+        m_free_buffers.push_back(pending.m_buffer);
+      m_pending.clear();
+    }
+
+    m_main_cond.notify_all();
+
+    if (exception)
+      break;
+  }
+}
+
+void
+mm_async_write_io_c::write_block(const block_t &block) {
+#if defined(O_DIRECT)
+  if (   (-1           != m_direct_fd)
+      && (m_block_size == block.m_fill)
+      && (0            == (block.m_position % s_direct_io_alignment))) {
+    size_t bytes_written = 0;
+
+    while (bytes_written < block.m_fill) {
+      ssize_t result = pwrite(m_direct_fd, block.m_buffer + bytes_written, block.m_fill - bytes_written, block.m_position + bytes_written);
+      if ((0 > result) && (EINTR == errno))
+        continue;
+      if (0 >= result)
+        throw mtx::mm_io::insufficient_space_x();
+
+      bytes_written += result;
+    }
+
+    return;
+  }
+#endif
+
+  m_out->setFilePointer(block.m_position);
+  size_t bytes_written = m_out->write(block.m_buffer, block.m_fill);
+  mxverb(3, boost::format("mm_async_write_io_c::write_block(): position %1% requested %2% written %3%\n") % block.m_position % block.m_fill % bytes_written);
+  if (bytes_written != block.m_fill)
+    throw mtx::mm_io::insufficient_space_x();
+
+  // The normal file handle buffers data in user space. Flush it so that
+  // the kernel sees all writes in the same order regardless of the handle
+  // they've been made through.
+  if (-1 != m_direct_fd)
+    m_out->flush();
+}
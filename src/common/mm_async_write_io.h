@@ -0,0 +1,112 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions for asynchronous writing
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_MM_ASYNC_WRITE_IO_H
+#define __MTX_COMMON_MM_ASYNC_WRITE_IO_H
+
+#include "common/common_pch.h"
+
+#include <deque>
+#include <exception>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/mm_io.h"
+
+/* Write-only file that is written by a background thread.
+
+   Data is collected in a fixed number of blocks. Each block is handed over
+   to the writer thread as soon as it is full or as soon as the file
+   pointer is moved elsewhere, e.g. for rewriting headers. The caller only
+   has to wait if all blocks are in use. Blocks are written in the order
+   they were filled, so overwriting earlier parts of the file works just
+   like with a synchronous file.
+
+   If direct I/O has been requested and is supported then full blocks are
+   written bypassing the page cache. Everything else (the partial blocks
+   resulting from seeking) is written through a normal file handle. The
+   first block filled after seeking to an unaligned position ends at the
+   next alignment boundary so that the blocks following it can be written
+   directly again.
+*/
+class mm_async_write_io_c: public mm_io_c {
+protected:
+  struct block_t {
+    unsigned char *m_buffer;
+    uint64_t m_position;
+    size_t m_fill, m_capacity;
+
+    block_t(unsigned char *buffer = NULL,
+            size_t capacity       = 0)
+      : m_buffer(buffer)
+      , m_position(0)
+      , m_fill(0)
+      , m_capacity(capacity)
+    {
+    }
+  };
+
+  mm_io_c *m_out;
+  std::string m_file_name;
+  int m_direct_fd;
+  size_t m_block_size;
+  uint64_t m_pos, m_size;
+
+  std::vector<unsigned char *> m_buffers;
+  std::deque<unsigned char *> m_free_buffers;
+  std::deque<block_t> m_pending;
+  block_t m_current;
+  bool m_writing, m_stop;
+  std::exception_ptr m_exception;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_writer_cond, m_main_cond;
+  boost::thread m_thread;
+
+public:
+  mm_async_write_io_c(const std::string &file_name, size_t num_blocks, size_t block_size, bool direct);
+  virtual ~mm_async_write_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual bool eof();
+  virtual void flush();
+  virtual int truncate(int64_t pos);
+  virtual int64_t get_size();
+  virtual void close();
+
+  virtual std::string get_file_name() const {
+    return m_file_name;
+  }
+
+  bool uses_direct_io() const {
+    return -1 != m_direct_fd;
+  }
+
+  static bool is_direct_io_available();
+  static mm_io_cptr open(const std::string &file_name, size_t num_blocks, size_t block_size, bool direct = false);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  void submit_current_block();
+  void wait_until_idle();
+  void rethrow_writer_exception();
+  void run();
+  void write_block(const block_t &block);
+};
+
+#endif // __MTX_COMMON_MM_ASYNC_WRITE_IO_H
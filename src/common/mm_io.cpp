@@ -525,6 +525,22 @@ mm_io_c::read(memory_cptr &buffer,
   return size;
 }
 
+/** \brief Reads \a size bytes into a new memory object
+
+   Throws \c mtx::mm_io::end_of_file_x if fewer bytes are available.
+   Classes that have the data in memory already can return a slice of
+   their own buffer instead of a copy, e.g. \c mm_mmap_io_c.
+*/
+memory_cptr
+mm_io_c::read_slice(size_t size) {
+  memory_cptr buffer = memory_c::alloc(size);
+
+  if (read(buffer->get_buffer(), size) != size)
+    throw mtx::mm_io::end_of_file_x();
+
+  return buffer;
+}
+
 int
 mm_io_c::write_uint8(unsigned char value) {
   return write(&value, 1);
@@ -1112,12 +1128,15 @@ mm_text_io_c::setFilePointer(int64 offset,
    Class for reading from stdin & writing to stdout.
 */
 
-mm_stdio_c::mm_stdio_c() {
+mm_stdio_c::mm_stdio_c(FILE *file)
+  : m_file(file)
+  , m_position(0)
+{
 }
 
 uint64
 mm_stdio_c::getFilePointer() {
-  return 0;
+  return m_position;
 }
 
 void
@@ -1135,9 +1154,11 @@ mm_stdio_c::_read(void *buffer,
 size_t
 mm_stdio_c::_write(const void *buffer,
                    size_t size) {
-  m_cached_size = -1;
+  m_cached_size        = -1;
+  size_t bytes_written = fwrite(buffer, 1, size, m_file);
+  m_position          += bytes_written;
 
-  return fwrite(buffer, 1, size, stdout);
+  return bytes_written;
 }
 #endif // defined(SYS_WINDOWS)
 
@@ -1147,5 +1168,5 @@ mm_stdio_c::close() {
 
 void
 mm_stdio_c::flush() {
-  fflush(stdout);
+  fflush(m_file);
 }
@@ -122,6 +122,7 @@ public:
   virtual uint32 read(void *buffer, size_t size);
   virtual uint32_t read(std::string &buffer, size_t size, size_t offset = 0);
   virtual uint32_t read(memory_cptr &buffer, size_t size, int offset = 0);
+  virtual memory_cptr read_slice(size_t size);
   virtual unsigned char read_uint8();
   virtual uint16_t read_uint16_le();
   virtual uint32_t read_uint24_le();
@@ -363,9 +364,17 @@ public:
 
 typedef counted_ptr<mm_text_io_c> mm_text_io_cptr;
 
+/* Reads from stdin and writes to stdout or stderr. The position is the
+   number of bytes written so far which allows writing Matroska files to
+   stdout as long as no seeking is required.
+*/
 class mm_stdio_c: public mm_io_c {
+protected:
+  FILE *m_file;
+  uint64_t m_position;
+
 public:
-  mm_stdio_c();
+  mm_stdio_c(FILE *file = stdout);
 
   virtual uint64 getFilePointer();
   virtual void setFilePointer(int64 offset, seek_mode mode=seek_beginning);
@@ -207,7 +207,7 @@ mm_file_io_c::setup() {
 size_t
 mm_stdio_c::_write(const void *buffer,
                    size_t size) {
-  HANDLE h_stdout = GetStdHandle(STD_OUTPUT_HANDLE);
+  HANDLE h_stdout = GetStdHandle(stderr == m_file ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE);
   if (INVALID_HANDLE_VALUE == h_stdout)
     return 0;
 
@@ -227,10 +227,11 @@ mm_stdio_c::_write(const void *buffer,
     return bytes_written;
   }
 
-  size_t bytes_written = fwrite(buffer, 1, size, stdout);
-  fflush(stdout);
+  size_t bytes_written = fwrite(buffer, 1, size, m_file);
+  fflush(m_file);
 
-  m_cached_size = -1;
+  m_cached_size  = -1;
+  m_position    += bytes_written;
 
   return bytes_written;
 }
@@ -0,0 +1,204 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation for memory mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <limits>
+#if HAVE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include "common/locale.h"
+#include "common/mm_mmap_io.h"
+
+bool mm_mmap_io_c::ms_enabled = false;
+
+#if HAVE_MMAP
+namespace {
+
+struct unmapper_t {
+  size_t m_size;
+
+  unmapper_t(size_t size)
+    : m_size(size)
+  {
+  }
+
+  void operator ()(void *mapping) const {
+    munmap(mapping, m_size);
+  }
+};
+
+}
+#endif
+
+mm_mmap_io_c::mm_mmap_io_c(const std::string &path)
+  : m_file_name(path)
+  , m_fd(-1)
+  , m_mapping(NULL)
+  , m_size(0)
+  , m_pos(0)
+{
+#if HAVE_MMAP
+  std::string local_path = g_cc_local_utf8->native(path);
+
+  m_fd = ::open(local_path.c_str(), O_RDONLY);
+  if (-1 == m_fd)
+    throw mtx::mm_io::open_x();
+
+  struct stat st;
+  if ((0 != fstat(m_fd, &st)) || !S_ISREG(st.st_mode) || (0 == st.st_size) || (static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max())) {
+    close();
+    throw mtx::mm_io::open_x();
+  }
+
+  m_size    = st.st_size;
+  m_mapping = static_cast<unsigned char *>(mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, 0));
+
+  if (MAP_FAILED == m_mapping) {
+    m_mapping = NULL;
+    close();
+    throw mtx::mm_io::open_x();
+  }
+
+  m_owner = memory_owner_t(m_mapping, unmapper_t(m_size));
+
+  posix_madvise(m_mapping, m_size, POSIX_MADV_SEQUENTIAL);
+
+#else  // HAVE_MMAP
+  throw mtx::mm_io::open_x();
+#endif // HAVE_MMAP
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+void
+mm_mmap_io_c::close() {
+#if HAVE_MMAP
+  if (-1 != m_fd)
+    ::close(m_fd);
+#endif
+
+  // The mapping itself is only removed once all slices have been freed.
+  m_owner.reset();
+
+  m_mapping = NULL;
+  m_fd      = -1;
+  m_size    = 0;
+  m_pos     = 0;
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_pos;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? static_cast<int64_t>(m_size) + offset
+    :                          static_cast<int64_t>(m_pos)  + offset;
+
+  // Just like fseeko() seeking beyond the end of the file is fine.
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x();
+
+  m_pos = new_pos;
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_pos >= m_size;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  if (m_pos >= m_size)
+    return 0;
+
+  size_t num_read = std::min<uint64_t>(size, m_size - m_pos);
+  memcpy(buffer, m_mapping + m_pos, num_read);
+  m_pos += num_read;
+
+  return num_read;
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+}
+
+/** \brief Returns the next \a size bytes without copying them
+
+   The returned object points into the mapping and keeps it alive even
+   after the file has been closed.
+*/
+memory_cptr
+mm_mmap_io_c::read_slice(size_t size) {
+  if ((m_pos >= m_size) || (size > (m_size - m_pos)))
+    throw mtx::mm_io::end_of_file_x();
+
+  memory_cptr slice = memory_c::borrow(m_mapping + m_pos, size, m_owner);
+  m_pos += size;
+
+  return slice;
+}
+
+bool
+mm_mmap_io_c::is_available() {
+#if HAVE_MMAP
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+mm_mmap_io_c::enable(bool enabled) {
+  ms_enabled = enabled && is_available();
+}
+
+/** \brief Opens a file for reading
+
+   Maps the file into memory if memory mapping has been enabled and the
+   file is a regular file. Falls back to a normal \c mm_file_io_c
+   otherwise, e.g. for special files or if the mapping fails because the
+   file does not fit into the address space.
+*/
+mm_io_cptr
+mm_mmap_io_c::open(const std::string &path) {
+  if (ms_enabled) {
+    try {
+      return mm_io_cptr(new mm_mmap_io_c(path));
+    } catch (mtx::mm_io::open_x &) {
+      mxverb(2, boost::format("mm_mmap_io_c: could not map '%1%'; using normal file I/O\n") % path);
+    }
+  }
+
+  return mm_file_io_c::open(path);
+}
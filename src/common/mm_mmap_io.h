@@ -0,0 +1,71 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions for memory mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_MM_MMAP_IO_H
+#define __MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Read-only access to a file mapped into memory as a whole.
+
+   read_slice() returns memory_c objects that point directly into the
+   mapping instead of copying the data. They share the ownership of the
+   mapping which is therefore only removed once the file has been closed
+   and the last of them has been freed.
+
+   The mapping is private and writable so that code modifying buffers in
+   place works without touching the file.
+*/
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  std::string m_file_name;
+  int m_fd;
+  unsigned char *m_mapping;
+  memory_owner_t m_owner;
+  uint64_t m_size, m_pos;
+
+  static bool ms_enabled;
+
+public:
+  mm_mmap_io_c(const std::string &path);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual void close();
+  virtual bool eof();
+  virtual int64_t get_size();
+
+  virtual std::string get_file_name() const {
+    return m_file_name;
+  }
+
+  virtual memory_cptr read_slice(size_t size);
+
+  static bool is_available();
+  static void enable(bool enabled);
+  static bool is_enabled() {
+    return ms_enabled;
+  }
+  static mm_io_cptr open(const std::string &path);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+};
+
+typedef counted_ptr<mm_mmap_io_c> mm_mmap_io_cptr;
+
+#endif  // __MTX_COMMON_MM_MMAP_IO_H
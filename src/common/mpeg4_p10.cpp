@@ -27,6 +27,7 @@
 #include "common/math.h"
 #include "common/mm_io.h"
 #include "common/mpeg4_p10.h"
+#include "common/start_code.h"
 #include "common/strings/formatting.h"
 
 namespace mpeg4 {
@@ -679,54 +680,61 @@ mpeg4::p10::avc_es_parser_c::discard_actual_frames(bool discard) {
 void
 mpeg4::p10::avc_es_parser_c::add_bytes(unsigned char *buffer,
                                        int size) {
-  memory_slice_cursor_c cursor;
-  int marker_size          = 0;
+  memory_cptr combined;
   int previous_marker_size = 0;
   int previous_pos         = -1;
+  size_t pos               = 0;
 
-  if (m_unparsed_buffer.is_set() && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
+  if (m_unparsed_buffer.is_set() && (0 != m_unparsed_buffer->get_size())) {
+    size_t unparsed_size = m_unparsed_buffer->get_size();
+    combined             = memory_c::alloc(unparsed_size + size);
+    memcpy(combined->get_buffer(),                 m_unparsed_buffer->get_buffer(), unparsed_size);
+    memcpy(combined->get_buffer() + unparsed_size, buffer,                          size);
 
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
+    buffer = combined->get_buffer();
+    size  += unparsed_size;
 
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          memory_cptr nalu(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          handle_nalu(nalu);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
+    // The unparsed data has already been searched for start codes. It
+    // only contains one if it starts with it.
+    if ((4 <= unparsed_size) && (NALU_START_CODE == get_uint32_be(buffer)))
+      previous_marker_size = 4;
+    else if ((3 <= unparsed_size) && (NALU_START_CODE == get_uint24_be(buffer)))
+      previous_marker_size = 3;
 
-      if (!cursor.char_available())
-        break;
+    if (0 != previous_marker_size)
+      previous_pos = 0;
+
+    pos = std::max<size_t>(previous_marker_size, 2 < unparsed_size ? unparsed_size - 2 : 0);
+  }
+
+  while (1) {
+    pos += find_start_code(&buffer[pos], size - pos);
+    if (static_cast<size_t>(size) == pos)
+      break;
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+    // A fourth zero byte belongs to the start code.
+    int marker_size = (0 < pos) && (0 == buffer[pos - 1]) ? 4 : 3;
+    int marker_pos  = pos + 3 - marker_size;
+
+    if (-1 != previous_pos) {
+      int new_size     = marker_pos - previous_pos - previous_marker_size;
+      memory_cptr nalu = memory_c::alloc(new_size);
+      memcpy(nalu->get_buffer(), &buffer[previous_pos + previous_marker_size], new_size);
+      handle_nalu(nalu);
     }
+
+    previous_pos         = marker_pos;
+    previous_marker_size = marker_size;
+    pos                 += 3;
   }
 
   if (-1 == previous_pos)
     previous_pos = 0;
 
-  int new_size = cursor.get_size() - previous_pos;
+  int new_size = size - previous_pos;
   if (0 != new_size) {
-    m_unparsed_buffer = memory_cptr(new memory_c(safemalloc(new_size), new_size, true));
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
+    m_unparsed_buffer = memory_c::alloc(new_size);
+    memcpy(m_unparsed_buffer->get_buffer(), &buffer[previous_pos], new_size);
 
   } else
     m_unparsed_buffer = memory_cptr(NULL);
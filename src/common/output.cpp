@@ -13,6 +13,10 @@
 
 #include "common/common_pch.h"
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
 #include "common/ebml.h"
 #include "common/endian.h"
 #include "common/mm_io.h"
@@ -38,6 +42,8 @@ bool g_suppress_warnings          = false;
 bool g_warning_issued             = false;
 std::string g_stdio_charset;
 static bool s_mm_stdio_redirected = false;
+static boost::mutex s_mxmsg_mutex;
+static boost::thread_specific_ptr<bool> s_mxerror_throws, s_info_suppressed;
 
 charset_converter_cptr g_cc_stdio = charset_converter_cptr(new charset_converter_c);
 counted_ptr<mm_io_c> g_mm_stdio   = counted_ptr<mm_io_c>(new mm_stdio_c);
@@ -58,9 +64,12 @@ mxmsg(unsigned int level,
       std::string message) {
   static bool s_saw_cr_after_nl = false;
 
-  if (g_suppress_info && (MXMSG_INFO == level))
+  if ((MXMSG_INFO == level) && (g_suppress_info || ((NULL != s_info_suppressed.get()) && *s_info_suppressed)))
     return;
 
+  // mkvmerge's readers may run on several threads at the same time.
+  boost::lock_guard<boost::mutex> lock(s_mxmsg_mutex);
+
   if ('\n' == message[0]) {
     message.erase(0, 1);
     g_mm_stdio->puts("\n");
@@ -118,10 +127,32 @@ mxwarn(const std::string &warning) {
 
 void
 mxerror(const std::string &error) {
+  if ((NULL != s_mxerror_throws.get()) && *s_mxerror_throws)
+    throw mtx::mxerror_x(error);
+
   mxmsg(MXMSG_ERROR, error);
   mxexit(2);
 }
 
+/** \brief Lets mxerror() throw instead of terminating the program
+
+   The setting only affects the calling thread. It allows worker
+   threads to report errors from code that uses mxerror() to the thread
+   that started them. The message is not output in that case;
+   mtx::mxerror_x::what() returns it.
+*/
+void
+set_thread_mxerror_throws(bool throws) {
+  s_mxerror_throws.reset(new bool(throws));
+}
+
+/** \brief Suppresses informational messages from the calling thread only
+*/
+void
+set_thread_info_suppressed(bool suppressed) {
+  s_info_suppressed.reset(new bool(suppressed));
+}
+
 void
 mxinfo_fn(const std::string &file_name,
           const std::string &info) {
@@ -57,12 +57,29 @@ mxwarn(const boost::format &warning) {
   mxwarn(warning.str());
 }
 
+namespace mtx {
+  class mxerror_x: public exception {
+  protected:
+    std::string m_message;
+  public:
+    mxerror_x(const std::string &message): m_message(message) { }
+    virtual ~mxerror_x() throw() { }
+
+    virtual const char *what() const throw() {
+      return m_message.c_str();
+    }
+  };
+}
+
 void mxerror(const std::string &error);
 inline void
 mxerror(const boost::format &error) {
   mxerror(error.str());
 }
 
+void set_thread_mxerror_throws(bool throws);
+void set_thread_info_suppressed(bool suppressed);
+
 #define mxverb(level, message)        \
   if (verbose >= level)               \
     mxmsg(MXMSG_INFO, message);
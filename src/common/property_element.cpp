@@ -15,6 +15,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <ebml/EbmlBinary.h>
 #include <ebml/EbmlFloat.h>
 #include <ebml/EbmlSInteger.h>
@@ -36,6 +39,7 @@
 
 std::map<uint32_t, std::vector<property_element_c> > property_element_c::s_properties;
 std::map<uint32_t, std::vector<property_element_c> > property_element_c::s_composed_properties;
+static boost::mutex s_tables_mutex;
 
 property_element_c::property_element_c(const std::string &name,
                                        const EbmlCallbacks &callbacks,
@@ -160,6 +164,10 @@ std::vector<property_element_c> &
 property_element_c::get_table_for(const EbmlCallbacks &master_callbacks,
                                   const EbmlCallbacks *sub_master_callbacks,
                                   bool full_table) {
+  // The tables are built on demand and mkvpropedit can look them up
+  // from several threads.
+  boost::lock_guard<boost::mutex> lock(s_tables_mutex);
+
   if (s_properties.empty())
     init_tables();
 
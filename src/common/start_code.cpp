@@ -0,0 +1,101 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   locating MPEG style start codes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include "common/start_code.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static inline unsigned int
+first_bit_set(uint32_t mask) {
+# if defined(__GNUC__)
+  return __builtin_ctz(mask);
+# else
+  unsigned int bit = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    ++bit;
+  }
+  return bit;
+# endif
+}
+#endif
+
+size_t
+find_start_code(const unsigned char *buffer,
+                size_t size) {
+  if (3 > size)
+    return size;
+
+  // A start code prefix may begin at each offset before 'end'.
+  size_t end = size - 2;
+  size_t pos = 0;
+
+  // Compare a whole block of offsets at once: the first byte and the
+  // second byte must be 0 and the third byte must be 1.
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one  = _mm256_set1_epi8(1);
+
+  while ((pos + 32) <= end) {
+    __m256i first  = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + pos)),     zero);
+    __m256i second = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + pos + 1)), zero);
+    __m256i third  = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + pos + 2)), one);
+    uint32_t mask  = _mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(first, second), third));
+
+    if (mask)
+      return pos + first_bit_set(mask);
+
+    pos += 32;
+  }
+
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one  = _mm_set1_epi8(1);
+
+  while ((pos + 16) <= end) {
+    __m128i first  = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + pos)),     zero);
+    __m128i second = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + pos + 1)), zero);
+    __m128i third  = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + pos + 2)), one);
+    uint32_t mask  = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(first, second), third));
+
+    if (mask)
+      return pos + first_bit_set(mask);
+
+    pos += 16;
+  }
+#endif
+
+  // Look at the third byte first. Unless it is 0 none of the next three
+  // offsets can start a start code prefix if this one doesn't.
+  while (pos < end) {
+    unsigned char third = buffer[pos + 2];
+
+    if (0 == third)
+      ++pos;
+
+    else if ((1 == third) && (0 == buffer[pos]) && (0 == buffer[pos + 1]))
+      return pos;
+
+    else
+      pos += 3;
+  }
+
+  return size;
+}
@@ -0,0 +1,30 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for locating MPEG style start codes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_START_CODE_H
+#define __MTX_COMMON_START_CODE_H
+
+#include "common/os.h"
+
+#include <stddef.h>
+
+/** \brief Finds the next "00 00 01" byte sequence
+
+   Only sequences lying completely inside the buffer are found.
+
+   \return The offset of the first zero byte of the first start code
+     prefix found or \a size if there is none.
+*/
+size_t find_start_code(const unsigned char *buffer, size_t size);
+
+#endif // __MTX_COMMON_START_CODE_H
@@ -21,10 +21,7 @@
 std::string
 format_timecode(int64_t timecode,
                 unsigned int precision) {
-  static boost::format s_bf_format("%|1$02d|:%|2$02d|:%|3$02d|");
-  static boost::format s_bf_decimals(".%|1$09d|");
-
-  std::string result = (s_bf_format
+  std::string result = (boost::format("%|1$02d|:%|2$02d|:%|3$02d|")
                         % (int)( timecode / 60 / 60 / 1000000000)
                         % (int)((timecode      / 60 / 1000000000) % 60)
                         % (int)((timecode           / 1000000000) % 60)).str();
@@ -33,7 +30,7 @@ format_timecode(int64_t timecode,
     precision = 9;
 
   if (precision) {
-    std::string decimals = (s_bf_decimals % (int)(timecode % 1000000000)).str();
+    std::string decimals = (boost::format(".%|1$09d|") % (int)(timecode % 1000000000)).str();
 
     if (decimals.length() > (precision + 1))
       decimals.erase(precision + 1);
@@ -244,11 +241,11 @@ format_paragraph(const std::string &text_to_wrap,
 std::string
 to_hex(const unsigned char *buf,
        size_t size) {
-  static boost::format s_bf_to_hex("0x%|1$02x| ");
+  boost::format bf_to_hex("0x%|1$02x| ");
 
   std::string hex;
   for (size_t idx = 0; idx < size; ++idx)
-    hex += (s_bf_to_hex % static_cast<unsigned int>(buf[idx])).str();
+    hex += (bf_to_hex % static_cast<unsigned int>(buf[idx])).str();
 
   return hex;
 }
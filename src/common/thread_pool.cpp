@@ -0,0 +1,126 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a simple pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "common/thread_pool.h"
+
+thread_pool_task_c::thread_pool_task_c()
+  : m_done(false)
+{
+}
+
+thread_pool_task_c::~thread_pool_task_c() {
+}
+
+void
+thread_pool_task_c::execute() {
+  std::exception_ptr exception;
+
+  try {
+    run();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_exception = exception;
+  m_done      = true;
+  m_cond.notify_all();
+}
+
+bool
+thread_pool_task_c::is_done() {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_done;
+}
+
+void
+thread_pool_task_c::wait() {
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (!m_done)
+    m_cond.wait(lock);
+
+  if (m_exception)
+    std::rethrow_exception(m_exception);
+}
+
+// ------------------------------------------------------------
+
+/** \brief Starts \a num_threads worker threads
+
+   A pool without threads executes each task right away in \c add().
+*/
+thread_pool_c::thread_pool_c(size_t num_threads)
+  : m_stop(false)
+{
+  size_t i;
+  for (i = 0; num_threads > i; ++i)
+    m_threads.create_thread(boost::bind(&thread_pool_c::run, this));
+}
+
+/** \brief Executes all outstanding tasks and stops the threads
+*/
+thread_pool_c::~thread_pool_c() {
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_cond.notify_all();
+  m_threads.join_all();
+}
+
+void
+thread_pool_c::add(thread_pool_task_c &task) {
+  if (0 == m_threads.size()) {
+    task.execute();
+    return;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_tasks.push_back(&task);
+  }
+
+  m_cond.notify_one();
+}
+
+void
+thread_pool_c::run() {
+  while (true) {
+    thread_pool_task_c *task;
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while (m_tasks.empty() && !m_stop)
+        m_cond.wait(lock);
+
+      if (m_tasks.empty())
+        return;
+
+      task = m_tasks.front();
+      m_tasks.pop_front();
+    }
+
+    task->execute();
+  }
+}
+
+size_t
+thread_pool_c::get_num_cores() {
+  return std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+}
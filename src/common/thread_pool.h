@@ -0,0 +1,78 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for a simple pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_THREAD_POOL_H
+#define __MTX_COMMON_THREAD_POOL_H
+
+#include "common/common_pch.h"
+
+#include <deque>
+#include <exception>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/* A unit of work executed by a thread_pool_c. The pool does not own its
+   tasks: whoever adds a task has to keep it alive until wait() has
+   returned. Exceptions thrown by run() are rethrown by wait().
+*/
+class thread_pool_task_c {
+  friend class thread_pool_c;
+
+protected:
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+  bool m_done;
+  std::exception_ptr m_exception;
+
+public:
+  thread_pool_task_c();
+  virtual ~thread_pool_task_c();
+
+  void wait();
+  bool is_done();
+
+protected:
+  virtual void run() = 0;
+
+private:
+  void execute();
+};
+typedef counted_ptr<thread_pool_task_c> thread_pool_task_cptr;
+
+class thread_pool_c {
+protected:
+  std::deque<thread_pool_task_c *> m_tasks;
+  boost::thread_group m_threads;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+  bool m_stop;
+
+public:
+  thread_pool_c(size_t num_threads);
+  ~thread_pool_c();
+
+  void add(thread_pool_task_c &task);
+  size_t get_num_threads() {
+    return m_threads.size();
+  }
+
+  static size_t get_num_cores();
+
+protected:
+  void run();
+};
+typedef counted_ptr<thread_pool_c> thread_pool_cptr;
+
+#endif // __MTX_COMMON_THREAD_POOL_H
@@ -18,7 +18,7 @@
 
 #include <deque>
 
-#include "common/byte_buffer.h"
+#include "common/frame_reassembler.h"
 #include "common/memory.h"
 #include "common/smart_pointers.h"
 
@@ -79,7 +79,7 @@ protected:
     state_synced,
   } m_sync_state;
 
-  byte_buffer_c m_buffer;
+  frame_reassembler_c m_buffer;
   std::deque<truehd_frame_cptr> m_frames;
 
 public:
@@ -15,12 +15,16 @@
 
 #include <cassert>
 #include <boost/range/algorithm.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/recursive_mutex.hpp>
 
 #include "common/hacks.h"
 #include "common/random.h"
 #include "common/unique_numbers.h"
 
 static std::vector<uint32_t> s_random_unique_numbers[4];
+// mkvpropedit processes several files in parallel.
+static boost::recursive_mutex s_mutex;
 
 static void
 assert_valid_category(unique_id_category_e category) {
@@ -29,6 +33,7 @@ assert_valid_category(unique_id_category_e category) {
 
 void
 clear_list_of_unique_uint32(unique_id_category_e category) {
+  boost::lock_guard<boost::recursive_mutex> lock(s_mutex);
   assert((UNIQUE_ALL_IDS <= category) && (UNIQUE_ATTACHMENT_IDS >= category));
 
   if (UNIQUE_ALL_IDS == category) {
@@ -42,6 +47,7 @@ clear_list_of_unique_uint32(unique_id_category_e category) {
 bool
 is_unique_uint32(uint32_t number,
                  unique_id_category_e category) {
+  boost::lock_guard<boost::recursive_mutex> lock(s_mutex);
   assert_valid_category(category);
 
   if (hack_engaged(ENGAGE_NO_VARIABLE_DATA))
@@ -54,6 +60,7 @@ is_unique_uint32(uint32_t number,
 void
 add_unique_uint32(uint32_t number,
                   unique_id_category_e category) {
+  boost::lock_guard<boost::recursive_mutex> lock(s_mutex);
   assert_valid_category(category);
 
   if (hack_engaged(ENGAGE_NO_VARIABLE_DATA))
@@ -65,12 +72,14 @@ add_unique_uint32(uint32_t number,
 void
 remove_unique_uint32(uint32_t number,
                      unique_id_category_e category) {
+  boost::lock_guard<boost::recursive_mutex> lock(s_mutex);
   assert_valid_category(category);
   boost::remove_if(s_random_unique_numbers[category], [=](uint32_t stored_number) { return number == stored_number; });
 }
 
 uint32_t
 create_unique_uint32(unique_id_category_e category) {
+  boost::lock_guard<boost::recursive_mutex> lock(s_mutex);
   assert_valid_category(category);
 
   if (hack_engaged(ENGAGE_NO_VARIABLE_DATA)) {
@@ -19,6 +19,7 @@
 
 #include "common/bit_cursor.h"
 #include "common/endian.h"
+#include "common/start_code.h"
 #include "common/strings/formatting.h"
 #include "common/vc1.h"
 
@@ -298,48 +299,55 @@ vc1::es_parser_c::~es_parser_c() {
 void
 vc1::es_parser_c::add_bytes(unsigned char *buffer,
                             int size) {
-  memory_slice_cursor_c cursor;
-
+  memory_cptr combined;
   int previous_pos            = -1;
   int64_t previous_stream_pos = m_stream_pos;
+  size_t pos                  = 0;
 
-  if (m_unparsed_buffer.is_set() && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
+  if (m_unparsed_buffer.is_set() && (0 != m_unparsed_buffer->get_size())) {
+    size_t unparsed_size = m_unparsed_buffer->get_size();
+    combined             = memory_c::alloc(unparsed_size + size);
+    memcpy(combined->get_buffer(),                 m_unparsed_buffer->get_buffer(), unparsed_size);
+    memcpy(combined->get_buffer() + unparsed_size, buffer,                          size);
 
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker = (1 << 24) | ((unsigned int)cursor.get_char() << 16) | ((unsigned int)cursor.get_char() << 8) | (unsigned int)cursor.get_char();
+    buffer = combined->get_buffer();
+    size  += unparsed_size;
 
-    while (1) {
-      if (vc1::is_marker(marker)) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - 4 - previous_pos;
+    // The unparsed data has already been searched for markers. It only
+    // contains one if it starts with it.
+    if ((4 <= unparsed_size) && vc1::is_marker(get_uint32_be(buffer)))
+      previous_pos = 0;
 
-          memory_cptr packet(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(packet->get_buffer(), previous_pos, new_size);
+    pos = std::max<size_t>(-1 == previous_pos ? 0 : 3, 3 < unparsed_size ? unparsed_size - 3 : 0);
+  }
 
-          handle_packet(packet);
-        }
+  while (1) {
+    pos += find_start_code(&buffer[pos], size - pos);
 
-        previous_pos = cursor.get_position() - 4;
-        m_stream_pos = previous_stream_pos + previous_pos;
-      }
+    // The byte following the start code prefix must be present as well.
+    if (static_cast<size_t>(size) <= (pos + 3))
+      break;
 
-      if (!cursor.char_available())
-        break;
+    if (-1 != previous_pos) {
+      int new_size       = pos - previous_pos;
+      memory_cptr packet = memory_c::alloc(new_size);
+      memcpy(packet->get_buffer(), &buffer[previous_pos], new_size);
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+      handle_packet(packet);
     }
+
+    previous_pos = pos;
+    m_stream_pos = previous_stream_pos + previous_pos;
+    pos         += 3;
   }
 
   if (-1 == previous_pos)
     previous_pos = 0;
 
-  int new_size = cursor.get_size() - previous_pos;
+  int new_size = size - previous_pos;
   if (0 != new_size) {
     memory_cptr new_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(new_unparsed_buffer->get_buffer(), previous_pos, new_size);
+    memcpy(new_unparsed_buffer->get_buffer(), &buffer[previous_pos], new_size);
     m_unparsed_buffer = new_unparsed_buffer;
 
   } else
@@ -52,7 +52,7 @@ extract_cli_parser_c::init_parser() {
   add_information(YT("mkvextract attachments <inname> [options] [AID1:out1 [AID2:out2 ...]]"));
   add_information(YT("mkvextract chapters <inname> [options]"));
   add_information(YT("mkvextract cuesheet <inname> [options]"));
-  add_information(YT("mkvextract timecodes_v2 <inname> [TID1:out1 [TID2:out2 ...]]"));
+  add_information(YT("mkvextract timecodes_v2 <inname> [options] [TID1:out1 [TID2:out2 ...]]"));
   add_information(YT("mkvextract <-h|-V>"));
 
   add_separator();
@@ -72,6 +72,10 @@ extract_cli_parser_c::init_parser() {
   OPT("c=charset",      set_charset,  YT("Convert text subtitles to this charset (default: UTF-8)."));
   OPT("cuesheet",       set_cuesheet, YT("Also try to extract the CUE sheet from the chapter information and tags for this track."));
   OPT("blockadd=level", set_blockadd, YT("Keep only the BlockAdditions up to this level (default: keep all levels)"));
+  OPT("range=start-end", set_range,    YT("Only extract the blocks whose timecodes lie between 'start' (inclusive) and 'end' (exclusive). "
+                                          "Either of them can be left out. Tracks start at their last key frame at or before 'start'. "
+                                          "The index is used for seeking to 'start' if the file contains one. "
+                                          "This option can also be used when extracting timecodes."));
   OPT("raw",            set_raw,      YT("Extract the data to a raw file."));
   OPT("fullraw",        set_fullraw,  YT("Extract the data to a raw file including the CodecPrivate as a header."));
   add_informational_option("TID:out", YT("Write track with the ID TID to the file 'out'."));
@@ -141,6 +145,16 @@ extract_cli_parser_c::set_parse_fully() {
   m_options.m_parse_mode = kax_analyzer_c::parse_mode_full;
 }
 
+void
+extract_cli_parser_c::set_range() {
+  if (   (options_c::em_tracks       != m_options.m_extraction_mode)
+      && (options_c::em_timecodes_v2 != m_options.m_extraction_mode))
+    mxerror(boost::format(Y("'%1%' is only allowed when extracting tracks or timecodes.\n")) % m_current_arg);
+
+  if (!m_options.m_range.parse(m_next_arg))
+    mxerror(boost::format(Y("Invalid timecode range in argument '%1%'.\n")) % m_next_arg);
+}
+
 void
 extract_cli_parser_c::set_charset() {
   assert_mode(options_c::em_tracks);
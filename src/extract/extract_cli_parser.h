@@ -42,6 +42,7 @@ protected:
   void assert_mode(options_c::extraction_mode_e mode);
 
   void set_parse_fully();
+  void set_range();
   void set_charset();
   void set_cuesheet();
   void set_blockadd();
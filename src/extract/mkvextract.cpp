@@ -87,7 +87,7 @@ main(int argc,
   options_c options = extract_cli_parser_c(command_line_utf8(argc, argv)).run();
 
   if (options_c::em_tracks == options.m_extraction_mode) {
-    extract_tracks(options.m_file_name, options.m_tracks);
+    extract_tracks(options.m_file_name, options.m_tracks, options.m_range, options.m_parse_mode);
 
     if (0 == verbose)
       mxinfo(Y("Progress: 100%\n"));
@@ -105,7 +105,7 @@ main(int argc,
     extract_cuesheet(options.m_file_name, options.m_parse_mode);
 
   else if (options_c::em_timecodes_v2 == options.m_extraction_mode)
-    extract_timecodes(options.m_file_name, options.m_tracks, 2);
+    extract_timecodes(options.m_file_name, options.m_tracks, 2, options.m_range, options.m_parse_mode);
 
   else
     usage(2);
@@ -32,6 +32,7 @@ public:
   bool m_simple_chapter_format;
   kax_analyzer_c::parse_mode_e m_parse_mode;
   extraction_mode_e m_extraction_mode;
+  timecode_range_t m_range;
 
   std::vector<track_spec_t> m_tracks;
 
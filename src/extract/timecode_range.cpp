@@ -0,0 +1,190 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   restricting the extraction to a range of timecodes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxInfoData.h>
+
+#include "common/ebml.h"
+#include "common/matroska.h"
+#include "common/strings/parsing.h"
+#include "extract/timecode_range.h"
+
+using namespace libmatroska;
+
+timecode_range_t::timecode_range_t()
+  : start(0)
+  , end(-1)
+{
+}
+
+/** \brief Parses a range given as 'START-END'
+
+   Either part may be left out. Both parts use the formats understood
+   by ::parse_timecode.
+
+   \return \c false if the range is invalid.
+*/
+bool
+timecode_range_t::parse(const std::string &s) {
+  size_t dash_pos = s.find('-');
+  if (std::string::npos == dash_pos)
+    return false;
+
+  std::string start_str = s.substr(0, dash_pos);
+  std::string end_str   = s.substr(dash_pos + 1);
+  int64_t new_start     = 0;
+  int64_t new_end       = -1;
+
+  if (start_str.empty() && end_str.empty())
+    return false;
+
+  if (!start_str.empty() && !parse_timecode(start_str, new_start))
+    return false;
+
+  if (!end_str.empty() && (!parse_timecode(end_str, new_end) || (new_end <= new_start)))
+    return false;
+
+  start = new_start;
+  end   = new_end;
+
+  return true;
+}
+
+range_start_c::range_start_c()
+  : m_started(false)
+{
+}
+
+/** \brief Decides what to do with a track's next frame
+
+   If the frame is the first one inside the range and not a key frame
+   then the frames remembered so far are extracted before this function
+   returns.
+
+   \return \c RANGE_EXTRACT if the frame has to be extracted right away,
+     \c RANGE_REMEMBER if the caller has to pass a copy of it to
+     remember() and \c RANGE_SKIP if it is not needed.
+*/
+range_decision_e
+range_start_c::decide(const timecode_range_t &range,
+                      int64_t timecode,
+                      bool key_frame) {
+  if (0 == range.start)
+    return range.contains(timecode) ? RANGE_EXTRACT : RANGE_SKIP;
+
+  if (range.is_past_end(timecode))
+    return RANGE_SKIP;
+
+  if (m_started)
+    return RANGE_EXTRACT;
+
+  if (range.start <= timecode) {
+    m_started = true;
+
+    if (!key_frame)
+      for (auto &extract : m_remembered)
+        extract();
+
+    m_remembered.clear();
+
+    return RANGE_EXTRACT;
+  }
+
+  // Frames in front of the first key frame cannot be decoded anyway.
+  if (key_frame) {
+    m_remembered.clear();
+    return RANGE_REMEMBER;
+  }
+
+  return m_remembered.empty() ? RANGE_SKIP : RANGE_REMEMBER;
+}
+
+void
+range_start_c::remember(const std::function<void()> &extract) {
+  m_remembered.push_back(extract);
+}
+
+/** \brief Looks up the cluster a range starting at \a timecode has to be read from
+
+   The cue points are read with the help of the kax_analyzer_c. The
+   cluster referenced by the last cue point whose time is not bigger
+   than \a timecode is used.
+
+   \return The cluster's position relative to the start of the
+     segment's data or -1 if the file doesn't contain cues or if no cue
+     point lies before \a timecode.
+*/
+int64_t
+find_cluster_position_for_timecode(const std::string &file_name,
+                                   int64_t timecode,
+                                   kax_analyzer_c::parse_mode_e parse_mode) {
+  kax_analyzer_cptr analyzer;
+
+  try {
+    analyzer = kax_analyzer_cptr(new kax_analyzer_c(file_name));
+    if (!analyzer->process(parse_mode, MODE_READ))
+      return -1;
+  } catch (...) {
+    return -1;
+  }
+
+  uint64_t tc_scale = TIMECODE_SCALE;
+  counted_ptr<EbmlMaster> info(analyzer->read_all(EBML_INFO(KaxInfo)));
+  if (info.is_set()) {
+    KaxTimecodeScale *ktc_scale = FINDFIRST(info.get_object(), KaxTimecodeScale);
+    if (NULL != ktc_scale)
+      tc_scale = uint64(*ktc_scale);
+  }
+
+  counted_ptr<EbmlMaster> cues(analyzer->read_all(EBML_INFO(KaxCues)));
+  if (!cues.is_set())
+    return -1;
+
+  int64_t best_time     = -1;
+  int64_t best_position = -1;
+  size_t i;
+
+  for (i = 0; cues->ListSize() > i; ++i) {
+    KaxCuePoint *cue_point = dynamic_cast<KaxCuePoint *>((*cues)[i]);
+    if (NULL == cue_point)
+      continue;
+
+    KaxCueTime *cue_time = FINDFIRST(cue_point, KaxCueTime);
+    if (NULL == cue_time)
+      continue;
+
+    int64_t time = uint64(*cue_time) * tc_scale;
+    if ((time > timecode) || (time < best_time))
+      continue;
+
+    KaxCueTrackPositions *positions = FINDFIRST(cue_point, KaxCueTrackPositions);
+    while (NULL != positions) {
+      KaxCueClusterPosition *cluster_position = FINDFIRST(positions, KaxCueClusterPosition);
+
+      // Several cue points may share the same time. Use the cluster
+      // coming first in that case.
+      if (   (NULL != cluster_position)
+          && ((time > best_time) || (static_cast<int64_t>(uint64(*cluster_position)) < best_position))) {
+        best_time     = time;
+        best_position = uint64(*cluster_position);
+      }
+
+      positions = FINDNEXT(cue_point, KaxCueTrackPositions, positions);
+    }
+  }
+
+  return best_position;
+}
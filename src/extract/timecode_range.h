@@ -0,0 +1,77 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   restricting the extraction to a range of timecodes
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __EXTRACT_TIMECODE_RANGE_H
+#define __EXTRACT_TIMECODE_RANGE_H
+
+#include "common/os.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common/kax_analyzer.h"
+
+/* The range of timecodes a track or timecode extraction is restricted
+   to. Both values are in nanoseconds. A block is extracted if its
+   timecode is greater than or equal to 'start' and less than 'end'. An
+   'end' of -1 means 'until the end of the file'.
+*/
+struct timecode_range_t {
+  int64_t start, end;
+
+  timecode_range_t();
+
+  bool is_set() const {
+    return (0 < start) || (-1 != end);
+  }
+
+  bool contains(int64_t timecode) const {
+    return (start <= timecode) && ((-1 == end) || (timecode < end));
+  }
+
+  bool is_past_end(int64_t timecode) const {
+    return (-1 != end) && (timecode >= end);
+  }
+
+  bool parse(const std::string &s);
+};
+
+enum range_decision_e {
+  RANGE_SKIP,
+  RANGE_EXTRACT,
+  RANGE_REMEMBER,
+};
+
+/* Makes the extraction of a track start at a key frame. Frames in front
+   of the range's start are remembered from the last key frame on. If the
+   first frame inside the range is not a key frame itself then the
+   remembered frames are extracted before it so that the track can be
+   decoded. From then on all frames are extracted until the end of the
+   range, even those whose timecodes lie before its start (e.g. B
+   frames). One object is used per track.
+*/
+class range_start_c {
+protected:
+  bool m_started;
+  std::vector<std::function<void()> > m_remembered;
+
+public:
+  range_start_c();
+
+  range_decision_e decide(const timecode_range_t &range, int64_t timecode, bool key_frame);
+  void remember(const std::function<void()> &extract);
+};
+
+int64_t find_cluster_position_for_timecode(const std::string &file_name, int64_t timecode, kax_analyzer_c::parse_mode_e parse_mode);
+
+#endif // __EXTRACT_TIMECODE_RANGE_H
@@ -32,6 +32,7 @@
 #include <matroska/KaxTrackEntryData.h>
 
 #include "common/ebml.h"
+#include "common/kax_file.h"
 #include "common/matroska.h"
 #include "common/mm_io.h"
 #include "common/mm_write_cache_io.h"
@@ -46,6 +47,7 @@ struct timecode_extractor_t {
   mm_io_cptr m_file;
   std::vector<int64_t> m_timecodes;
   int64_t m_default_duration;
+  range_start_c m_range_start;
 
   timecode_extractor_t(int64_t tid, const mm_io_cptr &file, int64_t default_duration):
     m_tid(tid), m_file(file), m_default_duration(default_duration) {}
@@ -110,10 +112,26 @@ find_extractor_by_track_number(unsigned int track_number) {
                       [=](timecode_extractor_t &xtr) { return track_number == xtr.m_tid; });
 }
 
+static void
+add_timecode(timecode_extractor_t &extractor,
+             const timecode_range_t &range,
+             int64_t timecode,
+             bool key_frame) {
+  std::vector<int64_t> &timecodes = extractor.m_timecodes;
+  range_decision_e decision       = extractor.m_range_start.decide(range, timecode, key_frame);
+
+  if (RANGE_EXTRACT == decision)
+    timecodes.push_back(timecode);
+
+  else if (RANGE_REMEMBER == decision)
+    extractor.m_range_start.remember([&timecodes, timecode]() { timecodes.push_back(timecode); });
+}
+
 static void
 handle_blockgroup(KaxBlockGroup &blockgroup,
                   KaxCluster &cluster,
-                  int64_t tc_scale) {
+                  int64_t tc_scale,
+                  const timecode_range_t &range) {
   // Only continue if this block group actually contains a block.
   KaxBlock *block = FINDFIRST(&blockgroup, KaxBlock);
   if (NULL == block)
@@ -129,15 +147,20 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
   KaxBlockDuration *kduration = FINDFIRST(&blockgroup, KaxBlockDuration);
   int64_t duration            = NULL == kduration ? extractor->m_default_duration * block->NumberFrames() : uint64(*kduration) * tc_scale;
 
+  bool key_frame = NULL == FINDFIRST(&blockgroup, KaxReferenceBlock);
+
   // Pass the block to the extractor.
   size_t i;
-  for (i = 0; block->NumberFrames() > i; ++i)
-    extractor->m_timecodes.push_back((int64_t)(block->GlobalTimecode() + i * (double)duration / block->NumberFrames()));
+  for (i = 0; block->NumberFrames() > i; ++i) {
+    int64_t timecode = (int64_t)(block->GlobalTimecode() + i * (double)duration / block->NumberFrames());
+    add_timecode(*extractor, range, timecode, key_frame);
+  }
 }
 
 static void
 handle_simpleblock(KaxSimpleBlock &simpleblock,
-                   KaxCluster &cluster) {
+                   KaxCluster &cluster,
+                   const timecode_range_t &range) {
   if (0 == simpleblock.NumberFrames())
     return;
 
@@ -149,26 +172,36 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
 
   // Pass the block to the extractor.
   size_t i;
-  for (i = 0; simpleblock.NumberFrames() > i; ++i)
-    extractor->m_timecodes.push_back((int64_t)(simpleblock.GlobalTimecode() + i * (double)extractor->m_default_duration));
+  for (i = 0; simpleblock.NumberFrames() > i; ++i) {
+    int64_t timecode = (int64_t)(simpleblock.GlobalTimecode() + i * (double)extractor->m_default_duration);
+    add_timecode(*extractor, range, timecode, simpleblock.IsKeyframe());
+  }
 }
 
 void
 extract_timecodes(const std::string &file_name,
                   std::vector<track_spec_t> &tspecs,
-                  int version) {
+                  int version,
+                  const timecode_range_t &range,
+                  kax_analyzer_c::parse_mode_e parse_mode) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
   // open input file
-  mm_io_c *in;
+  mm_io_cptr in;
+  kax_file_cptr file;
   try {
-    in = new mm_file_io_c(file_name, MODE_READ);
+    in   = mm_file_io_c::open(file_name);
+    file = kax_file_cptr(new kax_file_c(in));
   } catch (...) {
     show_error(boost::format(Y("The file '%1%' could not be opened for reading (%2%).\n")) % file_name % strerror(errno));
     return;
   }
 
+  // Look up the cluster to start at before the file is parsed
+  // sequentially so that the analyzer's I/O doesn't interfere.
+  int64_t range_start_pos = 0 < range.start ? find_cluster_position_for_timecode(file_name, range.start, parse_mode) : -1;
+
   try {
     int64_t file_size = in->get_size();
     EbmlStream *es    = new EbmlStream(*in);
@@ -202,46 +235,23 @@ extract_timecodes(const std::string &file_name,
       delete l0;
     }
 
+    if (-1 != range_start_pos)
+      range_start_pos += l0->GetElementPosition() + l0->HeadSize();
+
     bool tracks_found = false;
-    int upper_lvl_el  = 0;
+    EbmlElement *l1   = NULL;
     uint64_t tc_scale = TIMECODE_SCALE;
+    std::set<int64_t> wanted_tracks;
 
-    // We've got our segment, so let's find the tracks
-    EbmlElement *l1   = es->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, 0xFFFFFFFFL, true, 1);
-    EbmlElement *l2   = NULL;
-    EbmlElement *l3   = NULL;
-
-    while ((NULL != l1) && (0 >= upper_lvl_el)) {
+    while (NULL != (l1 = file->read_next_level1_element())) {
       if (EbmlId(*l1) == EBML_ID(KaxInfo)) {
         // General info about this Matroska file
         show_element(l1, 1, Y("Segment information"));
 
-        upper_lvl_el = 0;
-        l2           = es->FindNextElement(EBML_CONTEXT(l1), upper_lvl_el, 0xFFFFFFFFL, true, 1);
-        while ((NULL != l2) && (0 >= upper_lvl_el)) {
-          if (EbmlId(*l2) == EBML_ID(KaxTimecodeScale)) {
-            KaxTimecodeScale &ktc_scale = *static_cast<KaxTimecodeScale *>(l2);
-            ktc_scale.ReadData(es->I_O());
-            tc_scale = uint64(ktc_scale);
-            show_element(l2, 2, boost::format(Y("Timecode scale: %1%")) % tc_scale);
-          } else
-            l2->SkipData(*es, EBML_CONTEXT(l2));
-
-          if (!in_parent(l1)) {
-            delete l2;
-            break;
-          }
-
-          if (0 > upper_lvl_el) {
-            upper_lvl_el++;
-            if (0 > upper_lvl_el)
-              break;
-
-          }
-
-          l2->SkipData(*es, EBML_CONTEXT(l2));
-          delete l2;
-          l2 = es->FindNextElement(EBML_CONTEXT(l1), upper_lvl_el, 0xFFFFFFFFL, true);
+        KaxTimecodeScale *ktc_scale = FINDFIRST(l1, KaxTimecodeScale);
+        if (NULL != ktc_scale) {
+          tc_scale = uint64(*ktc_scale);
+          show_element(ktc_scale, 2, boost::format(Y("Timecode scale: %1%")) % tc_scale);
         }
 
       } else if ((EbmlId(*l1) == EBML_ID(KaxTracks)) && !tracks_found) {
@@ -251,102 +261,68 @@ extract_timecodes(const std::string &file_name,
         show_element(l1, 1, Y("Segment tracks"));
 
         tracks_found = true;
-        l1->Read(*es, EBML_CLASS_CONTEXT(KaxTracks), upper_lvl_el, l2, true);
         find_and_verify_track_uids(*dynamic_cast<KaxTracks *>(l1), tspecs);
         create_timecode_files(*dynamic_cast<KaxTracks *>(l1), tspecs, version);
 
+        // Only the block headers of the wanted tracks are needed.
+        for (auto &extractor : timecode_extractors)
+          wanted_tracks.insert(extractor.m_tid);
+        file->set_wanted_block_tracks(-1 != range_start_pos ? std::set<int64_t>() : wanted_tracks);
+
       } else if (EbmlId(*l1) == EBML_ID(KaxCluster)) {
         show_element(l1, 1, Y("Cluster"));
-        KaxCluster *cluster = (KaxCluster *)l1;
-        uint64_t cluster_tc = 0;
-
-        if (0 == verbose)
-          mxinfo(boost::format(Y("Progress: %1%%%%2%")) % (int)(in->getFilePointer() * 100 / file_size) % "\r");
-
-        upper_lvl_el = 0;
-        l2           = es->FindNextElement(EBML_CONTEXT(l1), upper_lvl_el, 0xFFFFFFFFL, true, 1);
-        while ((NULL != l2) && (0 >= upper_lvl_el)) {
-
-          if (EbmlId(*l2) == EBML_ID(KaxClusterTimecode)) {
-            KaxClusterTimecode &ctc = *static_cast<KaxClusterTimecode *>(l2);
-            ctc.ReadData(es->I_O());
-            cluster_tc = uint64(ctc);
-            show_element(l2, 2, boost::format(Y("Cluster timecode: %|1$.3f|s")) % ((float)cluster_tc * (float)tc_scale / 1000000000.0));
-            cluster->InitTimecode(cluster_tc, tc_scale);
+        KaxCluster *cluster = static_cast<KaxCluster *>(l1);
 
-          } else if (EbmlId(*l2) == EBML_ID(KaxBlockGroup)) {
-            show_element(l2, 2, Y("Block group"));
+        // The first cluster has been read without its blocks. Continue
+        // with the cluster the range starts in or re-read this one.
+        if (-1 != range_start_pos) {
+          int64_t start_pos = std::max(range_start_pos, static_cast<int64_t>(cluster->GetElementPosition()));
+          range_start_pos   = -1;
 
-            l2->Read(*es, EBML_CLASS_CONTEXT(KaxBlockGroup), upper_lvl_el, l3, true);
-            handle_blockgroup(*static_cast<KaxBlockGroup *>(l2), *cluster, tc_scale);
+          show_element(NULL, 1, boost::format(Y("Continuing at the cluster at %1% for the start of the range")) % start_pos);
 
-          } else if (EbmlId(*l2) == EBML_ID(KaxSimpleBlock)) {
-            show_element(l2, 2, Y("Simple block"));
-
-            l2->Read(*es, EBML_CLASS_CONTEXT(KaxSimpleBlock), upper_lvl_el, l3, true);
-            handle_simpleblock(*static_cast<KaxSimpleBlock *>(l2), *cluster);
-
-          } else
-            l2->SkipData(*es, EBML_CONTEXT(l2));
-
-          if (!in_parent(l1)) {
-            delete l2;
-            break;
-          }
-
-          if (0 < upper_lvl_el) {
-            upper_lvl_el--;
-            if (0 < upper_lvl_el)
-              break;
-            delete l2;
-            l2 = l3;
-            continue;
-
-          } else if (0 > upper_lvl_el) {
-            upper_lvl_el++;
-            if (0 > upper_lvl_el)
-              break;
-
-          }
-
-          l2->SkipData(*es, EBML_CONTEXT(l2));
-          delete l2;
-          l2 = es->FindNextElement(EBML_CONTEXT(l1), upper_lvl_el, 0xFFFFFFFFL, true);
-
-        } // while (l2 != NULL)
+          file->set_wanted_block_tracks(wanted_tracks);
+          in->setFilePointer(start_pos);
+          delete l1;
+          continue;
+        }
 
-      } else
-        l1->SkipData(*es, EBML_CONTEXT(l1));
+        if (0 == verbose)
+          mxinfo(boost::format(Y("Progress: %1%%%%2%")) % (int)(in->getFilePointer() * 100 / file_size) % "\r");
 
-      if (!in_parent(l0)) {
-        delete l1;
-        break;
-      }
+        KaxClusterTimecode *ctc = FINDFIRST(l1, KaxClusterTimecode);
+        if (NULL != ctc) {
+          uint64_t cluster_tc = uint64(*ctc);
+          show_element(ctc, 2, boost::format(Y("Cluster timecode: %|1$.3f|s")) % ((float)cluster_tc * (float)tc_scale / 1000000000.0));
+          cluster->InitTimecode(cluster_tc, tc_scale);
+        } else
+          cluster->InitTimecode(0, tc_scale);
 
-      if (0 < upper_lvl_el) {
-        upper_lvl_el--;
-        if (0 < upper_lvl_el)
+        if (range.is_past_end(cluster->GlobalTimecode())) {
+          delete l1;
           break;
-        delete l1;
-        l1 = l2;
-        continue;
+        }
 
-      } else if (0 > upper_lvl_el) {
-        upper_lvl_el++;
-        if (0 > upper_lvl_el)
-          break;
+        size_t i;
+        for (i = 0; cluster->ListSize() > i; ++i) {
+          EbmlElement *el = (*cluster)[i];
+          if (EbmlId(*el) == EBML_ID(KaxBlockGroup)) {
+            show_element(el, 2, Y("Block group"));
+            handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, tc_scale, range);
 
+          } else if (EbmlId(*el) == EBML_ID(KaxSimpleBlock)) {
+            show_element(el, 2, Y("Simple block"));
+            handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster, range);
+          }
+        }
       }
 
-      l1->SkipData(*es, EBML_CONTEXT(l1));
       delete l1;
-      l1 = es->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, 0xFFFFFFFFL, true);
 
     } // while (l1 != NULL)
 
     delete l0;
     delete es;
-    delete in;
 
     close_timecode_files();
 
@@ -355,7 +331,6 @@ extract_timecodes(const std::string &file_name,
 
   } catch (...) {
     show_error(Y("Caught exception"));
-    delete in;
 
     close_timecode_files();
   }
@@ -26,6 +26,7 @@
 #include <matroska/KaxClusterData.h>
 #include <matroska/KaxInfo.h>
 #include <matroska/KaxInfoData.h>
+#include <matroska/KaxSeekHead.h>
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxTracks.h>
 #include <matroska/KaxTrackEntryData.h>
@@ -43,6 +44,7 @@
 using namespace libmatroska;
 
 static std::vector<xtr_base_c *> extractors;
+static std::map<int64_t, range_start_c> s_range_starts;
 
 // ------------------------------------------------------------------------
 
@@ -119,7 +121,8 @@ create_extractors(KaxTracks &kax_tracks,
 static void
 handle_blockgroup(KaxBlockGroup &blockgroup,
                   KaxCluster &cluster,
-                  int64_t tc_scale) {
+                  int64_t tc_scale,
+                  const timecode_range_t &range) {
   // Only continue if this block group actually contains a block.
   KaxBlock *block = FINDFIRST(&blockgroup, KaxBlock);
   if ((NULL == block) || (0 == block->NumberFrames()))
@@ -178,7 +181,23 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
       this_duration = duration / block->NumberFrames();
     }
 
+    range_start_c &range_start = s_range_starts[extractor->m_tid];
+    range_decision_e decision  = range_start.decide(range, this_timecode, (0 == bref) && (0 == fref));
+    if (RANGE_SKIP == decision)
+      continue;
+
     DataBuffer &data = block->GetBuffer(i);
+
+    // The block's buffers are gone once the extractor gets remembered frames.
+    if (RANGE_REMEMBER == decision) {
+      memory_cptr frame = clone_memory(data.Buffer(), data.Size());
+      counted_ptr<KaxBlockAdditions> additions(NULL == kadditions ? NULL : static_cast<KaxBlockAdditions *>(kadditions->Clone()));
+      range_start.remember([=]() mutable {
+        extractor->handle_frame(frame, additions.get_object(), this_timecode, this_duration, bref, fref, false, false, true);
+      });
+      continue;
+    }
+
     memory_cptr frame(new memory_c(data.Buffer(), data.Size(), false));
     extractor->handle_frame(frame, kadditions, this_timecode, this_duration, bref, fref, false, false, true);
   }
@@ -186,7 +205,8 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
 
 static void
 handle_simpleblock(KaxSimpleBlock &simpleblock,
-                   KaxCluster &cluster) {
+                   KaxCluster &cluster,
+                   const timecode_range_t &range) {
   if (0 == simpleblock.NumberFrames())
     return;
 
@@ -217,9 +237,25 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
       this_duration = duration / simpleblock.NumberFrames();
     }
 
+    range_start_c &range_start = s_range_starts[extractor->m_tid];
+    range_decision_e decision  = range_start.decide(range, this_timecode, simpleblock.IsKeyframe());
+    if (RANGE_SKIP == decision)
+      continue;
+
     DataBuffer &data = simpleblock.GetBuffer(i);
+    bool key_frame   = simpleblock.IsKeyframe();
+    bool discardable = simpleblock.IsDiscardable();
+
+    if (RANGE_REMEMBER == decision) {
+      memory_cptr frame = clone_memory(data.Buffer(), data.Size());
+      range_start.remember([=]() mutable {
+        extractor->handle_frame(frame, NULL, this_timecode, this_duration, -1, -1, key_frame, discardable, false);
+      });
+      continue;
+    }
+
     memory_cptr frame(new memory_c(data.Buffer(), data.Size(), false));
-    extractor->handle_frame(frame, NULL, this_timecode, this_duration, -1, -1, simpleblock.IsKeyframe(), simpleblock.IsDiscardable(), false);
+    extractor->handle_frame(frame, NULL, this_timecode, this_duration, -1, -1, key_frame, discardable, false);
   }
 }
 
@@ -241,6 +277,7 @@ close_extractors() {
   }
 
   extractors.clear();
+  s_range_starts.clear();
 }
 
 static void
@@ -311,7 +348,9 @@ find_and_verify_track_uids(KaxTracks &tracks,
 
 bool
 extract_tracks(const std::string &file_name,
-               std::vector<track_spec_t> &tspecs) {
+               std::vector<track_spec_t> &tspecs,
+               const timecode_range_t &range,
+               kax_analyzer_c::parse_mode_e parse_mode) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
@@ -328,6 +367,10 @@ extract_tracks(const std::string &file_name,
 
   int64_t file_size = in->get_size();
 
+  // Look up the cluster to start at before the file is parsed
+  // sequentially so that the analyzer's I/O doesn't interfere.
+  int64_t range_start_pos = 0 < range.start ? find_cluster_position_for_timecode(file_name, range.start, parse_mode) : -1;
+
   try {
     EbmlStream *es = new EbmlStream(*in);
 
@@ -362,9 +405,15 @@ extract_tracks(const std::string &file_name,
       delete l0;
     }
 
+    if (-1 != range_start_pos)
+      range_start_pos += l0->GetElementPosition() + l0->HeadSize();
+
     bool tracks_found = false;
     EbmlElement *l1   = NULL;
     uint64_t tc_scale = TIMECODE_SCALE;
+    std::set<int64_t> wanted_tracks;
+    std::vector<int64_t> tags_and_chapters_positions;
+    bool past_range_end = false;
 
     KaxChapters all_chapters;
     KaxTags all_tags;
@@ -380,6 +429,27 @@ extract_tracks(const std::string &file_name,
           show_element(ktc_scale, 2, boost::format(Y("Timecode scale: %1%")) % tc_scale);
         }
 
+      } else if (EbmlId(*l1) == EBML_ID(KaxSeekHead)) {
+        // Remember where the chapters and tags are so that the clusters
+        // after the end of the range can be skipped over.
+        KaxSeekHead &seek_head = *static_cast<KaxSeekHead *>(l1);
+        size_t i;
+
+        for (i = 0; seek_head.ListSize() > i; ++i) {
+          KaxSeek *seek = dynamic_cast<KaxSeek *>(seek_head[i]);
+          if (NULL == seek)
+            continue;
+
+          KaxSeekID *seek_id        = FINDFIRST(seek, KaxSeekID);
+          KaxSeekPosition *seek_pos = FINDFIRST(seek, KaxSeekPosition);
+          if ((NULL == seek_id) || (NULL == seek_pos))
+            continue;
+
+          EbmlId id(seek_id->GetBuffer(), seek_id->GetSize());
+          if ((id == EBML_ID(KaxTags)) || (id == EBML_ID(KaxChapters)))
+            tags_and_chapters_positions.push_back(static_cast<KaxSegment *>(l0)->GetGlobalPosition(uint64(*seek_pos)));
+        }
+
       } else if ((EbmlId(*l1) == EBML_ID(KaxTracks)) && !tracks_found) {
 
         // Yep, we've found our KaxTracks element. Now find all tracks
@@ -390,10 +460,36 @@ extract_tracks(const std::string &file_name,
         find_and_verify_track_uids(*dynamic_cast<KaxTracks *>(l1), tspecs);
         create_extractors(*dynamic_cast<KaxTracks *>(l1), tspecs);
 
+        // Don't bother reading the frames of tracks that aren't extracted.
+        // If the first cluster is going to be skipped over then none of
+        // its frames are needed.
+        for (auto extractor : extractors)
+          wanted_tracks.insert(extractor->m_tid);
+        file->set_wanted_block_tracks(-1 != range_start_pos ? std::set<int64_t>() : wanted_tracks);
+
       } else if (EbmlId(*l1) == EBML_ID(KaxCluster)) {
+        if (past_range_end) {
+          delete l1;
+          continue;
+        }
+
         show_element(l1, 1, Y("Cluster"));
         KaxCluster *cluster = static_cast<KaxCluster *>(l1);
 
+        // The first cluster has been read without its frames. Continue
+        // with the cluster the range starts in or re-read this one.
+        if (-1 != range_start_pos) {
+          int64_t start_pos = std::max(range_start_pos, static_cast<int64_t>(cluster->GetElementPosition()));
+          range_start_pos   = -1;
+
+          show_element(NULL, 1, boost::format(Y("Continuing at the cluster at %1% for the start of the range")) % start_pos);
+
+          file->set_wanted_block_tracks(wanted_tracks);
+          in->setFilePointer(start_pos);
+          delete l1;
+          continue;
+        }
+
         if (0 == verbose)
           mxinfo(boost::format(Y("Progress: %1%%%%2%")) % (int)(in->getFilePointer() * 100 / file_size) % "\r");
 
@@ -405,16 +501,38 @@ extract_tracks(const std::string &file_name,
         } else
           cluster->InitTimecode(0, tc_scale);
 
+        // The chapters and tags following the clusters are still needed
+        // for the CUE sheets. Read the remaining clusters without their
+        // frames, or jump directly to the chapters and tags if the seek
+        // head knows where they are.
+        if (range.is_past_end(cluster->GlobalTimecode())) {
+          past_range_end = true;
+          file->set_wanted_block_tracks(std::set<int64_t>());
+
+          int64_t next_pos = -1;
+          for (auto pos : tags_and_chapters_positions)
+            if ((pos > static_cast<int64_t>(cluster->GetElementPosition())) && ((-1 == next_pos) || (pos < next_pos)))
+              next_pos = pos;
+
+          if (-1 != next_pos) {
+            show_element(NULL, 1, boost::format(Y("Continuing at the element at %1% after the end of the range")) % next_pos);
+            in->setFilePointer(next_pos);
+          }
+
+          delete l1;
+          continue;
+        }
+
         size_t i;
         for (i = 0; cluster->ListSize() > i; ++i) {
           EbmlElement *el = (*cluster)[i];
           if (EbmlId(*el) == EBML_ID(KaxBlockGroup)) {
             show_element(el, 2, Y("Block group"));
-            handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, tc_scale);
+            handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, tc_scale, range);
 
           } else if (EbmlId(*el) == EBML_ID(KaxSimpleBlock)) {
             show_element(el, 2, Y("SimpleBlock"));
-            handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster);
+            handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster, range);
           }
         }
 
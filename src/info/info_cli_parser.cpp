@@ -49,6 +49,7 @@ info_cli_parser_c::init_parser() {
   OPT("x|hexdump",      set_hexdump,      YT("Show the first 16 bytes of each frame as a hex dump."));
   OPT("X|full-hexdump", set_full_hexdump, YT("Show all bytes of each frame as a hex dump."));
   OPT("z|size",         set_size,         YT("Show the size of each element including its header."));
+  OPT("j|jobs=<n>",     set_jobs,         YT("Process the clusters with up to n threads in summary mode (default: the number of CPU cores)."));
 
   add_common_options();
 
@@ -106,6 +107,12 @@ info_cli_parser_c::set_track_info() {
     verbose = 1;
 }
 
+void
+info_cli_parser_c::set_jobs() {
+  if (!parse_int(m_next_arg, m_options.m_jobs) || (1 > m_options.m_jobs))
+    mxerror(boost::format(Y("Invalid number of threads in '%1% %2%'.\n")) % m_current_arg % m_next_arg);
+}
+
 void
 info_cli_parser_c::set_file_name() {
   if (!m_options.m_file_name.empty())
@@ -41,6 +41,7 @@ protected:
   void set_size();
   void set_file_name();
   void set_track_info();
+  void set_jobs();
 };
 
 #endif // __INFO_INFO_CLI_PARSER_H
@@ -28,7 +28,9 @@
 #endif
 
 #include <algorithm>
+#include <boost/thread/tss.hpp>
 #include <iostream>
+#include <numeric>
 #include <typeinfo>
 
 #include <avilib.h>
@@ -66,6 +68,7 @@
 #define MATROSKA_VERSION 2
 #endif
 
+#include "common/at_scope_exit.h"
 #include "common/chapters/chapters.h"
 #include "common/checksums.h"
 #include "common/command_line.h"
@@ -77,8 +80,10 @@
 #include "common/stereo_mode.h"
 #include "common/strings/editing.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 #include "common/translation.h"
 #include "common/version.h"
+#include "common/vint.h"
 #include "common/xml/element_mapping.h"
 #include "info/mkvinfo.h"
 #include "info/info_cli_parser.h"
@@ -134,11 +139,39 @@ std::vector<kax_track_cptr> s_tracks;
 std::map<unsigned int, kax_track_cptr> s_tracks_by_number;
 std::map<unsigned int, track_info_t> s_track_info;
 options_c g_options;
+
+/* The numbers collected for a single block that are merged into the
+   track's statistics.
+*/
+struct block_stats_t {
+  unsigned int m_track_num;
+  int64_t m_timecode, m_size, m_num_frames;
+  float m_duration;
+  int m_ref_num;
+  bool m_simple_block;
+};
+
+/* A range of consecutive clusters processed by a worker thread in
+   summary mode. The summary lines and the block statistics are kept
+   until all preceding ranges have been output so that the result is
+   the same as if the clusters had been processed one after the other.
+*/
+struct cluster_range_t {
+  std::vector<int64_t> m_positions;
+  std::string m_summary;
+  std::vector<block_stats_t> m_block_stats;
+};
+
+static void dont_delete_cluster_range(cluster_range_t *) { }
+static boost::thread_specific_ptr<cluster_range_t> s_current_cluster_range(dont_delete_cluster_range);
+
+static const size_t s_clusters_per_range        = 16;
+static const size_t s_cluster_ranges_per_thread = 4;
 static uint64_t s_tc_scale = TIMECODE_SCALE;
-std::vector<boost::format> g_common_boost_formats;
+static boost::thread_specific_ptr<std::vector<boost::format> > s_common_boost_formats;
 
-#define BF_DO(n)                             g_common_boost_formats[n]
-#define BF_ADD(s)                            g_common_boost_formats.push_back(boost::format(s))
+#define BF_DO(n)                             common_boost_formats()[n]
+#define BF_ADD(s)                            formats.push_back(boost::format(s))
 #define BF_SHOW_UNKNOWN_ELEMENT              BF_DO( 0)
 #define BF_EBMLVOID                          BF_DO( 1)
 #define BF_FORMAT_BINARY_1                   BF_DO( 2)
@@ -176,8 +209,8 @@ std::vector<boost::format> g_common_boost_formats;
 #define BF_AT                                BF_DO(31)
 #define BF_SIZE                              BF_DO(32)
 
-void
-init_common_boost_formats() {
+static void
+init_common_boost_formats(std::vector<boost::format> &formats) {
   BF_ADD(Y("(Unknown element: %1%; ID: 0x%2% size: %3%)"));                                                     //  0 -- BF_SHOW_UNKNOWN_ELEMENT
   BF_ADD(Y("EbmlVoid (size: %1%)"));                                                                            //  1 -- BF_EBMLVOID
   BF_ADD(Y("length %1%, data: %2%"));                                                                           //  2 -- BF_FORMAT_BINARY_1
@@ -213,6 +246,24 @@ init_common_boost_formats() {
   BF_ADD(Y(" size %1%"));                                                                                       // 32 -- BF_SIZE
 }
 
+/** \brief Returns the formats used by the current thread
+
+   boost::format objects cannot be shared between threads. Each thread
+   gets its own set of formats the first time it needs one.
+*/
+static std::vector<boost::format> &
+common_boost_formats() {
+  std::vector<boost::format> *formats = s_common_boost_formats.get();
+
+  if (NULL == formats) {
+    formats = new std::vector<boost::format>;
+    init_common_boost_formats(*formats);
+    s_common_boost_formats.reset(formats);
+  }
+
+  return *formats;
+}
+
 std::string
 create_element_text(const std::string &text,
                     int64_t position,
@@ -256,12 +307,12 @@ static void
 _show_unknown_element(EbmlStream *es,
                       EbmlElement *e,
                       int level) {
-  static boost::format s_bf_show_unknown_element("%|1$02x|");
+  boost::format bf_show_unknown_element("%|1$02x|");
 
   int i;
   std::string element_id;
   for (i = EBML_ID_LENGTH(static_cast<const EbmlId &>(*e)) - 1; 0 <= i; --i)
-    element_id += (s_bf_show_unknown_element % ((EBML_ID_VALUE(static_cast<const EbmlId &>(*e)) >> (i * 8)) & 0xff)).str();
+    element_id += (bf_show_unknown_element % ((EBML_ID_VALUE(static_cast<const EbmlId &>(*e)) >> (i * 8)) & 0xff)).str();
 
   std::string s = (BF_SHOW_UNKNOWN_ELEMENT % EBML_NAME(e) % element_id % (e->GetSize() + e->HeadSize())).str();
   _show_element(e, es, true, level, s);
@@ -309,14 +360,14 @@ _show_element(EbmlElement *l,
 static std::string
 create_hexdump(const unsigned char *buf,
                int size) {
-  static boost::format s_bf_create_hexdump(" %|1$02x|");
+  boost::format bf_create_hexdump(" %|1$02x|");
 
   std::string hex(" hexdump");
   int bmax = std::min(size, g_options.m_hexdump_max_size);
   int b;
 
   for (b = 0; b < bmax; ++b)
-    hex += (s_bf_create_hexdump % static_cast<int>(buf[b])).str();
+    hex += (bf_create_hexdump % static_cast<int>(buf[b])).str();
 
   return hex;
 }
@@ -1343,6 +1394,60 @@ handle_silent_track(EbmlStream *&es,
   }
 }
 
+/** \brief Outputs a summary line
+
+   Worker threads collect the lines in their cluster range instead.
+*/
+static void
+show_summary(const boost::format &summary) {
+  cluster_range_t *range = s_current_cluster_range.get();
+
+  if (NULL != range)
+    range->m_summary += summary.str();
+  else
+    mxinfo(summary);
+}
+
+static void
+add_block_stats(const block_stats_t &stats) {
+  track_info_t &tinfo = s_track_info[stats.m_track_num];
+
+  tinfo.m_blocks                             += stats.m_num_frames;
+  tinfo.m_blocks_by_ref_num[stats.m_ref_num] += stats.m_num_frames;
+  tinfo.m_min_timecode                        = std::min(tinfo.m_min_timecode, stats.m_timecode);
+  tinfo.m_size                               += stats.m_size;
+
+  if (stats.m_simple_block) {
+    tinfo.m_max_timecode                      = std::max(tinfo.m_min_timecode, stats.m_timecode);
+    tinfo.m_add_duration_for_n_packets        = stats.m_num_frames;
+
+  } else if (tinfo.max_timecode_unset() || (tinfo.m_max_timecode < stats.m_timecode)) {
+    tinfo.m_max_timecode = stats.m_timecode;
+
+    if (-1 == stats.m_duration)
+      tinfo.m_add_duration_for_n_packets  = stats.m_num_frames;
+    else {
+      tinfo.m_max_timecode               += stats.m_duration * 1000000.0;
+      tinfo.m_add_duration_for_n_packets  = 0;
+    }
+  }
+}
+
+/** \brief Adds a block to its track's statistics
+
+   Worker threads collect the statistics in their cluster range. They
+   are merged in file order later.
+*/
+static void
+collect_block_stats(const block_stats_t &stats) {
+  cluster_range_t *range = s_current_cluster_range.get();
+
+  if (NULL != range)
+    range->m_block_stats.push_back(stats);
+  else
+    add_block_stats(stats);
+}
+
 void
 handle_block_group(EbmlStream *&es,
                    EbmlElement *&l2,
@@ -1539,7 +1644,7 @@ handle_block_group(EbmlStream *&es,
       }
 
       if (bduration != -1.0)
-        mxinfo(BF_BLOCK_GROUP_SUMMARY_WITH_DURATION
+        show_summary(BF_BLOCK_GROUP_SUMMARY_WITH_DURATION
                % (bref_found && fref_found ? 'B' : bref_found ? 'P' : !fref_found ? 'I' : 'P')
                % lf_tnum
                % (lf_timecode / 1000000)
@@ -1550,7 +1655,7 @@ handle_block_group(EbmlStream *&es,
                % frame_hexdumps[fidx]
                % position);
       else
-        mxinfo(BF_BLOCK_GROUP_SUMMARY_NO_DURATION
+        show_summary(BF_BLOCK_GROUP_SUMMARY_NO_DURATION
                % (bref_found && fref_found ? 'B' : bref_found ? 'P' : !fref_found ? 'I' : 'P')
                % lf_tnum
                % (lf_timecode / 1000000)
@@ -1568,26 +1673,16 @@ handle_block_group(EbmlStream *&es,
                  % lf_tnum
                  % (lf_timecode / 1000000));
 
-  track_info_t &tinfo = s_track_info[lf_tnum];
-
-  tinfo.m_blocks                                                                                 += frame_sizes.size();
-  tinfo.m_blocks_by_ref_num[bref_found && fref_found ? 2 : bref_found ? 1 : !fref_found ? 0 : 1] += frame_sizes.size();
-  tinfo.m_min_timecode                                                                             = std::min(tinfo.m_min_timecode, lf_timecode);
+  block_stats_t stats;
+  stats.m_track_num    = lf_tnum;
+  stats.m_timecode     = lf_timecode;
+  stats.m_size         = std::accumulate(frame_sizes.begin(), frame_sizes.end(), 0ll);
+  stats.m_num_frames   = frame_sizes.size();
+  stats.m_duration     = bduration;
+  stats.m_ref_num      = bref_found && fref_found ? 2 : bref_found ? 1 : !fref_found ? 0 : 1;
+  stats.m_simple_block = false;
 
-  if (tinfo.max_timecode_unset() || (tinfo.m_max_timecode < lf_timecode)) {
-    tinfo.m_max_timecode = lf_timecode;
-
-    if (-1 == bduration)
-      tinfo.m_add_duration_for_n_packets  = frame_sizes.size();
-    else {
-      tinfo.m_max_timecode               += bduration * 1000000.0;
-      tinfo.m_add_duration_for_n_packets  = 0;
-    }
-  }
-
-  size_t fidx;
-  for (fidx = 0; fidx < frame_sizes.size(); fidx++)
-    tinfo.m_size += frame_sizes[fidx];
+  collect_block_stats(stats);
 }
 
 void
@@ -1602,7 +1697,6 @@ handle_simple_block(EbmlStream *&es,
 
   int64_t frame_pos   = block.GetElementPosition() + block.ElementSize();
   uint64_t timecode   = block.GlobalTimecode() / 1000000;
-  track_info_t &tinfo = s_track_info[block.TrackNum()];
 
   std::string info;
   if (block.IsKeyframe())
@@ -1623,8 +1717,6 @@ handle_simple_block(EbmlStream *&es,
     DataBuffer &data = block.GetBuffer(i);
     uint32_t adler   = calc_adler32(data.Buffer(), data.Size());
 
-    tinfo.m_size += data.Size();
-
     std::string adler_str;
     if (g_options.m_calc_checksums)
       adler_str = (BF_SIMPLE_BLOCK_ADLER % adler).str();
@@ -1650,7 +1742,7 @@ handle_simple_block(EbmlStream *&es,
         frame_pos += frame_sizes[fidx];
       }
 
-      mxinfo(BF_SIMPLE_BLOCK_SUMMARY
+      show_summary(BF_SIMPLE_BLOCK_SUMMARY
              % (block.IsKeyframe() ? 'I' : block.IsDiscardable() ? 'B' : 'P')
              % block.TrackNum()
              % timecode
@@ -1667,15 +1759,16 @@ handle_simple_block(EbmlStream *&es,
                  % block.TrackNum()
                  % timecode);
 
-  tinfo.m_blocks                                                                    += block.NumberFrames();
-  tinfo.m_blocks_by_ref_num[block.IsKeyframe() ? 0 : block.IsDiscardable() ? 2 : 1] += block.NumberFrames();
-  tinfo.m_min_timecode                                                                = std::min(tinfo.m_min_timecode, static_cast<int64_t>(block.GlobalTimecode()));
-  tinfo.m_max_timecode                                                                = std::max(tinfo.m_min_timecode, static_cast<int64_t>(block.GlobalTimecode()));
-  tinfo.m_add_duration_for_n_packets                                                  = block.NumberFrames();
+  block_stats_t stats;
+  stats.m_track_num    = block.TrackNum();
+  stats.m_timecode     = block.GlobalTimecode();
+  stats.m_size         = std::accumulate(frame_sizes.begin(), frame_sizes.end(), 0ll);
+  stats.m_num_frames   = block.NumberFrames();
+  stats.m_duration     = -1.0;
+  stats.m_ref_num      = block.IsKeyframe() ? 0 : block.IsDiscardable() ? 2 : 1;
+  stats.m_simple_block = true;
 
-  size_t fidx;
-  for (fidx = 0; fidx < frame_sizes.size(); fidx++)
-    tinfo.m_size += frame_sizes[fidx];
+  collect_block_stats(stats);
 }
 
 void
@@ -1903,6 +1996,150 @@ display_track_info() {
   }
 }
 
+/* Processes a range of clusters in summary mode. Each task reads the
+   file with its own file handle and EBML stream.
+*/
+class cluster_range_task_c: public thread_pool_task_c {
+public:
+  std::string m_file_name;
+  uint64_t m_file_size;
+  cluster_range_t m_range;
+
+public:
+  cluster_range_task_c(const std::string &file_name, uint64_t file_size);
+
+protected:
+  virtual void run();
+};
+typedef counted_ptr<cluster_range_task_c> cluster_range_task_cptr;
+
+cluster_range_task_c::cluster_range_task_c(const std::string &file_name,
+                                           uint64_t file_size)
+  : m_file_name(file_name)
+  , m_file_size(file_size)
+{
+}
+
+void
+cluster_range_task_c::run() {
+  EbmlElement *l1 = NULL, *l2 = NULL, *l3 = NULL, *l4 = NULL, *l5 = NULL;
+  KaxCluster *cluster;
+  int upper_lvl_el;
+
+  mm_io_cptr in  = mm_file_io_c::open(m_file_name);
+  EbmlStream *es = new EbmlStream(*in);
+
+  s_current_cluster_range.reset(&m_range);
+  at_scope_exit_c cleanup([&]() {
+      s_current_cluster_range.reset();
+      delete es;
+    });
+
+  for (auto position : m_range.m_positions) {
+    in->setFilePointer(position);
+
+    upper_lvl_el = 0;
+    l1           = es->FindNextElement(EBML_CLASS_CONTEXT(KaxSegment), upper_lvl_el, 0xFFFFFFFFL, true);
+    if (NULL == l1)
+      throw false;
+
+    counted_ptr<EbmlElement> af_l1(l1);
+    handle_cluster(es, upper_lvl_el, l1, l2, l3, l4, l5, cluster, m_file_size);
+  }
+}
+
+static thread_pool_cptr
+create_cluster_thread_pool() {
+  if (!g_options.m_show_summary || g_options.m_use_gui)
+    return thread_pool_cptr();
+
+  size_t num_threads = 0 < g_options.m_jobs ? g_options.m_jobs : thread_pool_c::get_num_cores();
+
+  return 1 < num_threads ? thread_pool_cptr(new thread_pool_c(num_threads)) : thread_pool_cptr();
+}
+
+/** \brief Remembers the position of the next cluster and skips it
+
+   Only the cluster's ID and size are read. Returns \c false and leaves
+   the file position unchanged if the next element is not a cluster
+   whose size is known and which ends inside the file. Such elements are
+   handled the usual way.
+*/
+static bool
+skip_cluster(mm_io_cptr &in,
+             uint64_t file_size,
+             std::vector<int64_t> &positions) {
+  int64_t position = in->getFilePointer();
+
+  try {
+    vint_c id   = vint_c::read_ebml_id(in);
+    vint_c size = vint_c::read(in);
+
+    if (   id.is_valid()   && (EBML_ID_VALUE(EBML_ID(KaxCluster)) == id.m_value)
+        && size.is_valid() && !size.is_unknown()
+        && ((in->getFilePointer() + size.m_value) <= file_size)) {
+      positions.push_back(position);
+      in->setFilePointer(in->getFilePointer() + size.m_value);
+
+      return true;
+    }
+  } catch (...) {
+  }
+
+  in->setFilePointer(position);
+
+  return false;
+}
+
+/** \brief Processes the clusters found by skip_cluster()
+
+   The clusters are split into ranges of consecutive clusters which are
+   processed by the thread pool. The summary lines and the track
+   statistics are output and merged in file order.
+*/
+static void
+process_cluster_ranges(thread_pool_c &pool,
+                       const std::string &file_name,
+                       uint64_t file_size,
+                       std::vector<int64_t> &positions) {
+  std::vector<cluster_range_task_cptr> tasks;
+
+  for (size_t start = 0; positions.size() > start; start += s_clusters_per_range) {
+    cluster_range_task_cptr task(new cluster_range_task_c(file_name, file_size));
+    task->m_range.m_positions.assign(positions.begin() + start, positions.begin() + std::min(start + s_clusters_per_range, positions.size()));
+
+    tasks.push_back(task);
+    pool.add(*task);
+  }
+
+  positions.clear();
+
+  // All tasks must have finished before they can be destroyed, even if
+  // one of them has failed.
+  std::exception_ptr error;
+
+  for (auto &task : tasks) {
+    try {
+      task->wait();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+
+    if (error)
+      continue;
+
+    if (!task->m_range.m_summary.empty())
+      mxinfo(task->m_range.m_summary);
+
+    for (auto &stats : task->m_range.m_block_stats)
+      add_block_stats(stats);
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
 bool
 process_file(const std::string &file_name) {
   int upper_lvl_el;
@@ -1968,7 +2205,30 @@ process_file(const std::string &file_name) {
 
     kax_file_cptr kax_file = kax_file_cptr(new kax_file_c(in));
 
-    while (NULL != (l1 = kax_file->read_next_level1_element())) {
+    // In summary mode the clusters can be processed by several threads.
+    // The clusters are only located here. They're processed in batches
+    // whenever another element is found or enough clusters have been
+    // located.
+    thread_pool_cptr pool = create_cluster_thread_pool();
+    std::vector<int64_t> cluster_positions;
+    size_t max_batch_size = pool.is_set() ? pool->get_num_threads() * s_cluster_ranges_per_thread * s_clusters_per_range : 0;
+
+    while (1) {
+      if (pool.is_set()) {
+        if (skip_cluster(in, file_size, cluster_positions)) {
+          if (cluster_positions.size() >= max_batch_size)
+            process_cluster_ranges(*pool, file_name, file_size, cluster_positions);
+          if (!in_parent(l0))
+            break;
+          continue;
+        }
+
+        process_cluster_ranges(*pool, file_name, file_size, cluster_positions);
+      }
+
+      if (NULL == (l1 = kax_file->read_next_level1_element()))
+        break;
+
       counted_ptr<EbmlElement> af_l1(l1);
 
       if (is_id(l1, KaxInfo))
@@ -2013,6 +2273,9 @@ process_file(const std::string &file_name) {
         break;
     } // while (l1 != NULL)
 
+    if (pool.is_set())
+      process_cluster_ranges(*pool, file_name, file_size, cluster_positions);
+
     delete l0;
     delete es;
 
@@ -2032,7 +2295,8 @@ setup(const std::string &locale) {
 
   init_locales(locale);
 
-  init_common_boost_formats();
+  // Re-create the formats with the new locale.
+  s_common_boost_formats.reset();
 
   version_info = get_version_info("mkvinfo", vif_full);
 }
@@ -22,5 +22,6 @@ options_c::options_c()
   , m_show_track_info(false)
   , m_hexdump_max_size(16)
   , m_verbose(0)
+  , m_jobs(0)
 {
 }
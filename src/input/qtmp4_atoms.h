@@ -227,4 +227,23 @@ typedef struct PACKED_STRUCTURE {
 #define MP4OTI_MPEG1Audio                      0x6B
 #define MP4OTI_JPEG                            0x6C
 
+// Flags of the movie fragment atoms 'tfhd' and 'trun'.
+#define QTMP4_TFHD_BASE_DATA_OFFSET           0x000001
+#define QTMP4_TFHD_SAMPLE_DESCRIPTION_ID      0x000002
+#define QTMP4_TFHD_DEFAULT_DURATION           0x000008
+#define QTMP4_TFHD_DEFAULT_SIZE               0x000010
+#define QTMP4_TFHD_DEFAULT_FLAGS              0x000020
+#define QTMP4_TFHD_DURATION_IS_EMPTY          0x010000
+#define QTMP4_TFHD_DEFAULT_BASE_IS_MOOF       0x020000
+
+#define QTMP4_TRUN_DATA_OFFSET                0x000001
+#define QTMP4_TRUN_FIRST_SAMPLE_FLAGS         0x000004
+#define QTMP4_TRUN_SAMPLE_DURATION            0x000100
+#define QTMP4_TRUN_SAMPLE_SIZE                0x000200
+#define QTMP4_TRUN_SAMPLE_FLAGS               0x000400
+#define QTMP4_TRUN_SAMPLE_COMPOSITION_OFFSET  0x000800
+
+// The 'sample_is_non_sync_sample' bit of the sample flags.
+#define QTMP4_SAMPLE_IS_NON_SYNC              0x010000
+
 #endif // __QTMP4_ATOMS_H
@@ -24,6 +24,7 @@
 #include <avilib.h>
 
 #include "common/aac.h"
+#include "common/byte_buffer.h"
 #include "common/endian.h"
 #include "common/error.h"
 #include "common/hacks.h"
@@ -32,6 +32,8 @@
 #include <matroska/KaxCluster.h>
 #include <matroska/KaxClusterData.h>
 #include <matroska/KaxContexts.h>
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
 #include <matroska/KaxInfo.h>
 #include <matroska/KaxInfoData.h>
 #include <matroska/KaxSeekHead.h>
@@ -42,6 +44,7 @@
 #include <matroska/KaxTrackVideo.h>
 
 #include "common/at_scope_exit.h"
+#include "common/byte_buffer.h"
 #include "common/chapters/chapters.h"
 #include "common/ebml.h"
 #include "common/endian.h"
@@ -200,6 +203,7 @@ kax_reader_c::kax_reader_c(const track_info_c &ti,
   , m_segment_duration(0)
   , m_last_timecode(0)
   , m_first_timecode(-1)
+  , m_segment_data_start_pos(0)
   , m_writing_app_ver(-1)
   , m_attachment_id(0)
   , m_file_status(FILE_STATUS_MOREDATA)
@@ -215,6 +219,7 @@ void
 kax_reader_c::init_l1_position_storage(deferred_positions_t &storage) {
   storage[dl1t_attachments] = std::vector<int64_t>();
   storage[dl1t_chapters]    = std::vector<int64_t>();
+  storage[dl1t_cues]        = std::vector<int64_t>();
   storage[dl1t_tags]        = std::vector<int64_t>();
   storage[dl1t_tracks]      = std::vector<int64_t>();
 }
@@ -1187,6 +1192,7 @@ kax_reader_c::read_headers_seek_head(EbmlElement *l0,
 
         type = id == EBML_ID(KaxAttachments) ? dl1t_attachments
           :    id == EBML_ID(KaxChapters)    ? dl1t_chapters
+          :    id == EBML_ID(KaxCues)        ? dl1t_cues
           :    id == EBML_ID(KaxTags)        ? dl1t_tags
           :    id == EBML_ID(KaxTracks)      ? dl1t_tracks
           :                                    dl1t_unknown;
@@ -1244,6 +1250,8 @@ kax_reader_c::read_headers_internal() {
     }
     mxverb(2, "matroska_reader: + a segment...\n");
 
+    m_segment_data_start_pos = l0->GetElementPosition() + l0->HeadSize();
+
     // We've got our segment, so let's find the m_tracks
     int upper_lvl_el = 0;
     m_tc_scale         = TIMECODE_SCALE;
@@ -1267,6 +1275,9 @@ kax_reader_c::read_headers_internal() {
       else if (EbmlId(*l1) == EBML_ID(KaxTags))
         m_deferred_l1_positions[dl1t_tags].push_back(l1->GetElementPosition());
 
+      else if (EbmlId(*l1) == EBML_ID(KaxCues))
+        m_deferred_l1_positions[dl1t_cues].push_back(l1->GetElementPosition());
+
       else if (EbmlId(*l1) == EBML_ID(KaxSeekHead))
         read_headers_seek_head(l0, l1);
 
@@ -2005,6 +2016,69 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
   return FILE_STATUS_MOREDATA;
 }
 
+/** \brief Continue reading at the cluster containing \a timecode
+
+   The cue points are read from all the KaxCues elements found while
+   parsing the headers. Reading continues at the cluster referenced by
+   the last cue point whose time is not bigger than \a timecode.
+*/
+bool
+kax_reader_c::seek_to_timecode(int64_t timecode) {
+  int64_t best_time     = -1;
+  int64_t best_position = -1;
+
+  for (auto position : m_deferred_l1_positions[dl1t_cues]) {
+    m_in->save_pos(position);
+    at_scope_exit_c restore([&]() { m_in->restore_pos(); });
+
+    int upper_lvl_el = 0;
+    counted_ptr<EbmlElement> l1(m_es->FindNextElement(EBML_CLASS_CONTEXT(KaxSegment), upper_lvl_el, 0xFFFFFFFFL, true));
+    KaxCues *cues = dynamic_cast<KaxCues *>(l1.get_object());
+
+    if (!cues)
+      continue;
+
+    EbmlElement *l2 = NULL;
+    upper_lvl_el    = 0;
+
+    cues->Read(*m_es, EBML_CLASS_CONTEXT(KaxCues), upper_lvl_el, l2, true);
+
+    size_t i;
+    for (i = 0; cues->ListSize() > i; ++i) {
+      KaxCuePoint *cue_point = dynamic_cast<KaxCuePoint *>((*cues)[i]);
+      KaxCueTime *cue_time   = NULL == cue_point ? NULL : FINDFIRST(cue_point, KaxCueTime);
+      if (NULL == cue_time)
+        continue;
+
+      int64_t time = uint64(*cue_time) * m_tc_scale;
+      if ((time > timecode) || (time < best_time))
+        continue;
+
+      KaxCueTrackPositions *positions = FINDFIRST(cue_point, KaxCueTrackPositions);
+      while (NULL != positions) {
+        KaxCueClusterPosition *cluster_position = FINDFIRST(positions, KaxCueClusterPosition);
+
+        if (   (NULL != cluster_position)
+            && ((time > best_time) || (static_cast<int64_t>(uint64(*cluster_position)) < best_position))) {
+          best_time     = time;
+          best_position = uint64(*cluster_position);
+        }
+
+        positions = FINDNEXT(cue_point, KaxCueTrackPositions, positions);
+      }
+    }
+  }
+
+  if (-1 == best_position)
+    return false;
+
+  mxverb(2, boost::format("matroska_reader: seeking to the cluster at %1% for timecode %2%\n") % (m_segment_data_start_pos + best_position) % format_timecode(best_time));
+
+  m_in->setFilePointer(m_segment_data_start_pos + best_position);
+
+  return true;
+}
+
 void
 kax_reader_c::process_simple_block(KaxCluster *cluster,
                                    KaxSimpleBlock *block_simple) {
@@ -160,6 +160,7 @@ private:
     dl1t_unknown,
     dl1t_attachments,
     dl1t_chapters,
+    dl1t_cues,
     dl1t_tags,
     dl1t_tracks,
   };
@@ -173,7 +174,7 @@ private:
 
   counted_ptr<EbmlStream> m_es;
 
-  int64_t m_segment_duration, m_last_timecode, m_first_timecode;
+  int64_t m_segment_duration, m_last_timecode, m_first_timecode, m_segment_data_start_pos;
   std::string m_title;
 
   typedef std::map<deferred_l1_type_e, std::vector<int64_t> > deferred_positions_t;
@@ -198,6 +199,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool seek_to_timecode(int64_t timecode);
 
   virtual int get_progress();
   virtual void set_headers();
@@ -14,12 +14,14 @@
 #include "common/common_pch.h"
 
 #include "common/ac3.h"
+#include "common/byte_buffer.h"
 #include "common/endian.h"
 #include "common/error.h"
 #include "common/math.h"
 #include "common/mp3.h"
 #include "common/mpeg1_2.h"
 #include "common/mpeg4_p2.h"
+#include "common/start_code.h"
 #include "common/truehd.h"
 #include "input/r_mpeg_ps.h"
 #include "merge/output_control.h"
@@ -1125,11 +1127,28 @@ mpeg_ps_reader_c::resync_stream(uint32_t &header) {
   mxverb(2, boost::format("MPEG PS: synchronisation lost at %1%; looking for start code\n") % m_in->getFilePointer());
 
   try {
+    // The buffer starts with the last three bytes of the previous header
+    // so that start codes spanning them are found as well.
+    unsigned char buffer[4096 + 3];
+    put_uint24_be(buffer, header);
+
     while (1) {
-      header <<= 8;
-      header  |= m_in->read_uint8();
-      if (mpeg_is_start_code(header))
+      int64_t start   = m_in->getFilePointer() - 3;
+      size_t num_read = m_in->read(&buffer[3], 4096);
+      size_t size     = num_read + 3;
+      size_t pos      = find_start_code(buffer, size);
+
+      // The byte following the start code prefix must be present as well.
+      if ((pos + 3) < size) {
+        header = get_uint32_be(&buffer[pos]);
+        m_in->setFilePointer(start + pos + 4);
         break;
+      }
+
+      if (0 == num_read)
+        throw mtx::mm_io::end_of_file_x();
+
+      memmove(buffer, &buffer[size - 3], 3);
     }
 
     mxverb(2, boost::format("resync succeeded at %1%, header 0x%|2$08x|\n") % (m_in->getFilePointer() - 4) % header);
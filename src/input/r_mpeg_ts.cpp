@@ -26,7 +26,9 @@
 #include "common/truehd.h"
 #include "common/mpeg1_2.h"
 #include "common/mpeg4_p2.h"
+#include "common/start_code.h"
 #include "common/strings/formatting.h"
+#include "common/vc1.h"
 #include "input/r_mpeg_ts.h"
 #include "output/p_aac.h"
 #include "output/p_ac3.h"
@@ -45,6 +47,10 @@ namespace bfs = boost::filesystem;
 #define TS_PIDS_DETECT_SIZE    10 * 1024 * 1024
 #define TS_PACKET_SIZE         188
 #define TS_MAX_PACKET_SIZE     204
+#define TS_READ_CHUNK_SIZE     (2 * 1024 * 1024)
+#define TS_NUM_PIDS            8192
+#define TS_RAP_SEARCH_CHUNK    (256 * 1024)
+#define TS_RAP_SEARCH_MAX      (64 * 1024 * 1024)
 
 int mpeg_ts_reader_c::potential_packet_sizes[] = { 188, 192, 204, 0 };
 
@@ -400,6 +406,10 @@ mpeg_ts_reader_c::mpeg_ts_reader_c(const track_info_c &ti,
   , m_debug_pat_pmt(debugging_requested("mpeg_ts_pat") || debugging_requested("mpeg_ts_pmt") || debugging_requested("mpeg_ts"))
   , m_debug_aac(debugging_requested("mpeg_aac") || debugging_requested("mpeg_ts"))
   , m_detected_packet_size(0)
+  , m_read_buffer_pos(0)
+  , m_read_buffer_fill(0)
+  , m_read_buffer_synced_end(0)
+  , m_read_buffer_file_pos(0)
 {
 }
 
@@ -806,12 +816,19 @@ mpeg_ts_reader_c::parse_packet(unsigned char *buf) {
     return false;
 
   size_t tidx;
-  for (tidx = 0; tracks.size() > tidx; ++tidx)
-    if ((tracks[tidx]->pid == table_pid) && !tracks[tidx]->processed)
-      break;
+  if (!m_pid_to_track_idx.empty()) {
+    if (-1 == m_pid_to_track_idx[table_pid])
+      return false;
+    tidx = m_pid_to_track_idx[table_pid];
 
-  if (tidx >= tracks.size())
-    return false;
+  } else {
+    for (tidx = 0; tracks.size() > tidx; ++tidx)
+      if ((tracks[tidx]->pid == table_pid) && !tracks[tidx]->processed)
+        break;
+
+    if (tidx >= tracks.size())
+      return false;
+  }
 
   unsigned char *ts_payload                 = (unsigned char *)hdr + sizeof(mpeg_ts_packet_header_t);
   unsigned char adf_discontinuity_indicator = 0;
@@ -834,6 +851,12 @@ mpeg_ts_reader_c::parse_packet(unsigned char *buf) {
     return false;
 
   if (hdr->get_payload_unit_start_indicator()) {
+    if (track->m_skip_to_random_access_point) {
+      if (-1 == is_random_access_point(buf))
+        return false;
+      track->m_skip_to_random_access_point = false;
+    }
+
     if (!parse_start_unit_packet(track, hdr, ts_payload, ts_payload_size))
       return false;
 
@@ -1153,6 +1176,24 @@ mpeg_ts_reader_c::create_packetizers() {
   mxverb(3, boost::format("mpeg_ts: create packetizers...\n"));
   for (i = 0; i < tracks.size(); i++)
     create_packetizer(i);
+
+  build_pid_table();
+}
+
+/** \brief Maps each PID to the track it belongs to
+
+   'tracks' doesn't change anymore once all packetizers have been
+   created, and the tracks' 'processed' flags have all been reset after
+   probing. Therefore the first track with a given PID is the one the
+   packet belongs to.
+*/
+void
+mpeg_ts_reader_c::build_pid_table() {
+  m_pid_to_track_idx.assign(TS_NUM_PIDS, -1);
+
+  int idx;
+  for (idx = tracks.size() - 1; 0 <= idx; --idx)
+    m_pid_to_track_idx[tracks[idx]->pid % TS_NUM_PIDS] = idx;
 }
 
 void
@@ -1188,22 +1229,18 @@ mpeg_ts_reader_c::read(generic_packetizer_c *requested_ptzr,
       return FILE_STATUS_HOLDING;
   }
 
-  unsigned char buf[TS_MAX_PACKET_SIZE + 1];
-
   track_buffer_ready = -1;
 
   if (file_done)
     return flush_packetizers();
 
   while (true) {
-    if (m_in->read(buf, m_detected_packet_size) != static_cast<unsigned int>(m_detected_packet_size))
-      return finish();
+    while (m_read_buffer_synced_end <= m_read_buffer_pos)
+      if (!fill_read_buffer())
+        return finish();
 
-    if (buf[0] != 0x47) {
-      if (resync(m_in->getFilePointer() - m_detected_packet_size))
-        continue;
-      return finish();
-    }
+    unsigned char *buf    = m_read_buffer->get_buffer() + m_read_buffer_pos;
+    m_read_buffer_pos    += m_detected_packet_size;
 
     parse_packet(buf);
 
@@ -1217,6 +1254,292 @@ mpeg_ts_reader_c::read(generic_packetizer_c *requested_ptzr,
   }
 }
 
+/** \brief Reads the next chunk of packets
+
+   Reading continues right after the last packet that has been parsed.
+   If that one is followed by a complete packet that lacks the sync byte
+   then resync() determines where to continue.
+
+   \return \c false if the end of the file has been reached or if
+     synchronization could not be re-established. A return value of
+     \c true does not mean that the first packet is in sync.
+*/
+bool
+mpeg_ts_reader_c::fill_read_buffer() {
+  if (!m_read_buffer.is_set())
+    m_read_buffer = memory_c::alloc(TS_READ_CHUNK_SIZE / m_detected_packet_size * m_detected_packet_size);
+
+  else if (m_read_buffer_pos < m_read_buffer_fill) {
+    uint64_t file_pos = m_read_buffer_file_pos + m_read_buffer_pos;
+
+    if ((m_read_buffer_pos + m_detected_packet_size) > m_read_buffer_fill)
+      m_in->setFilePointer(file_pos);
+
+    else if (!resync(file_pos))
+      return false;
+  }
+
+  m_read_buffer_file_pos = m_in->getFilePointer();
+  m_read_buffer_fill     = m_in->read(m_read_buffer->get_buffer(), m_read_buffer->get_size());
+  m_read_buffer_pos      = 0;
+
+  // Check the sync bytes of all complete packets in one go.
+  unsigned char *buffer    = m_read_buffer->get_buffer();
+  m_read_buffer_synced_end = 0;
+  while (((m_read_buffer_synced_end + m_detected_packet_size) <= m_read_buffer_fill) && (0x47 == buffer[m_read_buffer_synced_end]))
+    m_read_buffer_synced_end += m_detected_packet_size;
+
+  return m_read_buffer_fill >= static_cast<size_t>(m_detected_packet_size);
+}
+
+/** \brief Continue reading at the packet containing \a timecode
+
+   Transport streams don't contain an index. The position is found by
+   bisecting the file on the DTS/PTS of the PES packets of the tracks
+   being muxed. Those are the timestamps the packets' timecodes are
+   derived from. Reading continues at the last position whose first
+   PES packet doesn't start after \a timecode. From there the file is
+   searched backwards for the key frames of the video tracks. Reading
+   continues at the earliest of them, and each video track skips the
+   data in front of its own key frame.
+
+   The timestamps only have 33 bits and wrap around after about 26.5
+   hours. They are therefore compared relative to the file's first
+   timestamp.
+*/
+bool
+mpeg_ts_reader_c::seek_to_timecode(int64_t timecode) {
+  if (-1 == m_global_timecode_offset)
+    return false;
+
+  int64_t target = timecode * 9 / 100000;
+  int64_t first  = 0;
+  int64_t last   = m_size;
+
+  while ((last - first) > (2 * m_detected_packet_size)) {
+    int64_t middle    = first + (last - first) / 2;
+    int64_t timestamp = read_first_pes_timestamp(middle);
+
+    // Timestamps slightly lower than the first one, e.g. those of
+    // another track, are negative instead of wrapped around.
+    if (-1 != timestamp) {
+      timestamp = (timestamp - m_global_timecode_offset) & 0x1ffffffffll;
+      if (0x100000000ll < timestamp)
+        timestamp -= 0x200000000ll;
+    }
+
+    if ((-1 != timestamp) && (timestamp <= target))
+      first = middle;
+    else
+      last  = middle;
+  }
+
+  if (!resync(first))
+    return false;
+
+  int64_t position      = m_in->getFilePointer();
+  int64_t key_frame_pos = find_random_access_point(position);
+  bool found_key_frames = -1 != key_frame_pos;
+
+  if (!found_key_frames) {
+    mxverb(2, boost::format("mpeg_ts: no key frame found before %1%\n") % position);
+    key_frame_pos = position;
+  }
+
+  if (!resync(key_frame_pos))
+    return false;
+
+  mxverb(2, boost::format("mpeg_ts: seeking to %1% for timecode %2%\n") % m_in->getFilePointer() % format_timecode(timecode));
+
+  m_read_buffer_pos        = 0;
+  m_read_buffer_fill       = 0;
+  m_read_buffer_synced_end = 0;
+
+  for (auto &track : tracks) {
+    track->pes_payload->remove(track->pes_payload->get_size());
+    track->pes_payload_size              = 0;
+    track->data_ready                    = false;
+    track->timecode                      = -1;
+    track->m_skip_to_random_access_point = found_key_frames && (ES_VIDEO_TYPE == track->type);
+  }
+
+  return true;
+}
+
+/** \brief Finds the timestamp of the first PES packet at or after a position
+
+   Only the PES packets of tracks that are muxed are considered. The
+   search is limited to one read chunk's worth of packets.
+
+   \return The PES packet's DTS if present or its PTS otherwise. -1 if
+     no such PES packet was found.
+*/
+int64_t
+mpeg_ts_reader_c::read_first_pes_timestamp(int64_t start_at) {
+  if (!resync(start_at))
+    return -1;
+
+  unsigned char buf[TS_MAX_PACKET_SIZE];
+  int num_packets = TS_READ_CHUNK_SIZE / m_detected_packet_size;
+
+  while (0 < num_packets--) {
+    if (m_in->read(buf, m_detected_packet_size) != static_cast<unsigned int>(m_detected_packet_size))
+      return -1;
+
+    if (0x47 != buf[0]) {
+      if (!resync(m_in->getFilePointer() - m_detected_packet_size))
+        return -1;
+      continue;
+    }
+
+    mpeg_ts_packet_header_t *hdr = reinterpret_cast<mpeg_ts_packet_header_t *>(buf);
+    int tidx                     = m_pid_to_track_idx[hdr->get_pid() % TS_NUM_PIDS];
+
+    if (   !hdr->get_payload_unit_start_indicator()
+        || !(hdr->get_adaptation_field_control() & 0x01)
+        || (-1 == tidx)
+        || (-1 == tracks[tidx]->ptzr))
+      continue;
+
+    unsigned char *ts_payload = buf + sizeof(mpeg_ts_packet_header_t);
+    if (hdr->get_adaptation_field_control() & 0x02)
+      ts_payload += static_cast<unsigned int>(reinterpret_cast<mpeg_ts_adaptation_field_t *>(ts_payload)->length) + 1;
+
+    if ((ts_payload + sizeof(mpeg_ts_pes_header_t) + 9) > (buf + TS_PACKET_SIZE))
+      continue;
+
+    mpeg_ts_pes_header_t *pes_data = reinterpret_cast<mpeg_ts_pes_header_t *>(ts_payload);
+    if (!(pes_data->get_pts_dts_flags() & 0x02))
+      continue;
+
+    return (pes_data->get_pts_dts_flags() & 0x01) ? read_timestamp(&pes_data->pts_dts + 5) : read_timestamp(&pes_data->pts_dts);
+  }
+
+  return -1;
+}
+
+/** \brief Finds the position decoding the video tracks can start at
+
+   The file is read backwards from \a end in chunks until a random
+   access point has been found for each video track being muxed. Only
+   the last random access point of each track is considered.
+
+   \return The position of the earliest of those random access points,
+     \a end if no video track is muxed or -1 if not all of them were
+     found.
+*/
+int64_t
+mpeg_ts_reader_c::find_random_access_point(int64_t end) {
+  std::set<int> wanted_tracks;
+  size_t idx;
+
+  for (idx = 0; tracks.size() > idx; ++idx)
+    if ((ES_VIDEO_TYPE == tracks[idx]->type) && (-1 != tracks[idx]->ptzr))
+      wanted_tracks.insert(idx);
+
+  if (wanted_tracks.empty())
+    return end;
+
+  unsigned char buf[TS_MAX_PACKET_SIZE];
+  int64_t chunk_end = end + 1;
+
+  while ((0 < chunk_end) && ((end - chunk_end) < TS_RAP_SEARCH_MAX)) {
+    int64_t chunk_start = std::max<int64_t>(chunk_end - TS_RAP_SEARCH_CHUNK, 0);
+    std::vector<std::pair<int64_t, int> > points;
+
+    if (!resync(chunk_start))
+      return -1;
+
+    while (static_cast<int64_t>(m_in->getFilePointer()) < chunk_end) {
+      int64_t pos = m_in->getFilePointer();
+
+      if (m_in->read(buf, m_detected_packet_size) != static_cast<unsigned int>(m_detected_packet_size))
+        break;
+
+      if (0x47 != buf[0]) {
+        if (!resync(pos))
+          break;
+        continue;
+      }
+
+      int tidx = is_random_access_point(buf);
+      if (-1 != tidx)
+        points.push_back(std::make_pair(pos, tidx));
+    }
+
+    for (auto point = points.rbegin(); points.rend() != point; ++point) {
+      wanted_tracks.erase(point->second);
+      if (wanted_tracks.empty())
+        return point->first;
+    }
+
+    chunk_end = chunk_start;
+  }
+
+  return -1;
+}
+
+/** \brief Checks whether a TS packet starts a key frame of a video track
+
+   The packet must start a PES packet. It is a random access point if
+   its adaptation field says so or if the start of the PES payload
+   contains a sequence header, a GOP header, an entry point or an IDR
+   slice, depending on the codec.
+
+   \return The index of the track the packet belongs to or -1 if it
+     isn't a random access point of a video track being muxed.
+*/
+int
+mpeg_ts_reader_c::is_random_access_point(unsigned char *buf) {
+  mpeg_ts_packet_header_t *hdr = reinterpret_cast<mpeg_ts_packet_header_t *>(buf);
+  int tidx                     = m_pid_to_track_idx[hdr->get_pid() % TS_NUM_PIDS];
+
+  if (   !hdr->get_payload_unit_start_indicator()
+      || !(hdr->get_adaptation_field_control() & 0x01)
+      || (-1 == tidx)
+      || (-1 == tracks[tidx]->ptzr)
+      || (ES_VIDEO_TYPE != tracks[tidx]->type))
+    return -1;
+
+  unsigned char *ts_payload = buf + sizeof(mpeg_ts_packet_header_t);
+  unsigned char *end        = buf + TS_PACKET_SIZE;
+  if (hdr->get_adaptation_field_control() & 0x02) {
+    mpeg_ts_adaptation_field_t *adaptation_field = reinterpret_cast<mpeg_ts_adaptation_field_t *>(ts_payload);
+    if ((0 < adaptation_field->length) && adaptation_field->get_random_access_indicator())
+      return tidx;
+    ts_payload += static_cast<unsigned int>(adaptation_field->length) + 1;
+  }
+
+  if ((ts_payload + sizeof(mpeg_ts_pes_header_t)) > end)
+    return -1;
+
+  mpeg_ts_pes_header_t *pes_data = reinterpret_cast<mpeg_ts_pes_header_t *>(ts_payload);
+  unsigned char *es_data         = &pes_data->pes_header_data_length + pes_data->pes_header_data_length + 1;
+  uint32_t fourcc                = tracks[tidx]->fourcc;
+
+  while ((es_data + 4) <= end) {
+    size_t pos = find_start_code(es_data, end - es_data);
+    if ((es_data + pos + 4) > end)
+      break;
+
+    uint32_t marker = get_uint32_be(&es_data[pos]);
+    if (FOURCC('A', 'V', 'C', '1') == fourcc) {
+      if ((NALU_TYPE_SEQ_PARAM == (marker & 0x1f)) || (NALU_TYPE_IDR_SLICE == (marker & 0x1f)))
+        return tidx;
+
+    } else if (FOURCC('W', 'V', 'C', '1') == fourcc) {
+      if ((VC1_MARKER_SEQHDR == marker) || (VC1_MARKER_ENTRYPOINT == marker))
+        return tidx;
+
+    } else if ((MPEGVIDEO_SEQUENCE_START_CODE == marker) || (MPEGVIDEO_GOP12_START_CODE == marker))
+      return tidx;
+
+    es_data += pos + 3;
+  }
+
+  return -1;
+}
+
 bfs::path
 mpeg_ts_reader_c::find_clip_info_file() {
   bool debug = debugging_requested("clpi");
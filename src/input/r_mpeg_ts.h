@@ -113,6 +113,10 @@ struct PACKED_STRUCTURE mpeg_ts_adaptation_field_t {
   unsigned char get_discontinuity_indicator() {
     return (flags & 80) >> 7;
   }
+
+  unsigned char get_random_access_indicator() {
+    return (flags & 0x40) >> 6;
+  }
 };
 
 // PAT header
@@ -296,6 +300,10 @@ public:
 
   bool m_apply_dts_timecode_fix, m_use_dts;
 
+  // Set after seeking: the PES packets are dropped until the track's
+  // next key frame.
+  bool m_skip_to_random_access_point;
+
   // general track parameters
   std::string language;
 
@@ -333,6 +341,7 @@ public:
     , a_bsid(0)
     , m_apply_dts_timecode_fix(false)
     , m_use_dts(false)
+    , m_skip_to_random_access_point(false)
   {
   }
 
@@ -371,6 +380,15 @@ protected:
 
   int m_detected_packet_size;
 
+  // Packets are read in large chunks. Packets in front of
+  // m_read_buffer_synced_end have been checked for their sync byte.
+  memory_cptr m_read_buffer;
+  size_t m_read_buffer_pos, m_read_buffer_fill, m_read_buffer_synced_end;
+  uint64_t m_read_buffer_file_pos;
+
+  // Index into 'tracks' for each PID while muxing, -1 for unknown PIDs.
+  std::vector<int> m_pid_to_track_idx;
+
 protected:
   static int potential_packet_sizes[];
 
@@ -386,6 +404,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *requested_ptzr, bool force = false);
+  virtual bool seek_to_timecode(int64_t timecode);
   virtual void identify();
   virtual void create_packetizer(int64_t tid);
   virtual void create_packetizers();
@@ -403,6 +422,11 @@ private:
   void probe_packet_complete(mpeg_ts_track_ptr &track, int tidx);
 
   file_status_e finish();
+  bool fill_read_buffer();
+  int64_t read_first_pes_timestamp(int64_t start_at);
+  int64_t find_random_access_point(int64_t end);
+  int is_random_access_point(unsigned char *buf);
+  void build_pid_table();
   int send_to_packetizer(mpeg_ts_track_ptr &track);
   void create_mpeg1_2_video_packetizer(mpeg_ts_track_ptr &track);
   void create_mpeg4_p10_es_video_packetizer(mpeg_ts_track_ptr &track);
@@ -30,6 +30,7 @@
 #include "common/hacks.h"
 #include "common/iso639.h"
 #include "common/matroska.h"
+#include "common/mm_mmap_io.h"
 #include "common/strings/formatting.h"
 #include "input/r_qtmp4.h"
 #include "merge/output_control.h"
@@ -107,9 +108,17 @@ qtmp4_reader_c::qtmp4_reader_c(const track_info_c &ti,
   , m_time_scale(1)
   , m_compression_algorithm(0)
   , m_main_dmx(-1)
+  , m_fetch_buffer_size(g_qtmp4_read_buffer_size)
+  , m_fetch_window_size(std::max<int64_t>(std::min<int64_t>(g_qtmp4_read_buffer_size / 4, 8 * 1024 * 1024), 64 * 1024))
+  , m_fetched_size(0)
+  , m_fragmented(false)
+  , m_first_fragment_pos(0)
+  , m_fragment_pos(0)
   , m_debug_chapters(debugging_requested("qtmp4") || debugging_requested("qtmp4_full") || debugging_requested("qtmp4_chapters"))
   , m_debug_headers( debugging_requested("qtmp4") || debugging_requested("qtmp4_full") || debugging_requested("qtmp4_headers"))
   , m_debug_tables(                                  debugging_requested("qtmp4_full") || debugging_requested("qtmp4_tables"))
+  , m_debug_fetch(                                   debugging_requested("qtmp4_full") || debugging_requested("qtmp4_fetch"))
+  , m_debug_fragments(                               debugging_requested("qtmp4_full") || debugging_requested("qtmp4_fragments"))
 {
 }
 
@@ -123,6 +132,11 @@ qtmp4_reader_c::read_headers() {
 
     parse_headers();
 
+    // Reading larger windows doesn't gain anything if the file has
+    // been mapped into memory.
+    if (NULL != dynamic_cast<mm_mmap_io_c *>(m_in.get_object()))
+      m_fetch_buffer_size = 0;
+
   } catch (mtx::mm_io::exception &) {
     throw mtx::input::open_x();
   }
@@ -199,17 +213,30 @@ qtmp4_reader_c::parse_headers() {
       m_mdat_size = atom.size;
       skip_atom();
 
+    } else if (FOURCC('m', 'o', 'o', 'f') == atom.fourcc) {
+      // Fragmented file: the samples are described by the movie
+      // fragments which are parsed while reading.
+      if (!m_fragmented) {
+        m_fragmented         = true;
+        m_first_fragment_pos = atom.pos;
+        m_fragment_pos       = atom.pos;
+      }
+      skip_atom();
+
     } else
       skip_atom();
 
-  } while (!m_in->eof() && (!headers_parsed || (-1 == m_mdat_pos)));
+  } while (!m_in->eof() && (!headers_parsed || ((-1 == m_mdat_pos) && !m_fragmented)));
 
   if (!headers_parsed)
     mxerror(Y("Quicktime/MP4 reader: Have not found any header atoms.\n"));
-  if (-1 == m_mdat_pos)
+  if ((-1 == m_mdat_pos) && !m_fragmented)
     mxerror(Y("Quicktime/MP4 reader: Have not found the 'mdat' atom. No movie data found.\n"));
 
-  m_in->setFilePointer(m_mdat_pos);
+  mxdebug_if(m_debug_headers && m_fragmented, boost::format("Fragmented file; first movie fragment at %1%\n") % m_first_fragment_pos);
+
+  if (!m_fragmented)
+    m_in->setFilePointer(m_mdat_pos);
 
   for (auto &dmx : m_demuxers) {
     if ((   ('v' == dmx->type)
@@ -297,7 +324,18 @@ qtmp4_reader_c::parse_headers() {
       continue;
     }
 
-    dmx->update_tables(m_time_scale);
+    // The sample tables of fragmented files are empty. Their samples
+    // are only known once the fragments are read.
+    if (m_fragmented) {
+      dmx->m_fragmented = true;
+
+      if (!dmx->editlist_table.empty())
+        mxwarn(boost::format(Y("Quicktime/MP4 reader: Track %1% has an edit list. Edit lists are ignored in fragmented files.\n")) % dmx->id);
+      if (!dmx->sample_size_table.empty() || !dmx->chunk_offset_table.empty())
+        mxwarn(boost::format(Y("Quicktime/MP4 reader: Track %1% lists samples in its header. Only the samples in the movie fragments of fragmented files are used.\n")) % dmx->id);
+
+    } else
+      dmx->update_tables(m_time_scale);
 
     dmx->ok = true;
   }
@@ -312,6 +350,16 @@ qtmp4_reader_c::parse_headers() {
 
 void
 qtmp4_reader_c::calculate_timecodes() {
+  // The first fragment provides the samples needed for determining the
+  // frame rate and for creating the packetizers.
+  if (m_fragmented) {
+    read_fragment();
+    for (auto &dmx : m_demuxers)
+      dmx->calculate_fps();
+
+    return;
+  }
+
   int64_t min_timecode = 0;
 
   for (auto &dmx : m_demuxers) {
@@ -334,8 +382,6 @@ qtmp4_reader_c::calculate_timecodes() {
   } else
     min_timecode = 0;
 
-  for (auto &dmx : m_demuxers)
-    dmx->build_index();
 }
 
 void
@@ -690,6 +736,9 @@ qtmp4_reader_c::handle_moov_atom(qt_atom_t parent,
     else if (FOURCC('u', 'd', 't', 'a') == atom.fourcc)
       handle_udta_atom(atom.to_parent(), level + 1);
 
+    else if (FOURCC('m', 'v', 'e', 'x') == atom.fourcc)
+      handle_mvex_atom(atom.to_parent(), level + 1);
+
     else if (FOURCC('t', 'r', 'a', 'k') == atom.fourcc) {
       qtmp4_demuxer_cptr new_dmx(new qtmp4_demuxer_c);
 
@@ -703,6 +752,37 @@ qtmp4_reader_c::handle_moov_atom(qt_atom_t parent,
   }
 }
 
+void
+qtmp4_reader_c::handle_mvex_atom(qt_atom_t parent,
+                                 int level) {
+  while (parent.size > 0) {
+    qt_atom_t atom = read_atom();
+    print_basic_atom_info();
+
+    if (FOURCC('t', 'r', 'e', 'x') == atom.fourcc)
+      handle_trex_atom(atom.to_parent(), level + 1);
+
+    skip_atom();
+    parent.size -= atom.size;
+  }
+}
+
+void
+qtmp4_reader_c::handle_trex_atom(qt_atom_t,
+                                 int level) {
+  m_in->skip(1 + 3);        // version & flags
+  uint32_t track_id = m_in->read_uint32_be();
+
+  qt_track_defaults_t &defaults  = m_track_defaults[track_id];
+  defaults.sample_description_id = m_in->read_uint32_be();
+  defaults.sample_duration       = m_in->read_uint32_be();
+  defaults.sample_size           = m_in->read_uint32_be();
+  defaults.sample_flags          = m_in->read_uint32_be();
+
+  mxdebug_if(m_debug_headers, boost::format("%1%Track %2% defaults: sample description %3% duration %4% size %5% flags 0x%|6$08x|\n")
+             % space(level * 2 + 1) % track_id % defaults.sample_description_id % defaults.sample_duration % defaults.sample_size % defaults.sample_flags);
+}
+
 void
 qtmp4_reader_c::handle_mvhd_atom(qt_atom_t atom,
                                  int level) {
@@ -772,7 +852,7 @@ qtmp4_reader_c::read_chapter_track() {
 
   m_chapter_dmx->update_tables(m_time_scale);
 
-  if (m_chapter_dmx->sample_table.empty())
+  if (m_chapter_dmx->sample_size_table.empty())
     return;
 
   std::vector<qtmp4_chapter_entry_t> entries;
@@ -780,21 +860,25 @@ qtmp4_reader_c::read_chapter_track() {
   uint64_t pts_scale_num = 1000000000ull                                    / pts_scale_gcd;
   uint64_t pts_scale_den = static_cast<uint64_t>(m_chapter_dmx->time_scale) / pts_scale_gcd;
 
-  for (auto &sample : m_chapter_dmx->sample_table) {
-    if (2 >= sample.size)
+  uint64_t sample;
+  for (sample = 0; m_chapter_dmx->get_num_samples() > sample; ++sample) {
+    uint32_t sample_size = m_chapter_dmx->get_sample_size(sample);
+    uint64_t sample_pos  = m_chapter_dmx->get_sample_pos(sample);
+
+    if (2 >= sample_size)
       continue;
 
-    m_in->setFilePointer(sample.pos, seek_beginning);
-    memory_cptr chunk(memory_c::alloc(sample.size));
-    if (m_in->read(chunk->get_buffer(), sample.size) != sample.size)
+    m_in->setFilePointer(sample_pos, seek_beginning);
+    memory_cptr chunk(memory_c::alloc(sample_size));
+    if (m_in->read(chunk->get_buffer(), sample_size) != sample_size)
       continue;
 
     unsigned int name_len = get_uint16_be(chunk->get_buffer());
-    if ((name_len + 2) > sample.size)
+    if ((name_len + 2) > sample_size)
       continue;
 
     entries.push_back(qtmp4_chapter_entry_t(std::string(reinterpret_cast<char *>(chunk->get_buffer()) + 2, name_len),
-                                            sample.pts * pts_scale_num / pts_scale_den));
+                                            m_chapter_dmx->get_sample_pts(sample) * pts_scale_num / pts_scale_den));
   }
 
   recode_chapter_entries(entries);
@@ -884,11 +968,8 @@ qtmp4_reader_c::handle_stco_atom(qtmp4_demuxer_cptr &new_dmx,
 
   size_t i;
   for (i = 0; i < count; ++i) {
-    qt_chunk_t chunk;
-
-    chunk.pos = m_in->read_uint32_be();
-    new_dmx->chunk_table.push_back(chunk);
-    mxdebug_if(m_debug_tables, boost::format("%1%  %2%\n") % space(level * 2 + 1) % chunk.pos);
+    new_dmx->chunk_offset_table.push_back(m_in->read_uint32_be());
+    mxdebug_if(m_debug_tables, boost::format("%1%  %2%\n") % space(level * 2 + 1) % new_dmx->chunk_offset_table.back());
   }
 }
 
@@ -903,11 +984,8 @@ qtmp4_reader_c::handle_co64_atom(qtmp4_demuxer_cptr &new_dmx,
 
   size_t i;
   for (i = 0; i < count; ++i) {
-    qt_chunk_t chunk;
-
-    chunk.pos = m_in->read_uint64_be();
-    new_dmx->chunk_table.push_back(chunk);
-    mxdebug_if(m_debug_tables, boost::format("%1%  %2%\n") % space(level * 2 + 1) % chunk.pos);
+    new_dmx->chunk_offset_table.push_back(m_in->read_uint64_be());
+    mxdebug_if(m_debug_tables, boost::format("%1%  %2%\n") % space(level * 2 + 1) % new_dmx->chunk_offset_table.back());
   }
 }
 
@@ -1099,12 +1177,8 @@ qtmp4_reader_c::handle_stsz_atom(qtmp4_demuxer_cptr &new_dmx,
 
   if (0 == sample_size) {
     size_t i;
-    for (i = 0; i < count; ++i) {
-      qt_sample_t sample;
-
-      sample.size = m_in->read_uint32_be();
-      new_dmx->sample_table.push_back(sample);
-    }
+    for (i = 0; i < count; ++i)
+      new_dmx->sample_size_table.push_back(m_in->read_uint32_be());
 
     mxdebug_if(m_debug_headers, boost::format("%1%Sample size table: %2% entries\n") % space(level * 2 + 1) % count);
 
@@ -1245,7 +1319,17 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     if ((-1 == dmx->ptzr) || (PTZR(dmx->ptzr) != ptzr))
       continue;
 
-    if (dmx->pos < dmx->m_index.size())
+    // Further fragments are only read if the other tracks need them
+    // as well. Otherwise a track ending early would cause all remaining
+    // fragments to be indexed for the other tracks at once.
+    while (m_fragmented && (dmx->get_num_index_entries() <= dmx->pos) && find_next_fragment()) {
+      if (other_tracks_are_ahead_of(*dmx))
+        return FILE_STATUS_HOLDING;
+      if (!read_fragment())
+        break;
+    }
+
+    if (dmx->pos < dmx->get_num_index_entries())
       break;
   }
 
@@ -1253,44 +1337,565 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     return flush_packetizers();
 
   qtmp4_demuxer_cptr &dmx = m_demuxers[dmx_idx];
-  qt_index_t &index       = dmx->m_index[dmx->pos];
-
-  m_in->setFilePointer(index.file_pos);
+  const qt_index_t &index = dmx->get_index_entry(dmx->pos);
 
-  int buffer_offset = 0;
-  unsigned char *buffer;
+  memory_cptr buffer;
 
-  if (   ('v' == dmx->type)
-      && (0 == dmx->pos)
-      && (!strncasecmp(dmx->fourcc, "mp4v", 4) || !strncasecmp(dmx->fourcc, "xvid", 4))
-      && dmx->esds_parsed
-      && (NULL != dmx->esds.decoder_config)) {
-    buffer        = (unsigned char *)safemalloc(index.size + dmx->esds.decoder_config_len);
-    buffer_offset = dmx->esds.decoder_config_len;
-
-    memcpy(buffer, dmx->esds.decoder_config, dmx->esds.decoder_config_len);
-
-  } else {
-    buffer = (unsigned char *)safemalloc(index.size);
-  }
+  try {
+    buffer = fetch_sample(*dmx);
+
+    if (   ('v' == dmx->type)
+        && (dmx->start_pos == dmx->pos)
+        && (!strncasecmp(dmx->fourcc, "mp4v", 4) || !strncasecmp(dmx->fourcc, "xvid", 4))
+        && dmx->esds_parsed
+        && (NULL != dmx->esds.decoder_config)) {
+      memory_cptr sample = buffer;
+      buffer             = memory_c::alloc(index.size + dmx->esds.decoder_config_len);
+
+      memcpy(buffer->get_buffer(),                                  dmx->esds.decoder_config, dmx->esds.decoder_config_len);
+      memcpy(buffer->get_buffer() + dmx->esds.decoder_config_len, sample->get_buffer(),       index.size);
+    }
 
-  if (m_in->read(buffer + buffer_offset, index.size) != index.size) {
+  } catch (mtx::mm_io::exception &) {
     mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
-           % dmx->pos % dmx->m_index.size() % index.size % index.file_pos);
-    safefree(buffer);
+           % dmx->pos % dmx->get_num_index_entries() % index.size % index.file_pos);
     return flush_packetizers();
   }
 
-  PTZR(dmx->ptzr)->process(new packet_t(new memory_c(buffer, index.size + buffer_offset, true), index.timecode, index.duration,
-                                        index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+  PTZR(dmx->ptzr)->process(new packet_t(buffer, index.timecode, index.duration, index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
   ++dmx->pos;
+  dmx->discard_index_entries(dmx->pos);
 
-  if (dmx->pos < dmx->m_index.size())
+  if ((dmx->pos < dmx->get_num_index_entries()) || (m_fragmented && find_next_fragment()))
     return FILE_STATUS_MOREDATA;
 
   return flush_packetizers();
 }
 
+/** \brief Returns the data of the sample at the demuxer's current position
+
+   The samples are fetched with large sequential reads instead of
+   seeking to each sample (see fetch_samples_from_window()). Fetching
+   can be turned off with a buffer size of 0.
+*/
+memory_cptr
+qtmp4_reader_c::fetch_sample(qtmp4_demuxer_c &dmx) {
+  if (0 == m_fetch_buffer_size) {
+    const qt_index_t &index = dmx.get_index_entry(dmx.pos);
+
+    m_in->setFilePointer(index.file_pos);
+    // Avoids copying the data if the file is mapped into memory.
+    return m_in->read_slice(index.size);
+  }
+
+  if (dmx.m_fetched_samples.empty())
+    fetch_samples_from_window(dmx);
+
+  qt_fetched_sample_t sample = dmx.m_fetched_samples.front();
+  dmx.m_fetched_samples.pop_front();
+
+  if (!sample.window.is_set()) {
+    m_fetched_size -= sample.data->get_size();
+    return sample.data;
+  }
+
+  qt_fetch_window_t &window = *sample.window;
+  --window.num_queued;
+  window.queued_size -= sample.data->get_size();
+
+  if (0 == window.num_queued)
+    m_fetched_size -= window.size;
+
+  // Don't keep a whole window alive for a few samples of other tracks.
+  else if ((window.queued_size * 4) < window.size)
+    copy_out_fetched_samples(sample.window);
+
+  return sample.data;
+}
+
+/** rief Copies the queued samples still referring to \a window
+
+   The window's buffer is freed once the copies have been made. Its size
+   is then no longer counted, only the sizes of the copied samples.
+*/
+void
+qtmp4_reader_c::copy_out_fetched_samples(qt_fetch_window_cptr &window) {
+  mxdebug_if(m_debug_fetch, boost::format("fetch: copying out %1% sample(s) with %2% bytes from a window of %3% bytes\n") % window->num_queued % window->queued_size % window->size);
+
+  m_fetched_size += window->queued_size - window->size;
+
+  qt_fetch_window_t *to_release = window.get_object();
+  for (auto &dmx : m_demuxers)
+    for (auto &sample : dmx->m_fetched_samples)
+      if (sample.window.get_object() == to_release) {
+        sample.data = clone_memory(sample.data);
+        sample.window.clear();
+      }
+}
+
+/** \brief Reads the samples of all tracks located in the same region
+
+   The region (the window) starts with the requesting demuxer's next
+   sample. For each track the following samples are taken as long as
+   they're located completely inside the window. The window is then read
+   with a single read and sliced into the samples which are queued in
+   their demuxers.
+
+   This turns the mkvmerge's track by track requests into sequential
+   reads. Files in which the tracks are badly interleaved, e.g. with all
+   audio data at the end, only cause one seek per window and track
+   instead of one per sample.
+
+   Samples of other tracks are only taken as long as the data buffered
+   for all tracks stays below the buffer size. As the queued samples are
+   slices of the window, the whole window is counted until its last
+   sample has been taken. Once less than a quarter of a window is still
+   queued the remaining samples are copied out so that the window can be
+   freed (see fetch_sample()).
+*/
+void
+qtmp4_reader_c::fetch_samples_from_window(qtmp4_demuxer_c &requester) {
+  const qt_index_t &first = requester.get_index_entry(requester.pos);
+  int64_t window_start = first.file_pos;
+  int64_t window_end   = std::max(std::min(window_start + m_fetch_window_size, static_cast<int64_t>(m_size)), window_start + first.size);
+  int64_t read_end     = window_start;
+  int64_t budget       = m_fetch_buffer_size - m_fetched_size;
+
+  std::vector<std::pair<qtmp4_demuxer_c *, size_t> > num_samples_to_fetch;
+  std::vector<qtmp4_demuxer_c *> demuxers(1, &requester);
+
+  for (auto &dmx : m_demuxers)
+    if ((-1 != dmx->ptzr) && (dmx.get_object() != &requester))
+      demuxers.push_back(dmx.get_object());
+
+  for (auto dmx : demuxers) {
+    size_t idx         = dmx->pos + dmx->m_fetched_samples.size();
+    size_t num_samples = 0;
+
+    for (; dmx->get_num_index_entries() > idx; ++idx) {
+      const qt_index_t &index = dmx->get_index_entry(idx);
+
+      if ((index.file_pos < window_start) || ((index.file_pos + index.size) > window_end))
+        break;
+
+      // The requesting demuxer always gets its next sample.
+      int64_t new_read_end = std::max(read_end, index.file_pos + index.size);
+      if ((budget < (new_read_end - window_start)) && ((dmx != &requester) || (0 != num_samples)))
+        break;
+
+      read_end = new_read_end;
+      ++num_samples;
+    }
+
+    if (0 != num_samples)
+      num_samples_to_fetch.push_back(std::make_pair(dmx, num_samples));
+  }
+
+  mxdebug_if(m_debug_fetch, boost::format("fetch for track %1%: window %2% - %3%, reading %4% bytes for %5% track(s)\n")
+             % requester.id % window_start % window_end % (read_end - window_start) % num_samples_to_fetch.size());
+
+  memory_cptr window = memory_c::alloc(read_end - window_start);
+  qt_fetch_window_cptr window_info(new qt_fetch_window_t(window->get_size()));
+
+  m_in->setFilePointer(window_start);
+  if (m_in->read(window->get_buffer(), window->get_size()) != window->get_size())
+    throw mtx::mm_io::end_of_file_x();
+
+  m_fetched_size += window->get_size();
+
+  for (auto &to_fetch : num_samples_to_fetch) {
+    qtmp4_demuxer_c *dmx = to_fetch.first;
+    size_t idx           = dmx->pos + dmx->m_fetched_samples.size();
+    size_t end           = idx + to_fetch.second;
+
+    for (; end > idx; ++idx) {
+      const qt_index_t &index = dmx->get_index_entry(idx);
+
+      dmx->m_fetched_samples.push_back(qt_fetched_sample_t(window->slice(index.file_pos - window_start, index.size), window_info));
+      window_info->queued_size += index.size;
+      ++window_info->num_queued;
+    }
+  }
+}
+
+/** \brief Continue reading each track at its key frame at or before \a timecode
+
+   The index entries created from the sample, chunk and sync sample
+   tables contain each frame's position and timecode. Tracks without sync
+   sample tables consist of key frames only.
+*/
+bool
+qtmp4_reader_c::seek_to_timecode(int64_t timecode) {
+  if (m_fragmented)
+    return seek_fragments_to_timecode(timecode);
+
+  for (auto &dmx : m_demuxers) {
+    if (-1 == dmx->ptzr)
+      continue;
+
+    size_t idx;
+    for (idx = 0; dmx->get_num_index_entries() > idx; ++idx) {
+      qt_index_t index = dmx->create_index_entry(idx);
+      if (!index.is_keyframe)
+        continue;
+      if (index.timecode > timecode)
+        break;
+      dmx->start_pos = idx;
+    }
+
+    dmx->pos           = dmx->start_pos;
+    dmx->m_index_start = dmx->pos;
+    dmx->m_index.clear();
+    dmx->m_fetched_samples.clear();
+
+    mxverb(2, boost::format("Quicktime/MP4 reader: track %1%: continuing at frame %2%/%3%\n") % dmx->id % dmx->pos % dmx->get_num_index_entries());
+  }
+
+  m_fetched_size = 0;
+
+  return true;
+}
+
+/** \brief Restarts reading fragmented files at the key frames at or before \a timecode
+
+   The fragments are read from the start of the file. For each track
+   only the index entries from its last key frame at or before \a
+   timecode onwards are kept. Reading stops as soon as each track has
+   seen a key frame after \a timecode or has no entries left. A track
+   has no entries left if a fragment whose samples all lie after \a
+   timecode didn't contain any samples for it, e.g. because it ended
+   before \a timecode. This assumes that the fragments are stored in the
+   order of their timecodes; handle_tfdt_atom() warns if they aren't.
+*/
+bool
+qtmp4_reader_c::seek_fragments_to_timecode(int64_t timecode) {
+  for (auto &dmx : m_demuxers) {
+    dmx->pos            = 0;
+    dmx->start_pos      = 0;
+    dmx->m_index_start  = 0;
+    dmx->m_fragment_dts = 0;
+    dmx->m_index.clear();
+    dmx->m_fetched_samples.clear();
+  }
+
+  m_fetched_size = 0;
+  m_fragment_pos = m_first_fragment_pos;
+
+  std::vector<size_t> num_entries(m_demuxers.size(), 0);
+
+  bool done = false;
+  while (!done && read_fragment()) {
+    done = true;
+
+    // Whether or not all samples of the fragment lie after the timecode.
+    bool fragment_past_timecode = false;
+    size_t dmx_idx;
+    for (dmx_idx = 0; m_demuxers.size() > dmx_idx; ++dmx_idx) {
+      qtmp4_demuxer_cptr &dmx = m_demuxers[dmx_idx];
+      size_t idx;
+      for (idx = num_entries[dmx_idx]; dmx->get_num_index_entries() > idx; ++idx) {
+        fragment_past_timecode = dmx->get_index_entry(idx).timecode > timecode;
+        if (!fragment_past_timecode)
+          break;
+      }
+      if ((dmx->get_num_index_entries() > num_entries[dmx_idx]) && !fragment_past_timecode)
+        break;
+    }
+
+    for (dmx_idx = 0; m_demuxers.size() > dmx_idx; ++dmx_idx) {
+      qtmp4_demuxer_cptr &dmx = m_demuxers[dmx_idx];
+      if (-1 == dmx->ptzr)
+        continue;
+
+      bool past_timecode = false;
+      size_t idx;
+      for (idx = dmx->m_index_start; dmx->get_num_index_entries() > idx; ++idx) {
+        const qt_index_t &index = dmx->get_index_entry(idx);
+        if (!index.is_keyframe)
+          continue;
+        if (index.timecode > timecode) {
+          past_timecode = true;
+          break;
+        }
+        dmx->start_pos = idx;
+      }
+
+      bool no_entries_left = fragment_past_timecode && (dmx->get_num_index_entries() == num_entries[dmx_idx]);
+
+      dmx->discard_index_entries(dmx->start_pos);
+      num_entries[dmx_idx] = dmx->get_num_index_entries();
+
+      if (!past_timecode && !no_entries_left)
+        done = false;
+    }
+  }
+
+  for (auto &dmx : m_demuxers) {
+    if (-1 == dmx->ptzr)
+      continue;
+
+    dmx->pos = dmx->start_pos;
+    mxverb(2, boost::format("Quicktime/MP4 reader: track %1%: continuing at frame %2%\n") % dmx->id % dmx->pos);
+  }
+
+  return true;
+}
+
+/** \brief Skips to the next movie fragment
+
+   Atoms other than 'moof' are skipped, e.g. the 'mdat' atoms or the
+   'styp' and 'sidx' atoms found in concatenated segments. Afterwards
+   \c m_fragment_pos points to the next 'moof' atom.
+
+   \return \c false if there are no more fragments.
+*/
+bool
+qtmp4_reader_c::find_next_fragment() {
+  try {
+    while (m_fragment_pos < m_size) {
+      m_in->setFilePointer(m_fragment_pos);
+      qt_atom_t atom = read_atom(NULL, false);
+
+      if (FOURCC('m', 'o', 'o', 'f') == atom.fourcc)
+        return true;
+
+      m_fragment_pos = atom.pos + atom.size;
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  } catch (bool) {
+  }
+
+  m_fragment_pos = m_size;
+
+  return false;
+}
+
+/** \brief Parses the next movie fragment
+
+   The samples described by the next 'moof' atom are appended to
+   their tracks' index entries.
+
+   \return \c false if there are no more fragments.
+*/
+bool
+qtmp4_reader_c::read_fragment() {
+  if (!find_next_fragment())
+    return false;
+
+  try {
+    m_in->setFilePointer(m_fragment_pos);
+    qt_atom_t atom = read_atom(NULL, false);
+    m_fragment_pos = atom.pos + atom.size;
+
+    mxdebug_if(m_debug_fragments, boost::format("Movie fragment at %1% size %2%\n") % atom.pos % atom.size);
+
+    m_fragment             = qt_fragment_t();
+    m_fragment.moof_offset = atom.pos;
+    m_fragment.data_pos    = atom.pos;
+    handle_moof_atom(atom.to_parent(), 0);
+
+    return true;
+
+  } catch (mtx::mm_io::exception &) {
+  } catch (bool) {
+  }
+
+  m_fragment_pos = m_size;
+
+  return false;
+}
+
+/** \brief Checks whether another track has samples left that lie behind
+   the samples of \a dmx
+
+   Only the samples from fragments that have already been read and only
+   tracks that are muxed are considered.
+*/
+bool
+qtmp4_reader_c::other_tracks_are_ahead_of(qtmp4_demuxer_c &dmx) {
+  int64_t end_timecode = dmx.to_nsecs(dmx.m_fragment_dts);
+
+  for (auto &other_dmx : m_demuxers)
+    if (   (other_dmx.get_object() != &dmx)
+        && (-1 != other_dmx->ptzr)
+        && (other_dmx->get_num_index_entries() > other_dmx->pos)
+        && (other_dmx->to_nsecs(other_dmx->m_fragment_dts) > end_timecode))
+      return true;
+
+  return false;
+}
+
+void
+qtmp4_reader_c::handle_moof_atom(qt_atom_t parent,
+                                 int level) {
+  while (parent.size > 0) {
+    qt_atom_t atom = read_atom();
+
+    if (FOURCC('t', 'r', 'a', 'f') == atom.fourcc)
+      handle_traf_atom(atom.to_parent(), level + 1);
+
+    skip_atom();
+    parent.size -= atom.size;
+  }
+}
+
+void
+qtmp4_reader_c::handle_traf_atom(qt_atom_t parent,
+                                 int level) {
+  while (parent.size > 0) {
+    qt_atom_t atom = read_atom();
+
+    if (FOURCC('t', 'f', 'h', 'd') == atom.fourcc)
+      handle_tfhd_atom(atom.to_parent(), level + 1);
+
+    else if (FOURCC('t', 'f', 'd', 't') == atom.fourcc)
+      handle_tfdt_atom(atom.to_parent(), level + 1);
+
+    else if (FOURCC('t', 'r', 'u', 'n') == atom.fourcc)
+      handle_trun_atom(atom.to_parent(), level + 1);
+
+    skip_atom();
+    parent.size -= atom.size;
+  }
+}
+
+void
+qtmp4_reader_c::handle_tfhd_atom(qt_atom_t,
+                                 int level) {
+  uint32_t flags       = m_in->read_uint32_be() & 0x00ffffff;
+  m_fragment.track_id  = m_in->read_uint32_be();
+  m_fragment.defaults  = m_track_defaults[m_fragment.track_id];
+
+  // Without an explicit base data offset the data starts at the
+  // beginning of the 'moof' atom for the first track fragment and
+  // right after the previous track fragment's data for all others.
+  if (flags & QTMP4_TFHD_BASE_DATA_OFFSET)
+    m_fragment.base_data_offset = m_in->read_uint64_be();
+  else if (flags & QTMP4_TFHD_DEFAULT_BASE_IS_MOOF)
+    m_fragment.base_data_offset = m_fragment.moof_offset;
+  else
+    m_fragment.base_data_offset = m_fragment.data_pos;
+
+  if (flags & QTMP4_TFHD_SAMPLE_DESCRIPTION_ID)
+    m_fragment.defaults.sample_description_id = m_in->read_uint32_be();
+  if (flags & QTMP4_TFHD_DEFAULT_DURATION)
+    m_fragment.defaults.sample_duration       = m_in->read_uint32_be();
+  if (flags & QTMP4_TFHD_DEFAULT_SIZE)
+    m_fragment.defaults.sample_size           = m_in->read_uint32_be();
+  if (flags & QTMP4_TFHD_DEFAULT_FLAGS)
+    m_fragment.defaults.sample_flags          = m_in->read_uint32_be();
+
+  m_fragment.data_pos = m_fragment.base_data_offset;
+
+  mxdebug_if(m_debug_fragments, boost::format("%1%Track fragment for track %2%: base data offset %3%\n") % space(level * 2 + 1) % m_fragment.track_id % m_fragment.base_data_offset);
+}
+
+void
+qtmp4_reader_c::handle_tfdt_atom(qt_atom_t,
+                                 int) {
+  uint8_t version          = m_in->read_uint8();
+  m_in->skip(3);            // flags
+  uint64_t decode_time     = 1 == version ? m_in->read_uint64_be() : m_in->read_uint32_be();
+  qtmp4_demuxer_c *dmx     = find_fragment_demuxer(m_fragment.track_id);
+
+  if (NULL == dmx)
+    return;
+
+  // seek_fragments_to_timecode() relies on the fragments being stored
+  // in the order of their timecodes.
+  if ((decode_time < dmx->m_fragment_dts) && !dmx->m_fragment_dts_warning_printed) {
+    mxwarn(boost::format(Y("Quicktime/MP4 reader: The decode timestamps of track %1%'s movie fragments go backwards (%2% after %3%). "
+                           "Options that seek to a certain timecode (e.g. '--start-at') may start at the wrong position.\n"))
+           % dmx->id % decode_time % dmx->m_fragment_dts);
+    dmx->m_fragment_dts_warning_printed = true;
+  }
+
+  dmx->m_fragment_dts = decode_time;
+}
+
+void
+qtmp4_reader_c::handle_trun_atom(qt_atom_t parent,
+                                 int level) {
+  uint8_t version           = m_in->read_uint8();
+  uint32_t flags            = m_in->read_uint24_be();
+  uint32_t count            = m_in->read_uint32_be();
+  uint32_t first_flags      = 0;
+  qtmp4_demuxer_c *dmx      = find_fragment_demuxer(m_fragment.track_id);
+
+  if (flags & QTMP4_TRUN_DATA_OFFSET)
+    m_fragment.data_pos = m_fragment.base_data_offset + static_cast<int32_t>(m_in->read_uint32_be());
+  if (flags & QTMP4_TRUN_FIRST_SAMPLE_FLAGS)
+    first_flags = m_in->read_uint32_be();
+
+  uint64_t entry_size = (  ((flags & QTMP4_TRUN_SAMPLE_DURATION) ? 4 : 0) + ((flags & QTMP4_TRUN_SAMPLE_SIZE)                   ? 4 : 0)
+                         + ((flags & QTMP4_TRUN_SAMPLE_FLAGS)    ? 4 : 0) + ((flags & QTMP4_TRUN_SAMPLE_COMPOSITION_OFFSET) ? 4 : 0));
+  uint64_t available  = parent.size - (m_in->getFilePointer() - parent.pos);
+  if ((0 != entry_size) && ((count * entry_size) > available))
+    count = available / entry_size;
+
+  else if ((0 == entry_size) && (0 == m_fragment.defaults.sample_size) && (0 != count)) {
+    mxwarn(boost::format(Y("Quicktime/MP4 reader: The track run for track %1% consists of %2% samples without any data. It will be ignored.\n"))
+           % m_fragment.track_id % count);
+    count = 0;
+  }
+
+  mxdebug_if(m_debug_fragments, boost::format("%1%Track run: %2% samples at %3%\n") % space(level * 2 + 1) % count % m_fragment.data_pos);
+
+  uint32_t i;
+  for (i = 0; count > i; ++i) {
+    uint32_t duration     = (flags & QTMP4_TRUN_SAMPLE_DURATION) ? m_in->read_uint32_be() : m_fragment.defaults.sample_duration;
+    uint32_t size         = (flags & QTMP4_TRUN_SAMPLE_SIZE)     ? m_in->read_uint32_be() : m_fragment.defaults.sample_size;
+    uint32_t sample_flags = (flags & QTMP4_TRUN_SAMPLE_FLAGS)    ? m_in->read_uint32_be() : m_fragment.defaults.sample_flags;
+    int64_t offset        = 0;
+
+    if (flags & QTMP4_TRUN_SAMPLE_COMPOSITION_OFFSET)
+      offset = 0 == version ? static_cast<int64_t>(m_in->read_uint32_be()) : static_cast<int32_t>(m_in->read_uint32_be());
+    if ((0 == i) && (flags & QTMP4_TRUN_FIRST_SAMPLE_FLAGS))
+      sample_flags = first_flags;
+
+    // The number of samples is only limited by the atom's size if
+    // their values are stored in it. Otherwise their data must still
+    // lie within the file.
+    if ((m_fragment.data_pos + size) > m_size) {
+      mxwarn(boost::format(Y("Quicktime/MP4 reader: The track run for track %1% references %2% samples, but only %3% of them lie within the file.\n"))
+             % m_fragment.track_id % count % i);
+      break;
+    }
+
+    if (NULL != dmx) {
+      int64_t timecode = dmx->to_nsecs(dmx->m_fragment_dts);
+
+      // Same as with the 'ctts' atom for non-fragmented files.
+      if (('v' == dmx->type) && dmx->v_is_avc) {
+        if (0 == dmx->get_num_index_entries())
+          dmx->v_dts_offset = dmx->to_nsecs(offset);
+        timecode += dmx->to_nsecs(offset) - dmx->v_dts_offset;
+      }
+
+      dmx->add_index_entry(qt_index_t(m_fragment.data_pos, size, timecode, dmx->to_nsecs(duration), !(sample_flags & QTMP4_SAMPLE_IS_NON_SYNC)));
+      dmx->m_fragment_dts += duration;
+    }
+
+    m_fragment.data_pos += size;
+  }
+}
+
+/** \brief Returns the demuxer the current track fragment belongs to
+
+   Returns \c NULL for unknown or unusable tracks and, once the
+   packetizers have been created, for tracks that aren't muxed so that
+   no index entries are collected for them.
+*/
+qtmp4_demuxer_c *
+qtmp4_reader_c::find_fragment_demuxer(uint32_t track_id) {
+  for (auto &dmx : m_demuxers)
+    if (dmx->ok && (dmx->id == track_id))
+      return (m_reader_packetizers.empty() || (-1 != dmx->ptzr)) ? dmx.get_object() : NULL;
+
+  return NULL;
+}
+
 uint32_t
 qtmp4_reader_c::read_esds_descr_len(mm_mem_io_c &memio) {
   uint32_t len           = 0;
@@ -1464,7 +2069,7 @@ qtmp4_reader_c::create_video_packetizer_mpeg1_2(qtmp4_demuxer_cptr &dmx) {
 
 void
 qtmp4_reader_c::create_video_packetizer_mpeg4_p10(qtmp4_demuxer_cptr &dmx) {
-  if (dmx->frame_offset_table.empty())
+  if ((0 == dmx->num_frame_offsets) && !dmx->m_fragmented)
     mxwarn_tid(m_ti.m_fname, dmx->id,
                Y("The AVC video track is missing the 'CTTS' atom for frame timecode offsets. "
                  "However, AVC/h.264 allows frames to have more than the traditional one (for P frames) or two (for B frames) references to other frames. "
@@ -1605,10 +2210,12 @@ qtmp4_reader_c::get_progress() {
   if (-1 == m_main_dmx)
     return 100;
 
+  if (m_fragmented)
+    return 100 * m_fragment_pos / m_size;
+
   qtmp4_demuxer_cptr &dmx = m_demuxers[m_main_dmx];
-  unsigned int max_chunks = (0 == dmx->sample_size) ? dmx->sample_table.size() : dmx->chunk_table.size();
 
-  return 100 * dmx->pos / max_chunks;
+  return 100 * dmx->pos / dmx->get_num_index_entries();
 }
 
 void
@@ -1689,28 +2296,41 @@ qtmp4_reader_c::recode_chapter_entries(std::vector<qtmp4_chapter_entry_t> &entri
 }
 
 // ----------------------------------------------------------------------
-
 void
 qtmp4_demuxer_c::calculate_fps() {
   fps = 0.0;
 
-  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == frame_offset_table.size()))) {
+  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == num_frame_offsets))) {
     // Constant FPS. Let's set the default duration.
     fps = (double)time_scale / (double)durmap_table[0].duration;
     mxdebug_if(m_debug_fps, boost::format("calculate_fps: case 1: %1%\n") % fps);
 
-  } else if (!sample_table.empty()) {
+  } else if (!sample_size_table.empty() || m_fragmented) {
     std::map<int64_t, int> duration_map;
 
-    std::accumulate(sample_table.begin() + 1, sample_table.end(), sample_table[0], [&](qt_sample_t &previous_sample, qt_sample_t &current_sample) {
-      duration_map[current_sample.pts - previous_sample.pts]++;
-      return current_sample;
-    });
+    if (m_fragmented) {
+      // Only the first fragment's durations (already in ns) are known.
+      for (auto &index : m_index)
+        duration_map[index.duration]++;
+
+    } else {
+      uint64_t previous_pts = get_sample_pts(0);
+      uint64_t sample;
+
+      for (sample = 1; get_num_samples() > sample; ++sample) {
+        uint64_t pts = get_sample_pts(sample);
+        duration_map[pts - previous_pts]++;
+        previous_pts = pts;
+      }
+    }
+
+    if (duration_map.empty())
+      return;
 
     auto most_common = std::accumulate(duration_map.begin(), duration_map.end(), std::pair<int64_t, int>(*duration_map.begin()),
                                        [](std::pair<int64_t, int> &a, std::pair<int64_t, int> e) { return e.second > a.second ? e : a; });
     if (most_common.first)
-      fps = (double)1000000000.0 / (double)to_nsecs(most_common.first);
+      fps = (double)1000000000.0 / (double)(m_fragmented ? most_common.first : to_nsecs(most_common.first));
 
     mxdebug_if(m_debug_fps, boost::format("calculate_fps: case 2: most_common %1% = %2%, fps %3%\n") % most_common.first % most_common.second % fps);
   }
@@ -1731,71 +2351,41 @@ qtmp4_demuxer_c::to_nsecs(int64_t value) {
   return value / (time_scale / 1000000000ll);
 }
 
+/** \brief Determines the timecode range and the average frame duration
+
+   The timecodes themselves are not stored. They're calculated again
+   for each index entry in create_index_entry().
+*/
 void
 qtmp4_demuxer_c::calculate_timecodes() {
-  unsigned int frame;
-
-  if (0 != sample_size) {
-    for (frame = 0; chunk_table.size() > frame; ++frame) {
-      timecodes.push_back(to_nsecs((uint64_t)chunk_table[frame].samples * (uint64_t)duration));
-      durations.push_back(to_nsecs((uint64_t)chunk_table[frame].size    * (uint64_t)duration));
-      frame_indices.push_back(frame);
-    }
-
-    if (!timecodes.empty())
-      min_timecode = max_timecode = timecodes[0];
-
+  // In constant sample size mode the first chunk always starts at
+  // timecode 0, and min_timecode/max_timecode stay at 0.
+  if (0 != sample_size)
     return;
-  }
-
-  int64_t v_dts_offset = 0;
-  std::vector<int64_t> timecodes_before_offsets;
-
-  if (('v' == type) && v_is_avc && !frame_offset_table.empty())
-    v_dts_offset = to_nsecs(frame_offset_table[0]);
 
-  for (frame = 0; sample_table.size() > frame; ++frame) {
-    int64_t timecode;
+  if (('v' == type) && v_is_avc && (0 != num_frame_offsets))
+    v_dts_offset = to_nsecs(get_frame_offset(0));
 
-    if (!editlist_table.empty()) {
-      unsigned int editlist_pos = 0;
-      unsigned int real_frame   = frame;
+  int64_t previous_timecode = 0, num_good_frames = 0;
+  uint64_t frame, real_frame;
 
-      while (((editlist_table.size() - 1) > editlist_pos) && (frame >= editlist_table[editlist_pos + 1].start_frame))
-        ++editlist_pos;
+  avg_duration = 0;
 
-      if ((editlist_table[editlist_pos].start_frame + editlist_table[editlist_pos].frames) <= frame) {
-        // EOF
-        // calc pts:
-        timecode = to_nsecs(sample_table[real_frame].pts);
+  for (frame = 0; get_num_samples() > frame; ++frame) {
+    int64_t timecode = get_timecode_before_offset(frame, real_frame);
 
-      } else {
-        // calc real frame index:
-        real_frame -= editlist_table[editlist_pos].start_frame;
-        real_frame += editlist_table[editlist_pos].start_sample;
-
-        // calc pts:
-        timecode = to_nsecs(sample_table[real_frame].pts + editlist_table[editlist_pos].pts_offset);
+    if (0 != frame) {
+      int64_t diff = timecode - previous_timecode;
+      if (0 < diff) {
+        ++num_good_frames;
+        avg_duration += diff;
       }
-
-      frame_indices.push_back(real_frame);
-
-      timecodes_before_offsets.push_back(timecode);
-
-      if (('v' == type) && (frame_offset_table.size() > real_frame) && v_is_avc)
-         timecode += to_nsecs(frame_offset_table[real_frame]) - v_dts_offset;
-
-    } else {
-      timecode = to_nsecs(sample_table[frame].pts);
-      frame_indices.push_back(frame);
-
-      timecodes_before_offsets.push_back(timecode);
-
-      if (('v' == type) && (frame_offset_table.size() > frame) && v_is_avc)
-         timecode += to_nsecs(frame_offset_table[frame]) - v_dts_offset;
     }
 
-    timecodes.push_back(timecode);
+    previous_timecode = timecode;
+
+    if (('v' == type) && (num_frame_offsets > real_frame) && v_is_avc)
+      timecode += to_nsecs(get_frame_offset(real_frame)) - v_dts_offset;
 
     if (timecode > max_timecode)
       max_timecode = timecode;
@@ -1803,80 +2393,55 @@ qtmp4_demuxer_c::calculate_timecodes() {
       min_timecode = timecode;
   }
 
-  int64_t avg_duration = 0, num_good_frames = 0;
-
-  for (frame = 0; timecodes_before_offsets.size() > (frame + 1); ++frame) {
-    int64_t diff = timecodes_before_offsets[frame + 1] - timecodes_before_offsets[frame];
-
-    if (0 >= diff)
-      durations.push_back(0);
-    else {
-      ++num_good_frames;
-      avg_duration += diff;
-      durations.push_back(diff);
-    }
-  }
-
-  durations.push_back(0);
-
-  if (num_good_frames) {
+  if (num_good_frames)
     avg_duration /= num_good_frames;
-    for (frame = 0; durations.size() > frame; ++frame)
-      if (!durations[frame])
-        durations[frame] = avg_duration;
-  }
 }
 
 void
 qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
-  size_t i;
-
-  for (i = 0; timecodes.size() > i; ++i)
-    timecodes[i] += delta;
-
-  min_timecode += delta;
-  max_timecode += delta;
+  timecode_offset += delta;
+  min_timecode    += delta;
+  max_timecode    += delta;
 }
 
+/** \brief Prepares the run-length encoded tables for random access
+
+   Each chunk map, duration map and frame offset entry is annotated
+   with the number of the first sample it applies to so that the
+   values for a single sample can be looked up with a binary search
+   instead of expanding the tables to one entry per sample.
+*/
 void
 qtmp4_demuxer_c::update_tables(int64_t global_m_time_scale) {
-  uint64_t last = chunk_table.size();
+  uint64_t last = chunk_offset_table.size();
 
   // process chunkmap:
-  size_t j, i = chunkmap_table.size();
+  size_t i = chunkmap_table.size();
   while (i > 0) {
     --i;
-    for (j = chunkmap_table[i].first_chunk; j < last; ++j) {
-      chunk_table[j].desc = chunkmap_table[i].sample_description_id;
-      chunk_table[j].size = chunkmap_table[i].samples_per_chunk;
-    }
+    qt_chunkmap_t &chunkmap = chunkmap_table[i];
+    chunkmap.num_chunks     = chunkmap.first_chunk < last ? last - chunkmap.first_chunk : 0;
 
-    last = chunkmap_table[i].first_chunk;
+    last = chunkmap.first_chunk;
 
-    if (chunk_table.size() <= last)
+    if (chunk_offset_table.size() <= last)
       break;
   }
 
-  // calc pts of chunks:
+  // calc first sample of each chunkmap:
   uint64_t s = 0;
-  for (j = 0; j < chunk_table.size(); ++j) {
-    chunk_table[j].samples  = s;
-    s                      += chunk_table[j].size;
+  for (auto &chunkmap : chunkmap_table) {
+    chunkmap.first_sample  = s;
+    s                     += static_cast<uint64_t>(chunkmap.num_chunks) * chunkmap.samples_per_chunk;
   }
 
   // workaround for fixed-size video frames (dv and uncompressed)
-  if (sample_table.empty() && ('a' != type)) {
-    for (i = 0; i < s; ++i) {
-      qt_sample_t sample;
-
-      sample.size = sample_size;
-      sample_table.push_back(sample);
-    }
-
+  if (sample_size_table.empty() && ('a' != type)) {
+    sample_size_table.resize(s, sample_size);
     sample_size = 0;
   }
 
-  if (sample_table.empty()) {
+  if (sample_size_table.empty()) {
     // constant sampesize
     if ((1 == durmap_table.size()) || ((2 == durmap_table.size()) && (1 == durmap_table[1].number)))
       duration = durmap_table[0].duration;
@@ -1886,46 +2451,97 @@ qtmp4_demuxer_c::update_tables(int64_t global_m_time_scale) {
     return;
   }
 
-  // calc pts:
+  // calc pts of first sample of each durmap:
   s            = 0;
   uint64_t pts = 0;
 
-  for (j = 0; j < durmap_table.size(); ++j) {
-    for (i = 0; i < durmap_table[j].number; ++i) {
-      sample_table[s].pts  = pts;
-      pts                 += durmap_table[j].duration;
-      ++s;
-    }
+  for (auto &durmap : durmap_table) {
+    durmap.first_sample  = s;
+    durmap.first_pts     = pts;
+    s                   += durmap.number;
+    pts                 += static_cast<uint64_t>(durmap.number) * durmap.duration;
   }
 
-  // calc sample offsets
+  // calc first sample of each pts/dts offset
   s = 0;
-  for (j = 0; j < chunk_table.size(); ++j) {
-    uint64_t chunk_pos = chunk_table[j].pos;
+  for (auto &frame_offset : raw_frame_offset_table) {
+    frame_offset.first_sample  = s;
+    s                         += frame_offset.count;
+  }
 
-    for (i = 0; i < chunk_table[j].size; ++i) {
-      sample_table[s].pos  = chunk_pos;
-      chunk_pos           += sample_table[s].size;
-      ++s;
-    }
+  num_frame_offsets = s;
+
+  mxdebug_if(m_debug_tables, boost::format(" Frame offset table: %1% entries\n")    % num_frame_offsets);
+  mxdebug_if(m_debug_tables, boost::format(" Sample table contents: %1% entries\n") % get_num_samples());
+  if (m_debug_tables)
+    for (s = 0; get_num_samples() > s; ++s)
+      mxdebug(boost::format("   %1%: pts %2% size %3% pos %4%\n") % s % get_sample_pts(s) % get_sample_size(s) % get_sample_pos(s));
+
+  if (m_debug_index)
+    verify_sample_tables();
+
+  update_editlist_table(global_m_time_scale);
+}
+
+/** \brief Compares the sample positions and timestamps with fully expanded tables
+
+   The tables are expanded the way the reader used to do it before the
+   index entries were created on demand: one entry per chunk with its
+   number of samples and one entry per sample with its timestamp and
+   position. Each sample is then compared with the values returned by
+   get_sample_pts() and get_sample_pos(). Only used for '--debug
+   qtmp4_index'.
+*/
+void
+qtmp4_demuxer_c::verify_sample_tables() {
+  std::vector<uint32_t> samples_per_chunk(chunk_offset_table.size(), 0);
+  size_t last = chunk_offset_table.size(), i = chunkmap_table.size();
+
+  while (i > 0) {
+    --i;
+    for (size_t chunk = chunkmap_table[i].first_chunk; chunk < last; ++chunk)
+      samples_per_chunk[chunk] = chunkmap_table[i].samples_per_chunk;
+    last = chunkmap_table[i].first_chunk;
+    if (chunk_offset_table.size() <= last)
+      break;
   }
 
-  // calc pts/dts offsets
-  for (j = 0; j < raw_frame_offset_table.size(); ++j) {
-    size_t k;
+  std::vector<uint64_t> sample_pts, sample_pos;
+  uint64_t pts = 0;
+
+  for (auto &durmap : durmap_table)
+    for (size_t k = 0; durmap.number > k; ++k) {
+      sample_pts.push_back(pts);
+      pts += durmap.duration;
+    }
 
-    for (k = 0; k < raw_frame_offset_table[j].count; ++k)
-      frame_offset_table.push_back(raw_frame_offset_table[j].offset);
+  for (size_t chunk = 0; chunk_offset_table.size() > chunk; ++chunk) {
+    uint64_t pos = chunk_offset_table[chunk];
+    for (size_t k = 0; (samples_per_chunk[chunk] > k) && (get_num_samples() > sample_pos.size()); ++k) {
+      sample_pos.push_back(pos);
+      pos += get_sample_size(sample_pos.size() - 1);
+    }
   }
 
-  mxdebug_if(m_debug_tables, boost::format(" Frame offset table: %1% entries\n")    % frame_offset_table.size());
-  mxdebug_if(m_debug_tables, boost::format(" Sample table contents: %1% entries\n") % sample_table.size());
-  for (i = 0; i < sample_table.size(); ++i) {
-    qt_sample_t &sample = sample_table[i];
-    mxdebug_if(m_debug_tables, boost::format("   %1%: pts %2% size %3% pos %4%\n") % i % sample.pts % sample.size % sample.pos);
+  size_t num_pts_mismatches = 0, num_pos_mismatches = 0;
+
+  for (uint64_t sample = 0; get_num_samples() > sample; ++sample) {
+    if ((sample_pts.size() > sample) && (get_sample_pts(sample) != sample_pts[sample])) {
+      mxdebug(boost::format("Track %1%: sample %2%: pts %3% instead of %4%\n") % id % sample % get_sample_pts(sample) % sample_pts[sample]);
+      ++num_pts_mismatches;
+    }
+
+    if ((sample_pos.size() > sample) && (get_sample_pos(sample) != sample_pos[sample])) {
+      mxdebug(boost::format("Track %1%: sample %2%: position %3% instead of %4%\n") % id % sample % get_sample_pos(sample) % sample_pos[sample]);
+      ++num_pos_mismatches;
+    }
   }
 
-  update_editlist_table(global_m_time_scale);
+  mxdebug(boost::format("Track %1%: verified %2% samples against the expanded tables: %3% timestamp and %4% position mismatch(es)\n")
+          % id % get_num_samples() % num_pts_mismatches % num_pos_mismatches);
+
+  // Don't let the following reads depend on the verification's lookups.
+  m_cached_chunk_end = 0;
 }
 
 // Also taken from mplayer's demux_mov.c file.
@@ -1941,8 +2557,8 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
     min_editlist_pts = std::min(static_cast<int64_t>(editlist_table[i].pos), min_editlist_pts);
 
   uint64_t pts_offset = 0;
-  if (('v' == type) && v_is_avc && !frame_offset_table.empty() && (frame_offset_table[0] <= min_editlist_pts))
-    pts_offset = frame_offset_table[0];
+  if (('v' == type) && v_is_avc && (0 != num_frame_offsets) && (get_frame_offset(0) <= min_editlist_pts))
+    pts_offset = get_frame_offset(0);
 
   mxdebug_if(m_debug_tables, boost::format("Updating edit list table for track %1%; pts_offset = %2%\n") % id % pts_offset);
 
@@ -1963,18 +2579,18 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
     el.start_frame      = frame;
 
     // find start sample
-    for (; sample_table.size() > sample; ++sample)
-      if (pts <= sample_table[sample].pts)
+    for (; get_num_samples() > sample; ++sample)
+      if (pts <= get_sample_pts(sample))
         break;
 
     el.start_sample  = sample;
-    el.pts_offset    = ((int64_t)e_pts       * (int64_t)time_scale) / (int64_t)global_time_scale - (int64_t)sample_table[sample].pts;
+    el.pts_offset    = ((int64_t)e_pts       * (int64_t)time_scale) / (int64_t)global_time_scale - (int64_t)get_sample_pts(sample);
     pts             += ((int64_t)el.duration * (int64_t)time_scale) / (int64_t)global_time_scale;
     e_pts           += el.duration;
 
     // find end sample
-    for (; sample_table.size() > sample; ++sample)
-      if (pts <= sample_table[sample].pts)
+    for (; get_num_samples() > sample; ++sample)
+      if (pts <= get_sample_pts(sample))
         break;
 
     el.frames  = sample - el.start_sample;
@@ -1984,70 +2600,213 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
   }
 }
 
-void
-qtmp4_demuxer_c::build_index() {
-  if (sample_size != 0)
-    build_index_constant_sample_size_mode();
-  else
-    build_index_chunk_mode();
+uint64_t
+qtmp4_demuxer_c::get_num_samples() {
+  return sample_size_table.size();
 }
 
-void
-qtmp4_demuxer_c::build_index_constant_sample_size_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
+uint64_t
+qtmp4_demuxer_c::get_sample_pts(uint64_t sample) {
+  auto durmap = std::upper_bound(durmap_table.begin(), durmap_table.end(), sample, [](uint64_t s, const qt_durmap_t &d) { return s < d.first_sample; });
+  if (durmap_table.begin() == durmap)
+    return 0;
 
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < chunk_table.size(); ++frame_idx) {
-    uint64_t frame_size;
+  --durmap;
+  if ((durmap->first_sample + durmap->number) <= sample)
+    return 0;
 
-    if (1 != sample_size) {
-      frame_size = chunk_table[frame_idx].size * sample_size;
+  return durmap->first_pts + (sample - durmap->first_sample) * durmap->duration;
+}
 
-    } else {
-      frame_size = chunk_table[frame_idx].size;
-
-      if ('a' == type) {
-        sound_v1_stsd_atom_t *sound_stsd_atom = (sound_v1_stsd_atom_t *)a_stsd->get_buffer();
-        if (get_uint16_be(&sound_stsd_atom->v0.version) == 1) {
-          frame_size *= get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame);
-          frame_size /= get_uint32_be(&sound_stsd_atom->v1.samples_per_packet);
-        } else
-          frame_size  = frame_size * a_channels * get_uint16_be(&sound_stsd_atom->v0.sample_size) / 8;
-      }
-    }
+uint32_t
+qtmp4_demuxer_c::get_sample_size(uint64_t sample) {
+  return sample_size_table.size() > sample ? sample_size_table[sample] : 0;
+}
+
+/** \brief Returns a sample's position in the file
 
-    bool is_keyframe = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
+   The position is the chunk's offset plus the sizes of the chunk's
+   preceding samples. Consecutive samples from the same chunk are
+   answered from the previous call's result.
+*/
+uint64_t
+qtmp4_demuxer_c::get_sample_pos(uint64_t sample) {
+  if (m_cached_chunk_end > sample) {
+    if (m_cached_sample == sample)
+      return m_cached_sample_pos;
+
+    if ((m_cached_sample + 1) == sample) {
+      m_cached_sample_pos += get_sample_size(m_cached_sample);
+      m_cached_sample      = sample;
+      return m_cached_sample_pos;
     }
+  }
+
+  auto chunkmap = std::upper_bound(chunkmap_table.begin(), chunkmap_table.end(), sample, [](uint64_t s, const qt_chunkmap_t &c) { return s < c.first_sample; });
+  if (chunkmap_table.begin() == chunkmap)
+    return 0;
+
+  --chunkmap;
+  if ((chunkmap->first_sample + static_cast<uint64_t>(chunkmap->num_chunks) * chunkmap->samples_per_chunk) <= sample)
+    return 0;
+
+  uint64_t chunk_in_map        = (sample - chunkmap->first_sample) / chunkmap->samples_per_chunk;
+  uint64_t first_chunk_sample  = chunkmap->first_sample + chunk_in_map * chunkmap->samples_per_chunk;
+  m_cached_sample_pos          = chunk_offset_table[chunkmap->first_chunk + chunk_in_map];
+
+  for (m_cached_sample = first_chunk_sample; sample > m_cached_sample; ++m_cached_sample)
+    m_cached_sample_pos += get_sample_size(m_cached_sample);
+
+  m_cached_chunk_end = first_chunk_sample + chunkmap->samples_per_chunk;
+
+  return m_cached_sample_pos;
+}
 
-    m_index.push_back(qt_index_t(chunk_table[frame_idx].pos, frame_size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
+int32_t
+qtmp4_demuxer_c::get_frame_offset(uint64_t sample) {
+  auto frame_offset = std::upper_bound(raw_frame_offset_table.begin(), raw_frame_offset_table.end(), sample, [](uint64_t s, const qt_frame_offset_t &f) { return s < f.first_sample; });
+  if (raw_frame_offset_table.begin() == frame_offset)
+    return 0;
+
+  --frame_offset;
+  if ((frame_offset->first_sample + frame_offset->count) <= sample)
+    return 0;
+
+  return frame_offset->offset;
+}
+
+int64_t
+qtmp4_demuxer_c::get_timecode_before_offset(size_t frame,
+                                            uint64_t &real_frame) {
+  real_frame = frame;
+
+  if (editlist_table.empty())
+    return to_nsecs(get_sample_pts(frame));
+
+  unsigned int editlist_pos = 0;
+
+  while (((editlist_table.size() - 1) > editlist_pos) && (frame >= editlist_table[editlist_pos + 1].start_frame))
+    ++editlist_pos;
+
+  qt_editlist_t &el = editlist_table[editlist_pos];
+
+  if ((el.start_frame + el.frames) <= frame)
+    // EOF
+    return to_nsecs(get_sample_pts(frame));
+
+  // calc real frame index:
+  real_frame = static_cast<unsigned int>(frame - el.start_frame + el.start_sample);
+
+  return to_nsecs(get_sample_pts(real_frame) + el.pts_offset);
+}
+
+bool
+qtmp4_demuxer_c::is_keyframe(size_t frame) {
+  return keyframe_table.empty() || std::binary_search(keyframe_table.begin(), keyframe_table.end(), frame + 1);
+}
+
+size_t
+qtmp4_demuxer_c::get_num_index_entries() {
+  if (m_fragmented)
+    return m_index_start + m_index.size();
+
+  return 0 != sample_size ? chunk_offset_table.size() : sample_size_table.size();
+}
+
+/** \brief Returns the index entry for frame number \a idx
+
+   The entries are created on demand and kept until
+   discard_index_entries() is called for them. Requesting entries in
+   ascending order only creates each entry once. For fragmented files
+   only the entries added by the fragments read so far are available.
+*/
+const qt_index_t &
+qtmp4_demuxer_c::get_index_entry(size_t idx) {
+  if ((m_index_start > idx) || ((m_index_start + m_index.size()) < idx)) {
+    m_num_index_entries_discarded += m_index.size();
+    m_index.clear();
+    m_index_start = idx;
   }
+
+  while ((m_index_start + m_index.size()) <= idx)
+    add_index_entry(create_index_entry(m_index_start + m_index.size()));
+
+  return m_index[idx - m_index_start];
 }
 
 void
-qtmp4_demuxer_c::build_index_chunk_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
-
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < frame_indices.size(); ++frame_idx) {
-    int act_frame_idx = frame_indices[frame_idx];
-
-    bool is_keyframe  = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
-    }
+qtmp4_demuxer_c::add_index_entry(const qt_index_t &index) {
+  m_index.push_back(index);
+
+  ++m_num_index_entries_created;
+  m_max_num_index_entries = std::max<uint64_t>(m_max_num_index_entries, m_index.size());
+}
+
+void
+qtmp4_demuxer_c::discard_index_entries(size_t idx) {
+  while (!m_index.empty() && (m_index_start < idx)) {
+    m_index.pop_front();
+    ++m_index_start;
+    ++m_num_index_entries_discarded;
+  }
+}
+
+qt_index_t
+qtmp4_demuxer_c::create_index_entry(size_t idx) {
+  return 0 != sample_size ? create_index_entry_constant_sample_size_mode(idx) : create_index_entry_chunk_mode(idx);
+}
+
+qt_index_t
+qtmp4_demuxer_c::create_index_entry_constant_sample_size_mode(size_t frame) {
+  uint64_t samples_before = 0, chunk_size = 0;
+
+  auto chunkmap = std::upper_bound(chunkmap_table.begin(), chunkmap_table.end(), frame, [](size_t f, const qt_chunkmap_t &c) { return f < c.first_chunk; });
+  if (chunkmap_table.begin() != chunkmap) {
+    --chunkmap;
+    if ((chunkmap->first_chunk + chunkmap->num_chunks) > frame) {
+      samples_before = chunkmap->first_sample + (frame - chunkmap->first_chunk) * chunkmap->samples_per_chunk;
+      chunk_size     = chunkmap->samples_per_chunk;
+    } else
+      samples_before = chunkmap->first_sample + static_cast<uint64_t>(chunkmap->num_chunks) * chunkmap->samples_per_chunk;
+  }
+
+  uint64_t frame_size;
 
-    m_index.push_back(qt_index_t(sample_table[act_frame_idx].pos, sample_table[act_frame_idx].size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
+  if (1 != sample_size) {
+    frame_size = chunk_size * sample_size;
+
+  } else {
+    frame_size = chunk_size;
+
+    if ('a' == type) {
+      sound_v1_stsd_atom_t *sound_stsd_atom = (sound_v1_stsd_atom_t *)a_stsd->get_buffer();
+      if (get_uint16_be(&sound_stsd_atom->v0.version) == 1) {
+        frame_size *= get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame);
+        frame_size /= get_uint32_be(&sound_stsd_atom->v1.samples_per_packet);
+      } else
+        frame_size  = frame_size * a_channels * get_uint16_be(&sound_stsd_atom->v0.sample_size) / 8;
+    }
   }
+
+  return qt_index_t(chunk_offset_table[frame], frame_size, to_nsecs(samples_before * (uint64_t)duration) + timecode_offset, to_nsecs(chunk_size * (uint64_t)duration),
+                    is_keyframe(frame));
+}
+
+qt_index_t
+qtmp4_demuxer_c::create_index_entry_chunk_mode(size_t frame) {
+  uint64_t real_frame, next_real_frame;
+  int64_t timecode       = get_timecode_before_offset(frame, real_frame);
+  int64_t frame_duration = 0;
+
+  if ((frame + 1) < get_num_samples())
+    frame_duration = get_timecode_before_offset(frame + 1, next_real_frame) - timecode;
+  if (0 >= frame_duration)
+    frame_duration = avg_duration;
+
+  if (('v' == type) && (num_frame_offsets > real_frame) && v_is_avc)
+    timecode += to_nsecs(get_frame_offset(real_frame)) - v_dts_offset;
+
+  return qt_index_t(get_sample_pos(real_frame), get_sample_size(real_frame), timecode + timecode_offset, frame_duration, is_keyframe(frame));
 }
 
 bool
@@ -2057,8 +2816,8 @@ qtmp4_demuxer_c::read_first_bytes(memory_cptr &buf,
   size_t buf_pos = 0;
   size_t idx_pos = 0;
 
-  while ((0 < num_bytes) && (idx_pos < m_index.size())) {
-    qt_index_t &index          = m_index[idx_pos];
+  while ((0 < num_bytes) && (idx_pos < get_num_index_entries())) {
+    const qt_index_t &index    = get_index_entry(idx_pos);
     uint64_t num_bytes_to_read = std::min((int64_t)num_bytes, index.size);
 
     in->setFilePointer(index.file_pos);
@@ -26,24 +26,14 @@
 struct qt_durmap_t {
   uint32_t number;
   uint32_t duration;
+  uint64_t first_sample;
+  uint64_t first_pts;
 
   qt_durmap_t():
     number(0),
-    duration(0) {
-  }
-};
-
-struct qt_chunk_t {
-  uint32_t samples;
-  uint32_t size;
-  uint32_t desc;
-  uint64_t pos;
-
-  qt_chunk_t():
-    samples(0),
-    size(0),
-    desc(0),
-    pos(0) {
+    duration(0),
+    first_sample(0),
+    first_pts(0) {
   }
 };
 
@@ -51,11 +41,15 @@ struct qt_chunkmap_t {
   uint32_t first_chunk;
   uint32_t samples_per_chunk;
   uint32_t sample_description_id;
+  uint32_t num_chunks;
+  uint64_t first_sample;
 
   qt_chunkmap_t():
     first_chunk(0),
     samples_per_chunk(0),
-    sample_description_id(0) {
+    sample_description_id(0),
+    num_chunks(0),
+    first_sample(0) {
   }
 };
 
@@ -79,25 +73,44 @@ struct qt_editlist_t {
   }
 };
 
-struct qt_sample_t {
-  uint64_t pts;
-  uint32_t size;
-  uint64_t pos;
-
-  qt_sample_t():
-    pts(0),
-    size(0),
-    pos(0) {
-  }
-};
-
 struct qt_frame_offset_t {
   uint32_t count;
   uint32_t offset;
+  uint64_t first_sample;
 
   qt_frame_offset_t():
     count(0),
-    offset(0) {
+    offset(0),
+    first_sample(0) {
+  }
+};
+
+struct qt_track_defaults_t {
+  uint32_t sample_description_id;
+  uint32_t sample_duration;
+  uint32_t sample_size;
+  uint32_t sample_flags;
+
+  qt_track_defaults_t():
+    sample_description_id(0),
+    sample_duration(0),
+    sample_size(0),
+    sample_flags(0) {
+  }
+};
+
+struct qt_fragment_t {
+  uint32_t track_id;
+  uint64_t moof_offset;
+  uint64_t base_data_offset;
+  uint64_t data_pos;
+  qt_track_defaults_t defaults;
+
+  qt_fragment_t():
+    track_id(0),
+    moof_offset(0),
+    base_data_offset(0),
+    data_pos(0) {
   }
 };
 
@@ -115,13 +128,37 @@ struct qt_index_t {
   };
 };
 
+// A buffer read by qtmp4_reader_c::fetch_samples_from_window(). Its
+// samples are queued as slices which keep the whole buffer alive.
+struct qt_fetch_window_t {
+  int64_t size, queued_size;
+  size_t num_queued;
+
+  qt_fetch_window_t(int64_t size_):
+    size(size_),
+    queued_size(0),
+    num_queued(0) {
+  };
+};
+typedef counted_ptr<qt_fetch_window_t> qt_fetch_window_cptr;
+
+struct qt_fetched_sample_t {
+  memory_cptr data;
+  qt_fetch_window_cptr window; // not set once the data has been copied out
+
+  qt_fetched_sample_t(memory_cptr data_, qt_fetch_window_cptr window_):
+    data(data_),
+    window(window_) {
+  };
+};
+
 struct qtmp4_demuxer_c {
   bool ok;
 
   char type;
   uint32_t id;
   char fourcc[4];
-  uint32_t pos;
+  uint32_t pos, start_pos;
 
   uint32_t time_scale;
   uint64_t global_duration;
@@ -129,20 +166,32 @@ struct qtmp4_demuxer_c {
 
   uint64_t duration;
 
-  std::vector<qt_sample_t> sample_table;
-  std::vector<qt_chunk_t> chunk_table;
+  // The sample tables are kept the way they're stored in the file:
+  // run-length encoded where the file does so (stts, stsc, ctts) and
+  // one entry per sample or chunk otherwise (stsz, stco/co64).
+  std::vector<uint32_t> sample_size_table;
+  std::vector<uint64_t> chunk_offset_table;
   std::vector<qt_chunkmap_t> chunkmap_table;
   std::vector<qt_durmap_t> durmap_table;
   std::vector<uint32_t> keyframe_table;
   std::vector<qt_editlist_t> editlist_table;
   std::vector<qt_frame_offset_t> raw_frame_offset_table;
-  std::vector<int32_t> frame_offset_table;
 
-  std::vector<int64_t> timecodes, durations, frame_indices;
+  uint64_t num_frame_offsets;
+
+  // The index entries are created from the tables on demand. Only the
+  // ones from m_index_start onwards that haven't been read yet are kept.
+  std::deque<qt_index_t> m_index;
+  size_t m_index_start;
+  std::deque<qt_fetched_sample_t> m_fetched_samples;
 
-  std::vector<qt_index_t> m_index;
+  // Fragmented files: the entries are added to m_index while reading
+  // the fragments. m_fragment_dts is the decode timestamp of the next
+  // sample in the track's time scale.
+  bool m_fragmented, m_fragment_dts_warning_printed;
+  uint64_t m_fragment_dts;
 
-  int64_t min_timecode, max_timecode;
+  int64_t min_timecode, max_timecode, timecode_offset, avg_duration, v_dts_offset;
   double fps;
 
   esds_t esds;
@@ -169,19 +218,33 @@ struct qtmp4_demuxer_c {
 
   std::string language;
 
-  bool m_debug_tables, m_debug_fps;
+  uint64_t m_cached_sample, m_cached_sample_pos, m_cached_chunk_end;
+
+  // Statistics about the index entries for '--debug qtmp4_index'.
+  uint64_t m_num_index_entries_created, m_num_index_entries_discarded, m_max_num_index_entries;
+
+  bool m_debug_tables, m_debug_fps, m_debug_index;
 
   qtmp4_demuxer_c():
     ok(false),
     type('?'),
     id(0),
     pos(0),
+    start_pos(0),
     time_scale(1),
     global_duration(0), //avg_duration(0),
     sample_size(0),
     duration(0),
+    num_frame_offsets(0),
+    m_index_start(0),
+    m_fragmented(false),
+    m_fragment_dts_warning_printed(false),
+    m_fragment_dts(0),
     min_timecode(0),
     max_timecode(0),
+    timecode_offset(0),
+    avg_duration(0),
+    v_dts_offset(0),
     fps(0.0),
     esds_parsed(false),
     v_width(0),
@@ -200,14 +263,24 @@ struct qtmp4_demuxer_c {
     priv_size(0),
     warning_printed(false),
     ptzr(-1)
+    , m_cached_sample(0)
+    , m_cached_sample_pos(0)
+    , m_cached_chunk_end(0)
+    , m_num_index_entries_created(0)
+    , m_num_index_entries_discarded(0)
+    , m_max_num_index_entries(0)
     , m_debug_tables(                                debugging_requested("qtmp4_full") || debugging_requested("qtmp4_tables"))
     , m_debug_fps(   debugging_requested("qtmp4") || debugging_requested("qtmp4_full") || debugging_requested("qtmp4_fps"))
+    , m_debug_index(                                 debugging_requested("qtmp4_full") || debugging_requested("qtmp4_index"))
   {
     memset(fourcc, 0, 4);
     memset(&esds, 0, sizeof(esds_t));
   }
 
   ~qtmp4_demuxer_c() {
+    mxdebug_if(m_debug_index, boost::format("Track %1%: index entries created: %2%, discarded: %3%, kept at most at the same time: %4%\n")
+               % id % m_num_index_entries_created % m_num_index_entries_discarded % m_max_num_index_entries);
+
     safefree(priv);
     safefree(esds.decoder_config);
     safefree(esds.sl_config);
@@ -221,13 +294,28 @@ struct qtmp4_demuxer_c {
   void update_tables(int64_t global_time_scale);
   void update_editlist_table(int64_t global_time_scale);
 
-  void build_index();
+  uint64_t get_num_samples();
+  uint64_t get_sample_pts(uint64_t sample);
+  uint64_t get_sample_pos(uint64_t sample);
+  uint32_t get_sample_size(uint64_t sample);
+  int32_t get_frame_offset(uint64_t sample);
+
+  size_t get_num_index_entries();
+  const qt_index_t &get_index_entry(size_t idx);
+  void add_index_entry(const qt_index_t &index);
+  void discard_index_entries(size_t idx);
+  qt_index_t create_index_entry(size_t idx);
 
   bool read_first_bytes(memory_cptr &buf, int num_bytes, mm_io_cptr in);
 
 private:
-  void build_index_chunk_mode();
-  void build_index_constant_sample_size_mode();
+  int64_t get_timecode_before_offset(size_t frame, uint64_t &real_frame);
+  bool is_keyframe(size_t frame);
+
+  qt_index_t create_index_entry_chunk_mode(size_t frame);
+  qt_index_t create_index_entry_constant_sample_size_mode(size_t frame);
+
+  void verify_sample_tables();
 };
 typedef counted_ptr<qtmp4_demuxer_c> qtmp4_demuxer_cptr;
 
@@ -277,7 +365,14 @@ private:
   uint32_t m_time_scale, m_compression_algorithm;
   int m_main_dmx;
 
-  bool m_debug_chapters, m_debug_headers, m_debug_tables;
+  int64_t m_fetch_buffer_size, m_fetch_window_size, m_fetched_size;
+
+  bool m_fragmented;
+  uint64_t m_first_fragment_pos, m_fragment_pos;
+  std::map<uint32_t, qt_track_defaults_t> m_track_defaults;
+  qt_fragment_t m_fragment;
+
+  bool m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_fetch, m_debug_fragments;
 
 public:
   qtmp4_reader_c(const track_info_c &ti, const mm_io_cptr &in);
@@ -289,6 +384,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool seek_to_timecode(int64_t timecode);
   virtual int get_progress();
   virtual void identify();
   virtual void create_packetizers();
@@ -315,6 +411,7 @@ protected:
   virtual void handle_mdia_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
   virtual void handle_minf_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
   virtual void handle_moov_atom(qt_atom_t parent, int level);
+  virtual void handle_mvex_atom(qt_atom_t parent, int level);
   virtual void handle_mvhd_atom(qt_atom_t parent, int level);
   virtual void handle_udta_atom(qt_atom_t parent, int level);
   virtual void handle_chpl_atom(qt_atom_t parent, int level);
@@ -331,6 +428,16 @@ protected:
   virtual void handle_trak_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
   virtual void handle_edts_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
   virtual void handle_elst_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
+  virtual void handle_trex_atom(qt_atom_t parent, int level);
+
+  virtual bool find_next_fragment();
+  virtual bool read_fragment();
+  virtual bool other_tracks_are_ahead_of(qtmp4_demuxer_c &dmx);
+  virtual void handle_moof_atom(qt_atom_t parent, int level);
+  virtual void handle_traf_atom(qt_atom_t parent, int level);
+  virtual void handle_tfhd_atom(qt_atom_t parent, int level);
+  virtual void handle_tfdt_atom(qt_atom_t parent, int level);
+  virtual void handle_trun_atom(qt_atom_t parent, int level);
 
   virtual memory_cptr create_bitmap_info_header(qtmp4_demuxer_cptr &dmx, const char *fourcc, size_t extra_size = 0, const void *extra_data = NULL);
 
@@ -348,6 +455,13 @@ protected:
 
   virtual std::string decode_and_verify_language(uint16_t coded_language);
   virtual void read_chapter_track();
+
+  virtual bool seek_fragments_to_timecode(int64_t timecode);
+  virtual qtmp4_demuxer_c *find_fragment_demuxer(uint32_t track_id);
+
+  virtual memory_cptr fetch_sample(qtmp4_demuxer_c &dmx);
+  virtual void fetch_samples_from_window(qtmp4_demuxer_c &requester);
+  virtual void copy_out_fetched_samples(qt_fetch_window_cptr &window);
   virtual void recode_chapter_entries(std::vector<qtmp4_chapter_entry_t> &entries);
   virtual void process_chapter_entries(int level, std::vector<qtmp4_chapter_entry_t> &entries);
 };
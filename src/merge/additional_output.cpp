@@ -0,0 +1,323 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   additional output files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <errno.h>
+
+#include <ebml/EbmlSubHead.h>
+
+#include <matroska/KaxChapters.h>
+#include <matroska/KaxTrackEntryData.h>
+
+#include "common/bitvalue.h"
+#include "common/ebml.h"
+#include "common/hacks.h"
+#include "common/math.h"
+#include "common/mm_write_cache_io.h"
+#include "merge/additional_output.h"
+#include "merge/webm.h"
+
+std::vector<additional_output_cptr> g_additional_outputs;
+
+template<typename T> static void
+remove_children(EbmlMaster &master) {
+  size_t idx = 0;
+  while (master.ListSize() > idx)
+    if (EbmlId(*master[idx]) == EBML_ID(T)) {
+      delete master[idx];
+      master.Remove(idx);
+    } else
+      ++idx;
+}
+
+additional_output_c::additional_output_c(const std::string &file_name)
+  : m_file_name(file_name)
+  , m_webm(false)
+  , m_info(NULL)
+  , m_duration(NULL)
+  , m_tracks(NULL)
+{
+}
+
+void
+additional_output_c::add_requested_track(const track_order_t &track) {
+  m_requested_tracks.push_back(track);
+}
+
+/** \brief Determines the track numbers this file will contain
+
+   Without an explicit track selection all tracks of the main output
+   file are used. Tracks that cannot be stored in a WebM file are left
+   out with a warning in that case.
+*/
+void
+additional_output_c::select_tracks() {
+  bool video_packetizer_used = false;
+
+  for (auto &ptzr : g_packetizers) {
+    generic_packetizer_c *packetizer = ptzr.packetizer;
+
+    if (!m_requested_tracks.empty()) {
+      auto requested = std::find_if(m_requested_tracks.begin(), m_requested_tracks.end(), [&](const track_order_t &track) {
+          return (track.file_id == ptzr.file) && (track.track_id == packetizer->m_ti.m_id);
+        });
+      if (m_requested_tracks.end() == requested)
+        continue;
+    }
+
+    if (m_webm && !packetizer->is_compatible_with(OC_WEBM)) {
+      if (!m_requested_tracks.empty())
+        mxerror(boost::format(Y("The codec type '%1%' cannot be used in a WebM compliant file.\n")) % packetizer->get_format_name());
+
+      mxwarn(boost::format(Y("The track %1%:%2% with the codec type '%3%' cannot be used in a WebM compliant file and will not be written to '%4%'.\n"))
+             % ptzr.file % packetizer->m_ti.m_id % packetizer->get_format_name() % m_file_name);
+      continue;
+    }
+
+    m_track_numbers.push_back(packetizer->get_track_num());
+    if (packetizer == g_video_packetizer)
+      video_packetizer_used = true;
+  }
+
+  for (auto &track : m_requested_tracks) {
+    auto found = std::find_if(g_packetizers.begin(), g_packetizers.end(), [&](const packetizer_t &ptzr) {
+        return (track.file_id == ptzr.file) && (track.track_id == ptzr.packetizer->m_ti.m_id);
+      });
+    if (g_packetizers.end() == found)
+      mxerror(boost::format(Y("The track %1%:%2% requested for the output file '%3%' does not exist or is not written to the main output file.\n"))
+              % track.file_id % track.track_id % m_file_name);
+  }
+
+  if (m_track_numbers.empty())
+    mxerror(boost::format(Y("No tracks would be written to the output file '%1%'.\n")) % m_file_name);
+
+  m_cluster_helper->set_video_packetizer_used(video_packetizer_used);
+}
+
+void
+additional_output_c::render_ebml_head() {
+  unsigned int doc_type_read_version                      = hack_engaged(ENGAGE_NO_SIMPLE_BLOCKS) ? 1 : 2;
+
+  GetChildAs<EDocType, EbmlString>(*m_head)               = m_webm ? "webm" : "matroska";
+  GetChildAs<EDocTypeVersion,     EbmlUInteger>(*m_head)  = g_stereo_mode_used ? 3 : doc_type_read_version;
+  GetChildAs<EDocTypeReadVersion, EbmlUInteger>(*m_head)  = doc_type_read_version;
+
+  m_head->Render(*m_out, true);
+}
+
+/** \brief Renders a copy of the main file's segment information
+
+   Everything related to linking is removed as the file is not part of
+   the main file's family. It gets its own segment UID and duration.
+*/
+void
+additional_output_c::render_segment_info() {
+  m_info = static_cast<KaxInfo *>(FINDFIRST(g_kax_segment, KaxInfo)->Clone());
+  m_segment->PushElement(*m_info);
+
+  remove_children<KaxDuration>(*m_info);
+  remove_children<KaxSegmentUID>(*m_info);
+  remove_children<KaxSegmentFamily>(*m_info);
+  remove_children<KaxChapterTranslate>(*m_info);
+  remove_children<KaxPrevUID>(*m_info);
+  remove_children<KaxNextUID>(*m_info);
+
+  m_duration = new KaxDuration;
+  m_duration->SetPrecision(EbmlFloat::FLOAT_64);
+  *static_cast<EbmlFloat *>(m_duration) = 0.0;
+  m_info->PushElement(*m_duration);
+
+  if (!m_webm) {
+    bitvalue_c segment_uid(128);
+    if (!hack_engaged(ENGAGE_NO_VARIABLE_DATA))
+      segment_uid.generate_random();
+    GetChild<KaxSegmentUID>(*m_info).CopyBuffer(segment_uid.data(), 128 / 8);
+  }
+
+  m_info->Render(*m_out, true);
+  m_seek_head->IndexThis(*m_info, *m_segment);
+}
+
+/** \brief Copies the headers of the selected tracks from the main file
+*/
+void
+additional_output_c::create_track_entries() {
+  while (0 < m_tracks->ListSize()) {
+    delete (*m_tracks)[0];
+    m_tracks->Remove(0);
+  }
+
+  size_t idx;
+  for (idx = 0; g_kax_tracks->ListSize() > idx; ++idx) {
+    KaxTrackEntry *entry = dynamic_cast<KaxTrackEntry *>((*g_kax_tracks)[idx]);
+    if (NULL == entry)
+      continue;
+
+    KaxTrackNumber *number = FINDFIRST(entry, KaxTrackNumber);
+    if ((NULL == number) || (m_track_numbers.end() == std::find(m_track_numbers.begin(), m_track_numbers.end(), static_cast<int>(uint64(*number)))))
+      continue;
+
+    KaxTrackEntry *copy = static_cast<KaxTrackEntry *>(entry->Clone());
+    m_tracks->PushElement(*copy);
+
+    // The same elements that are omitted from the main file's track
+    // headers in WebM mode.
+    if (m_webm) {
+      remove_children<KaxTrackMinCache>(*copy);
+      remove_children<KaxTrackMaxCache>(*copy);
+      remove_children<KaxMaxBlockAdditionID>(*copy);
+    }
+  }
+}
+
+void
+additional_output_c::render_track_headers() {
+  create_track_entries();
+
+  m_tracks->UpdateSize(true);
+  uint64_t full_header_size = m_tracks->ElementSize(true);
+  m_tracks->UpdateSize(false);
+
+  m_tracks->Render(*m_out, false);
+  m_seek_head->IndexThis(*m_tracks, *m_segment);
+
+  // Reserve the same amount of space for header changes by the
+  // packetizers as the main file does.
+  m_void_after_tracks = counted_ptr<EbmlVoid>(new EbmlVoid);
+  m_void_after_tracks->SetSize(1024 + full_header_size - m_tracks->ElementSize(false));
+  m_void_after_tracks->Render(*m_out);
+}
+
+/** \brief Overwrites the track headers with the main file's current ones
+
+   The packetizers may have changed their headers after the file has
+   been opened.
+*/
+void
+additional_output_c::rerender_track_headers() {
+  create_track_entries();
+  m_tracks->UpdateSize(false);
+
+  int64_t new_void_size = m_void_after_tracks->GetElementPosition() + m_void_after_tracks->GetSize()
+    - m_tracks->GetElementPosition() - m_tracks->ElementSize();
+
+  m_out->save_pos(m_tracks->GetElementPosition());
+  m_tracks->Render(*m_out, false);
+
+  m_void_after_tracks = counted_ptr<EbmlVoid>(new EbmlVoid);
+  m_void_after_tracks->SetSize(new_void_size);
+  m_void_after_tracks->Render(*m_out);
+
+  m_out->restore_pos();
+}
+
+void
+additional_output_c::rerender_duration() {
+  m_out->save_pos(m_duration->GetElementPosition());
+  *static_cast<EbmlFloat *>(m_duration) = irnd((double)m_cluster_helper->get_duration() / (double)((int64_t)g_timecode_scale));
+  m_duration->Render(*m_out);
+  m_out->restore_pos();
+}
+
+/** \brief Opens the file and renders its headers
+
+   Must be called after the main output file has been created so that
+   the track headers and the timecode scale are known.
+*/
+void
+additional_output_c::open() {
+  m_cues           = counted_ptr<cues_c>(new cues_c);
+  m_cluster_helper = counted_ptr<cluster_helper_c>(new cluster_helper_c);
+
+  select_tracks();
+
+  try {
+    m_out = mm_write_cache_io_c::open(m_file_name, 20 * 1024 * 1024);
+  } catch (...) {
+    mxerror(boost::format(Y("The output file '%1%' could not be opened for writing (%2%).\n")) % m_file_name % strerror(errno));
+  }
+
+  if (verbose)
+    mxinfo(boost::format(Y("The file '%1%' has been opened for writing.\n")) % m_file_name);
+
+  m_head      = counted_ptr<EbmlHead>(new EbmlHead);
+  m_segment   = counted_ptr<KaxSegment>(new KaxSegment);
+  m_seek_head = counted_ptr<KaxSeekHead>(new KaxSeekHead);
+
+  render_ebml_head();
+  m_segment->WriteHead(*m_out, 8);
+
+  // Reserve some space for the meta seek stuff.
+  m_seek_head_void = counted_ptr<EbmlVoid>(new EbmlVoid);
+  m_seek_head_void->SetSize(4096);
+  m_seek_head_void->Render(*m_out);
+
+  render_segment_info();
+
+  m_tracks = &GetChild<KaxTracks>(*m_segment);
+  render_track_headers();
+
+  m_cluster_helper->set_output(m_out.get_object());
+  m_cluster_helper->set_segment(m_segment.get_object(), m_cues.get_object(), NULL);
+}
+
+/** \brief Hands a packet over to this file's cluster helper
+
+   Packets of tracks that have not been selected for this file are
+   ignored.
+*/
+void
+additional_output_c::add_packet(packet_cptr packet) {
+  if (m_track_numbers.end() == std::find(m_track_numbers.begin(), m_track_numbers.end(), packet->source->get_track_num()))
+    return;
+
+  // The cluster helper normalizes the packet's timecodes in place. Each
+  // output file needs its own copy of the packet therefore. The frame
+  // data itself is shared.
+  m_cluster_helper->add_packet(packet_cptr(new packet_t(*packet)));
+}
+
+/** \brief Renders the remaining data and closes the file
+
+   Renders the remaining packets and the cues. Fills in the duration,
+   the final track headers, the meta seek information and the segment
+   size.
+*/
+void
+additional_output_c::finish() {
+  if (0 < m_cluster_helper->get_packet_count())
+    m_cluster_helper->render();
+
+  if (g_write_cues && (0 < m_cues->size())) {
+    m_cues->write(*m_out, (int64_t)g_timecode_scale);
+    m_seek_head->IndexThis(*m_cues->get_kax_cues(), *m_segment);
+  }
+
+  rerender_duration();
+  rerender_track_headers();
+
+  if ((0 < m_seek_head->ListSize()) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
+    m_seek_head->UpdateSize();
+    if (m_seek_head_void->ReplaceWith(*m_seek_head, *m_out, true) == INVALID_FILEPOS_T)
+      mxwarn(boost::format(Y("This should REALLY not have happened. The space reserved for the first meta seek element was too small. Size needed: %1%. %2%\n"))
+             % m_seek_head->ElementSize() % BUGMSG);
+  }
+
+  int64_t final_file_size = m_out->getFilePointer();
+  if (m_segment->ForceSize(final_file_size - m_segment->GetElementPosition() - m_segment->HeadSize()))
+    m_segment->OverwriteHead(*m_out);
+
+  m_out->close();
+  m_out.clear();
+}
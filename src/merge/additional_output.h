@@ -0,0 +1,94 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for additional output files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_MERGE_ADDITIONAL_OUTPUT_H
+#define __MTX_MERGE_ADDITIONAL_OUTPUT_H
+
+#include "common/common_pch.h"
+
+#include <ebml/EbmlHead.h>
+#include <ebml/EbmlVoid.h>
+
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxInfoData.h>
+#include <matroska/KaxSeekHead.h>
+#include <matroska/KaxSegment.h>
+#include <matroska/KaxTracks.h>
+
+#include "common/mm_io.h"
+#include "merge/cluster_helper.h"
+#include "merge/cues.h"
+#include "merge/output_control.h"
+
+using namespace libebml;
+using namespace libmatroska;
+
+/* An additional output file is written from the same packets as the
+   main output file. The input files are only read and parsed once. Each
+   additional output file contains a subset of the main file's tracks
+   with the same track numbers and track headers. It can be made WebM
+   compliant independently of the main output file.
+
+   Chapters, tags and attachments are only written to the main output
+   file. Additional output files are never split.
+*/
+class additional_output_c {
+protected:
+  std::string m_file_name;
+  bool m_webm;
+  std::vector<track_order_t> m_requested_tracks;
+  std::vector<int> m_track_numbers;
+
+  mm_io_cptr m_out;
+  counted_ptr<EbmlHead> m_head;
+  counted_ptr<KaxSegment> m_segment;
+  KaxInfo *m_info;
+  KaxDuration *m_duration;
+  KaxTracks *m_tracks;
+  counted_ptr<KaxSeekHead> m_seek_head;
+  counted_ptr<EbmlVoid> m_seek_head_void, m_void_after_tracks;
+  counted_ptr<cues_c> m_cues;
+  counted_ptr<cluster_helper_c> m_cluster_helper;
+
+public:
+  additional_output_c(const std::string &file_name);
+
+  const std::string &get_file_name() const {
+    return m_file_name;
+  }
+  void set_webm(bool webm) {
+    m_webm = webm;
+  }
+  bool is_webm() const {
+    return m_webm;
+  }
+  void add_requested_track(const track_order_t &track);
+
+  void open();
+  void add_packet(packet_cptr packet);
+  void finish();
+
+protected:
+  void select_tracks();
+  void render_ebml_head();
+  void render_segment_info();
+  void create_track_entries();
+  void render_track_headers();
+  void rerender_track_headers();
+  void rerender_duration();
+};
+typedef counted_ptr<additional_output_c> additional_output_cptr;
+
+extern std::vector<additional_output_cptr> g_additional_outputs;
+
+#endif // __MTX_MERGE_ADDITIONAL_OUTPUT_H
@@ -25,8 +25,10 @@
 #include "common/math.h"
 #include "common/strings/formatting.h"
 #include "merge/cluster_helper.h"
+#include "merge/cues.h"
 #include "merge/libmatroska_extensions.h"
 #include "merge/output_control.h"
+#include "merge/read_ahead.h"
 #include "output/p_video.h"
 
 #include <matroska/KaxBlock.h>
@@ -50,6 +52,10 @@ cluster_helper_c::cluster_helper_c()
   , m_max_timecode_in_cluster(-1)
   , m_attachments_size(0)
   , m_out(NULL)
+  , m_segment(NULL)
+  , m_cues(NULL)
+  , m_cluster_seek_head(NULL)
+  , m_video_packetizer_used(true)
   , m_current_split_point(m_split_points.begin())
 {
 }
@@ -92,7 +98,7 @@ cluster_helper_c::add_packet(packet_cptr packet) {
       || (SHRT_MIN > timecode_delay)
       || (packet->gap_following && !m_packets.empty())
       || ((packet->assigned_timecode - timecode) > g_max_ns_per_cluster)
-      || ((packet->source == g_video_packetizer) && packet->is_key_frame())) {
+      || ((packet->source == get_video_packetizer()) && packet->is_key_frame())) {
     render();
     prepare_new_cluster();
   }
@@ -102,7 +108,7 @@ cluster_helper_c::add_packet(packet_cptr packet) {
       && (g_file_num <= g_split_max_num_files)
       && packet->is_key_frame()
       && (   (packet->source->get_track_type() == track_video)
-          || (NULL == g_video_packetizer))) {
+          || (NULL == get_video_packetizer()))) {
     bool split_now = false;
 
     // Maybe we want to start a new file now.
@@ -131,6 +137,8 @@ cluster_helper_c::add_packet(packet_cptr packet) {
       split_now = true;
 
     if (split_now) {
+      readers_paused_c pause;
+
       render();
 
       m_num_cue_elements = 0;
@@ -147,7 +155,7 @@ cluster_helper_c::add_packet(packet_cptr packet) {
       m_first_timecode_in_file = -1;
 
       if (g_no_linking)
-        m_timecode_offset = g_video_packetizer ? m_max_video_timecode_rendered : packet->assigned_timecode;
+        m_timecode_offset = get_video_packetizer() ? m_max_video_timecode_rendered : packet->assigned_timecode;
 
       if (m_current_split_point->m_use_once)
         ++m_current_split_point;
@@ -189,7 +197,7 @@ cluster_helper_c::prepare_new_cluster() {
   m_cluster_content_size = 0;
   m_packets.clear();
 
-  m_cluster->SetParent(*g_kax_segment);
+  m_cluster->SetParent(*m_segment);
   m_cluster->SetPreviousTimecode(m_previous_cluster_tc, (int64_t)g_timecode_scale);
 }
 
@@ -203,6 +211,28 @@ cluster_helper_c::set_output(mm_io_c *out) {
   m_out = out;
 }
 
+/** \brief Sets the segment the clusters are written to
+
+   \a cues collects the cue entries for the segment. \a
+   cluster_seek_head receives a meta seek entry for each cluster if it
+   is not \c NULL.
+*/
+void
+cluster_helper_c::set_segment(KaxSegment *segment,
+                              cues_c *cues,
+                              KaxSeekHead *cluster_seek_head) {
+  m_segment           = segment;
+  m_cues              = cues;
+  m_cluster_seek_head = cluster_seek_head;
+}
+
+/** \brief Returns the video packetizer if its track is written by this helper
+*/
+generic_packetizer_c *
+cluster_helper_c::get_video_packetizer() {
+  return m_video_packetizer_used ? g_video_packetizer : NULL;
+}
+
 void
 cluster_helper_c::set_duration(render_groups_c *rg) {
   if (rg->m_durations.empty())
@@ -267,6 +297,10 @@ cluster_helper_c::must_duration_be_set(render_groups_c *rg,
 
 int
 cluster_helper_c::render() {
+  // The packetizers and their track headers must not be modified while
+  // the cluster is rendered.
+  readers_paused_c pause;
+
   std::vector<render_groups_cptr> render_groups;
 
   bool use_simpleblock              = !hack_engaged(ENGAGE_NO_SIMPLE_BLOCKS);
@@ -402,12 +436,12 @@ cluster_helper_c::render() {
           // last cue entry was created more than 2s ago.
           || (   (CUE_STRATEGY_SPARSE == source->get_cue_creation())
               && (track_audio         == source->get_track_type())
-              && (NULL                == g_video_packetizer)
-              && (   (0 > source->get_last_cue_timecode())
-                  || ((pack->assigned_timecode - source->get_last_cue_timecode()) >= 2000000000)))) {
+              && (NULL                == get_video_packetizer())
+              && (   (0 > source->get_last_cue_timecode(this))
+                  || ((pack->assigned_timecode - source->get_last_cue_timecode(this)) >= 2000000000)))) {
 
-        g_kax_cues->AddBlockBlob(*new_block_group);
-        source->set_last_cue_timecode(pack->assigned_timecode);
+        m_cues->add(*new_block_group);
+        source->set_last_cue_timecode(this, pack->assigned_timecode);
 
         m_num_cue_elements++;
         g_cue_writing_requested = 1;
@@ -417,7 +451,7 @@ cluster_helper_c::render() {
 
     pack->group = new_block_group;
 
-    if (g_video_packetizer == source)
+    if (get_video_packetizer() == source)
       m_max_video_timecode_rendered = std::max(pack->assigned_timecode + (pack->has_duration() ? pack->duration : 0), m_max_video_timecode_rendered);
   }
 
@@ -429,11 +463,24 @@ cluster_helper_c::render() {
     m_cluster->set_min_timecode(min_cl_timecode - m_timecode_offset);
     m_cluster->set_max_timecode(max_cl_timecode - m_timecode_offset);
 
-    m_cluster->Render(*m_out, *g_kax_cues);
+    if (g_live_output)
+      write_live_headers();
+
+    // The cue entries are collected by m_cues. KaxCluster::Render()
+    // insists on a KaxCues element nonetheless.
+    KaxCues cues_to_update;
+    m_cluster->Render(*m_out, cues_to_update);
     m_bytes_in_file += m_cluster->ElementSize();
 
-    if (NULL != g_kax_sh_cues)
-      g_kax_sh_cues->IndexThis(*m_cluster, *g_kax_segment);
+    // Hand each cluster over to the destination as soon as it is
+    // complete in live mode.
+    if (g_live_output)
+      m_out->flush();
+
+    m_cues->postprocess_cues(*m_segment);
+
+    if (NULL != m_cluster_seek_head)
+      m_cluster_seek_head->IndexThis(*m_cluster, *m_segment);
 
     m_previous_cluster_tc = m_cluster->GlobalTimecode();
   } else
@@ -24,6 +24,7 @@
 #include "common/smart_pointers.h"
 #include "merge/pr_generic.h"
 
+class cues_c;
 
 #define RND_TIMECODE_SCALE(a) (irnd((double)(a) / (double)((int64_t)g_timecode_scale)) * (int64_t)g_timecode_scale)
 
@@ -71,6 +72,10 @@ private:
   int64_t m_min_timecode_in_cluster, m_max_timecode_in_cluster;
   int64_t m_attachments_size;
   mm_io_c *m_out;
+  KaxSegment *m_segment;
+  cues_c *m_cues;
+  KaxSeekHead *m_cluster_seek_head;
+  bool m_video_packetizer_used;
 
   std::vector<split_point_t> m_split_points;
   std::vector<split_point_t>::iterator m_current_split_point;
@@ -83,6 +88,10 @@ public:
   mm_io_c *get_output() {
     return m_out;
   }
+  void set_segment(KaxSegment *segment, cues_c *cues, KaxSeekHead *cluster_seek_head);
+  void set_video_packetizer_used(bool used) {
+    m_video_packetizer_used = used;
+  }
   void prepare_new_cluster();
   KaxCluster *get_cluster() {
     return m_cluster;
@@ -106,6 +115,8 @@ public:
   }
 
 private:
+  generic_packetizer_c *get_video_packetizer();
+
   void set_duration(render_groups_c *rg);
   bool must_duration_be_set(render_groups_c *rg, packet_cptr &new_packet);
 };
@@ -0,0 +1,104 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the cue entries
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCuesData.h>
+#include <matroska/KaxSegment.h>
+
+#include "common/ebml.h"
+#include "merge/cues.h"
+
+cues_c::cues_c() {
+}
+
+/** \brief Remembers a block for a cue entry
+
+   The entry itself is created in \c postprocess_cues() once the cluster
+   containing the block has been rendered and the block's position is
+   known.
+*/
+void
+cues_c::add(KaxBlockBlob &blob) {
+  if (m_pending_blobs.end() == std::find(m_pending_blobs.begin(), m_pending_blobs.end(), &blob))
+    m_pending_blobs.push_back(&blob);
+}
+
+static uint64_t
+get_blob_position(KaxBlockBlob &blob) {
+  return blob.IsSimpleBlock() ? static_cast<KaxSimpleBlock &>(blob).GetElementPosition() : static_cast<KaxBlockGroup &>(blob).GetElementPosition();
+}
+
+/** \brief Creates the cue entries for the blocks of a rendered cluster
+
+   Has to be called after the cluster has been rendered but before its
+   blocks are deleted.
+*/
+void
+cues_c::postprocess_cues(KaxSegment &segment) {
+  // Create the entries in the order the blocks have been written
+  // in. write() hands them to KaxCues in this order, and
+  // KaxCues::Render() orders them by timecode and track number with
+  // std::sort(). That sort isn't stable, so the order of entries with
+  // identical timecodes and tracks depends on the order they're added
+  // in.
+  std::stable_sort(m_pending_blobs.begin(), m_pending_blobs.end(), [](KaxBlockBlob *a, KaxBlockBlob *b) { return get_blob_position(*a) < get_blob_position(*b); });
+
+  for (auto blob : m_pending_blobs) {
+    KaxInternalBlock &block = *blob;
+    cue_point_t point;
+
+    point.m_timecode             = block.GlobalTimecode();
+    point.m_track_num            = block.TrackNum();
+    point.m_cluster_position     = block.ClusterPosition();
+    point.m_codec_state_position = 0;
+
+    if (!blob->IsSimpleBlock()) {
+      KaxCodecState *codec_state = FINDFIRST(&static_cast<KaxBlockGroup &>(*blob), KaxCodecState);
+      if (NULL != codec_state)
+        point.m_codec_state_position = segment.GetRelativePosition(codec_state->GetElementPosition());
+    }
+
+    m_points.push_back(point);
+  }
+
+  m_pending_blobs.clear();
+}
+
+/** \brief Builds the KaxCues element and writes it
+
+   The element is kept afterwards so that it can be indexed in the meta
+   seek element.
+*/
+void
+cues_c::write(mm_io_c &out,
+              uint64_t timecode_scale) {
+  m_kax_cues = counted_ptr<KaxCues>(new KaxCues);
+  m_kax_cues->SetGlobalTimecodeScale(timecode_scale);
+
+  for (auto &point : m_points) {
+    KaxCuePoint *kax_point = new KaxCuePoint;
+    m_kax_cues->PushElement(*kax_point);
+
+    GetChildAs<KaxCueTime, EbmlUInteger>(kax_point) = point.m_timecode / timecode_scale;
+
+    KaxCueTrackPositions &positions                            = AddEmptyChild<KaxCueTrackPositions>(*kax_point);
+    GetChildAs<KaxCueTrack, EbmlUInteger>(positions)           = point.m_track_num;
+    GetChildAs<KaxCueClusterPosition, EbmlUInteger>(positions) = point.m_cluster_position;
+
+    if (0 != point.m_codec_state_position)
+      GetChildAs<KaxCueCodecState, EbmlUInteger>(positions) = point.m_codec_state_position;
+  }
+
+  m_kax_cues->Render(out);
+}
@@ -0,0 +1,62 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the cue entries
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_MERGE_CUES_H
+#define __MTX_MERGE_CUES_H
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxCues.h>
+
+#include "common/mm_io.h"
+
+using namespace libmatroska;
+
+/* Collects the cue entries (the index) for one output file. Each entry
+   is only kept as a small fixed size structure while muxing. The
+   KaxCues element is built when the cues are written at the end of the
+   file.
+*/
+class cues_c {
+protected:
+  struct cue_point_t {
+    uint64_t m_timecode, m_track_num, m_cluster_position, m_codec_state_position;
+  };
+
+  std::vector<cue_point_t> m_points;
+
+  // Blocks in the current cluster that cue entries will be created for
+  // as soon as the cluster has been rendered.
+  std::vector<KaxBlockBlob *> m_pending_blobs;
+
+  counted_ptr<KaxCues> m_kax_cues;
+
+public:
+  cues_c();
+
+  void add(KaxBlockBlob &blob);
+  void postprocess_cues(KaxSegment &segment);
+
+  size_t size() const {
+    return m_points.size();
+  }
+
+  void write(mm_io_c &out, uint64_t timecode_scale);
+  KaxCues *get_kax_cues() const {
+    return m_kax_cues.get_object();
+  }
+};
+typedef counted_ptr<cues_c> cues_cptr;
+
+#endif // __MTX_MERGE_CUES_H
@@ -0,0 +1,277 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the on-disk cache of identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <sys/stat.h>
+# include <sys/types.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "common/checksums.h"
+#include "common/fs_sys_helpers.h"
+#include "common/locale.h"
+#include "common/mm_io.h"
+#include "common/random.h"
+#include "common/translation.h"
+#include "common/version.h"
+#include "merge/identification_cache.h"
+#include "merge/output_control.h"
+
+#define IDENTIFICATION_CACHE_MAGIC "mkvmerge identification cache 1"
+
+// Entries that haven't been used for this long are removed, as are the
+// least recently used ones beyond the maximum number of entries.
+#define IDENTIFICATION_CACHE_MAX_ENTRIES 1000
+#define IDENTIFICATION_CACHE_MAX_AGE     (30 * 24 * 60 * 60)
+
+namespace bfs = boost::filesystem;
+
+identification_cache_mode_e g_identification_cache_mode = IDENTIFICATION_CACHE_OFF;
+
+static void
+write_string(mm_io_c &out,
+             const std::string &s) {
+  out.write_uint32_be(s.length());
+  out.write(s.c_str(), s.length());
+}
+
+static std::string
+read_string(mm_io_c &in) {
+  std::string s;
+  uint32_t length = in.read_uint32_be();
+
+  if (in.read(s, length) != length)
+    throw mtx::mm_io::end_of_file_x();
+
+  return s;
+}
+
+static void
+write_result(mm_io_c &out,
+             const id_result_t &result) {
+  out.write_uint64_be(result.id);
+  write_string(out, result.type);
+  write_string(out, result.info);
+  write_string(out, result.description);
+  out.write_uint64_be(result.size);
+
+  out.write_uint32_be(result.verbose_info.size());
+  for (auto &verbose_info : result.verbose_info)
+    write_string(out, verbose_info);
+}
+
+static id_result_t
+read_result(mm_io_c &in) {
+  id_result_t result;
+
+  result.id          = in.read_uint64_be();
+  result.type        = read_string(in);
+  result.info        = read_string(in);
+  result.description = read_string(in);
+  result.size        = in.read_uint64_be();
+
+  uint32_t num_verbose_info = in.read_uint32_be();
+  uint32_t i;
+  for (i = 0; num_verbose_info > i; ++i)
+    result.verbose_info.push_back(read_string(in));
+
+  return result;
+}
+
+static void
+write_results(mm_io_c &out,
+              const std::vector<id_result_t> &results) {
+  out.write_uint32_be(results.size());
+  for (auto &result : results)
+    write_result(out, result);
+}
+
+static std::vector<id_result_t>
+read_results(mm_io_c &in) {
+  std::vector<id_result_t> results;
+
+  uint32_t num_results = in.read_uint32_be();
+  uint32_t i;
+  for (i = 0; num_results > i; ++i)
+    results.push_back(read_result(in));
+
+  return results;
+}
+
+identification_cache_c::identification_cache_c(const std::string &file_name,
+                                               bool disable_multi_file) {
+  std::string folder = get_cache_folder();
+  if (folder.empty())
+    return;
+
+  try {
+    bfs::path path = bfs::system_complete(bfs::path(file_name));
+    int64_t inode  = 0;
+
+#if !defined(SYS_WINDOWS)
+    struct stat st;
+    if (0 != stat(g_cc_local_utf8->native(path.string()).c_str(), &st))
+      return;
+    inode = st.st_ino;
+#endif
+
+    // The file's state is not part of the cache file's name. That way
+    // the entry for a modified file gets replaced.
+    std::string name = (boost::format("%1%\n%2%\n%3%%4%%5%\n%6%\n")
+                        % get_version_info("mkvmerge", vif_untranslated)
+                        % path.string()
+                        % g_identify_verbose % g_identify_for_mmg % disable_multi_file
+                        % translation_c::get_active_translation().get_locale()).str();
+
+    m_key = (boost::format("%1%%2%\n%3%\n%4%\n") % name % bfs::file_size(path) % bfs::last_write_time(path) % inode).str();
+
+    uint32_t crc      = crc_calc(crc_get_table(CRC_32_IEEE), 0, reinterpret_cast<const unsigned char *>(name.c_str()), name.length());
+    m_cache_file_name = (boost::format("%1%/%2$08x") % folder % crc).str();
+
+  } catch (...) {
+    m_cache_file_name.clear();
+  }
+}
+
+std::string
+identification_cache_c::get_cache_folder() {
+  std::string folder = get_application_data_folder();
+  return folder.empty() ? folder : folder + "/identification-cache";
+}
+
+/** \brief Looks up the results for the file
+
+   \return \c true if a valid entry was found and \a results has been
+     filled and \c false otherwise.
+*/
+bool
+identification_cache_c::load(identification_results_t &results) {
+  if (m_cache_file_name.empty() || !bfs::exists(bfs::path(m_cache_file_name)))
+    return false;
+
+  try {
+    mm_file_io_c in(m_cache_file_name);
+
+    // Different files can end up in the same cache file. Only the
+    // complete key identifies the file.
+    if ((read_string(in) != IDENTIFICATION_CACHE_MAGIC) || (read_string(in) != m_key))
+      return false;
+
+    identification_results_t cached;
+    cached.container   = read_result(in);
+    cached.tracks      = read_results(in);
+    cached.attachments = read_results(in);
+    cached.chapters    = read_results(in);
+    cached.tags        = read_results(in);
+
+    results = cached;
+
+    // The modification time records when the entry was used last.
+    boost::system::error_code ec;
+    bfs::last_write_time(bfs::path(m_cache_file_name), std::time(NULL), ec);
+
+    return true;
+
+  } catch (...) {
+    return false;
+  }
+}
+
+/** \brief Stores the results for the file
+
+   The entry is written to a temporary file first and renamed afterwards
+   so that concurrent invocations never see incomplete entries.
+*/
+void
+identification_cache_c::store(const identification_results_t &results) {
+  if (m_cache_file_name.empty())
+    return;
+
+  std::string temp_file_name = (boost::format("%1%.%2$08x.tmp") % m_cache_file_name % random_c::generate_32bits()).str();
+
+  try {
+    {
+      mm_file_io_c out(temp_file_name, MODE_CREATE);
+
+      write_string(out, IDENTIFICATION_CACHE_MAGIC);
+      write_string(out, m_key);
+      write_result(out, results.container);
+      write_results(out, results.tracks);
+      write_results(out, results.attachments);
+      write_results(out, results.chapters);
+      write_results(out, results.tags);
+    }
+
+    // Not all platforms can rename a file onto an existing one.
+    boost::system::error_code ec;
+    bfs::rename(bfs::path(temp_file_name), bfs::path(m_cache_file_name), ec);
+    if (ec) {
+      bfs::remove(bfs::path(m_cache_file_name), ec);
+      bfs::rename(bfs::path(temp_file_name), bfs::path(m_cache_file_name));
+    }
+
+  } catch (...) {
+    boost::system::error_code ec;
+    bfs::remove(bfs::path(temp_file_name), ec);
+  }
+
+  expire_entries();
+}
+
+/** \brief Keeps the cache from growing without bounds
+
+   Removes entries that haven't been used for
+   \c IDENTIFICATION_CACHE_MAX_AGE seconds. If more than
+   \c IDENTIFICATION_CACHE_MAX_ENTRIES remain then the least recently used
+   ones are removed as well.
+*/
+void
+identification_cache_c::expire_entries() {
+  std::string folder = get_cache_folder();
+  if (folder.empty())
+    return;
+
+  try {
+    std::vector<std::pair<std::time_t, bfs::path> > entries;
+    std::time_t now = std::time(NULL);
+
+    bfs::directory_iterator end_itr;
+    for (bfs::directory_iterator itr(folder); itr != end_itr; ++itr) {
+      boost::system::error_code ec;
+      std::time_t last_used = bfs::last_write_time(itr->path(), ec);
+      if (ec)
+        continue;
+
+      if ((now - last_used) > IDENTIFICATION_CACHE_MAX_AGE)
+        bfs::remove(itr->path(), ec);
+      else
+        entries.push_back(std::make_pair(last_used, itr->path()));
+    }
+
+    if (IDENTIFICATION_CACHE_MAX_ENTRIES >= entries.size())
+      return;
+
+    std::sort(entries.begin(), entries.end());
+
+    size_t i;
+    for (i = 0; (entries.size() - IDENTIFICATION_CACHE_MAX_ENTRIES) > i; ++i) {
+      boost::system::error_code ec;
+      bfs::remove(entries[i].second, ec);
+    }
+
+  } catch (...) {
+  }
+}
@@ -0,0 +1,55 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for the on-disk cache of identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_MERGE_IDENTIFICATION_CACHE_H
+#define __MTX_MERGE_IDENTIFICATION_CACHE_H
+
+#include "common/common_pch.h"
+
+#include "merge/pr_generic.h"
+
+enum identification_cache_mode_e {
+  IDENTIFICATION_CACHE_OFF,
+  IDENTIFICATION_CACHE_USE,
+  IDENTIFICATION_CACHE_REFRESH,
+};
+
+/* Stores the results of '--identify' for a file in the application data
+   folder so that identifying the same file again does not require probing
+   and parsing it. An entry is keyed by the file's absolute path, its size,
+   its modification time and its inode number together with everything
+   else influencing the output: the identification mode, the interface
+   language and the mkvmerge version. Modifying the file invalidates the
+   entry. Entries that haven't been used for 30 days and the least recently
+   used ones beyond 1000 entries are removed whenever an entry is stored.
+
+   All errors are ignored. The cache is only an optimization.
+*/
+class identification_cache_c {
+protected:
+  std::string m_key, m_cache_file_name;
+
+public:
+  identification_cache_c(const std::string &file_name, bool disable_multi_file);
+
+  bool load(identification_results_t &results);
+  void store(const identification_results_t &results);
+
+protected:
+  static std::string get_cache_folder();
+  static void expire_entries();
+};
+
+extern identification_cache_mode_e g_identification_cache_mode;
+
+#endif // __MTX_MERGE_IDENTIFICATION_CACHE_H
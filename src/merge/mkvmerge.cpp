@@ -51,7 +51,9 @@
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
 #include "common/iso639.h"
+#include "common/mm_async_write_io.h"
 #include "common/mm_io.h"
+#include "common/mm_mmap_io.h"
 #include "common/segmentinfo.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
@@ -60,9 +62,12 @@
 #include "common/unique_numbers.h"
 #include "common/version.h"
 #include "common/webm.h"
+#include "merge/additional_output.h"
 #include "merge/cluster_helper.h"
+#include "merge/identification_cache.h"
 #include "merge/mkvmerge.h"
 #include "merge/output_control.h"
+#include "merge/read_ahead.h"
 
 using namespace libmatroska;
 
@@ -118,6 +123,33 @@ set_usage() {
                   "                           Selects how mkvmerge calculates timecodes when\n"
                   "                           appending files.\n");
   usage_text += Y("  --timecode-scale <n>     Force the timecode scale factor to n.\n");
+  usage_text += Y("  --read-ahead <n>         Read each input file in its own thread and\n"
+                  "                           keep up to n packets per track queued.\n");
+  usage_text += Y("  --memory-map             Map input files into memory instead of\n"
+                  "                           reading them with normal file I/O.\n");
+  usage_text += Y("  --mp4-read-buffer <size[K,M]>\n"
+                  "                           Read QuickTime/MP4 files in large blocks and\n"
+                  "                           buffer up to size bytes of other tracks' data.\n"
+                  "                           0 reads each frame on its own.\n");
+  usage_text += Y("  --async-output <n[,size[K,M]]>\n"
+                  "                           Write the output file in the background\n"
+                  "                           using n buffers of the given size.\n");
+  usage_text += Y("  --direct-output          Bypass the operating system's cache when\n"
+                  "                           writing the output file.\n");
+  usage_text += Y("  --compression-threads <n>\n"
+                  "                           Compress frames with zlib, bzlib or lzo in\n"
+                  "                           n background threads.\n");
+  usage_text += Y("  --live                   Write the output without ever seeking back,\n"
+                  "                           e.g. to a pipe. Use '-o -' for writing to\n"
+                  "                           the standard output.\n");
+  usage_text += Y("  --additional-output <file>\n"
+                  "                           Write a second output file from the same\n"
+                  "                           packets without reading the input files again.\n");
+  usage_text += Y("  --additional-output-tracks <FileID1:TID1,FileID2:TID2,...>\n"
+                  "                           Only write these tracks to the preceding\n"
+                  "                           additional output file.\n");
+  usage_text += Y("  --additional-output-webm Make the preceding additional output file\n"
+                  "                           WebM compliant.\n");
   usage_text +=   "\n";
   usage_text += Y(" File splitting and linking (more global options):\n");
   usage_text += Y("  --split <d[K,M,G]|HH:MM:SS|s>\n"
@@ -172,6 +204,10 @@ set_usage() {
   usage_text += Y("  -T, --no-track-tags      Don't copy tags for tracks from the source file.\n");
   usage_text += Y("  --no-global-tags         Don't keep global tags from the source file.\n");
   usage_text += Y("  --no-chapters            Don't keep chapters from the source file.\n");
+  usage_text += Y("  --start-at <timecode>    Start reading the source file at the key frame\n"
+                  "                           at or before this timecode. The timecodes are\n"
+                  "                           not shifted. Only supported for Matroska, MP4\n"
+                  "                           and MPEG TS files.\n");
   usage_text += Y("  -y, --sync <TID:d[,o[/p]]>\n"
                   "                           Synchronize, adjust the track's timecodes with\n"
                   "                           the id TID by 'd' ms.\n"
@@ -235,6 +271,11 @@ set_usage() {
   usage_text +=   "\n\n";
   usage_text += Y(" Other options:\n");
   usage_text += Y("  -i, --identify <file>    Print information about the source file.\n");
+  usage_text += Y("  --identification-cache   Look up the results of '--identify' in a cache\n"
+                  "                           and store them there if they are not found.\n");
+  usage_text += Y("  --refresh-identification-cache\n"
+                  "                           Identify the file even if its results are\n"
+                  "                           cached and update the cache.\n");
   usage_text += Y("  -l, --list-types         Lists supported input file types.\n");
   usage_text += Y("  --list-languages         Lists all ISO639 languages and their\n"
                   "                           ISO639-2 codes.\n");
@@ -388,6 +429,17 @@ identify(std::string &filename) {
   file.name           = filename;
   file.all_names.push_back(filename);
 
+  counted_ptr<identification_cache_c> cache;
+  if (IDENTIFICATION_CACHE_OFF != g_identification_cache_mode) {
+    cache = counted_ptr<identification_cache_c>(new identification_cache_c(filename, ti.m_disable_multi_file));
+
+    identification_results_t results;
+    if ((IDENTIFICATION_CACHE_USE == g_identification_cache_mode) && cache->load(results)) {
+      display_identification_results(filename, results);
+      return;
+    }
+  }
+
   get_file_type(file);
 
   ti.m_fname = file.name;
@@ -404,6 +456,10 @@ identify(std::string &filename) {
   create_readers();
 
   g_files[0].reader->identify();
+
+  if (cache.is_set())
+    cache->store(g_files[0].reader->get_identification_results());
+
   g_files[0].reader->display_identification_results();
 }
 
@@ -820,6 +876,74 @@ parse_arg_split_size(const std::string &arg) {
   g_cluster_helper->add_split_point(split_point_t(split_after * modifier, split_point_t::SPT_SIZE, false));
 }
 
+/** \brief Parse the \c --mp4-read-buffer argument
+
+   The argument is a size in bytes, KB or MB.
+*/
+static void
+parse_arg_mp4_read_buffer(const std::string &arg) {
+  std::string err_msg = Y("Invalid argument for '--mp4-read-buffer %1%'.\n");
+  std::string s       = arg;
+
+  if (s.empty())
+    mxerror(boost::format(err_msg) % arg);
+
+  char mod         = tolower(s[s.length() - 1]);
+  int64_t modifier = 1;
+  if ('k' == mod)
+    modifier = 1024;
+  else if ('m' == mod)
+    modifier = 1024 * 1024;
+  else if (!isdigit(mod))
+    mxerror(boost::format(err_msg) % arg);
+
+  if (1 != modifier)
+    s.erase(s.size() - 1);
+
+  if (!parse_int(s, g_qtmp4_read_buffer_size) || (0 > g_qtmp4_read_buffer_size))
+    mxerror(boost::format(err_msg) % arg);
+
+  g_qtmp4_read_buffer_size *= modifier;
+}
+
+/** \brief Parse the \c --async-output argument
+
+   The argument is the number of buffers optionally followed by a comma
+   and the size of each buffer in bytes, KB or MB.
+*/
+static void
+parse_arg_async_output(const std::string &arg) {
+  std::string err_msg = Y("Invalid argument for '--async-output %1%'.\n");
+
+  std::vector<std::string> parts = split(arg, ",", 2);
+  if (!parse_int(parts[0], g_async_output_blocks) || (0 >= g_async_output_blocks))
+    mxerror(boost::format(err_msg) % arg);
+
+  if (1 == parts.size())
+    return;
+
+  std::string s = parts[1];
+  if (s.empty())
+    mxerror(boost::format(err_msg) % arg);
+
+  char mod         = tolower(s[s.length() - 1]);
+  int64_t modifier = 1;
+  if ('k' == mod)
+    modifier = 1024;
+  else if ('m' == mod)
+    modifier = 1024 * 1024;
+  else if (!isdigit(mod))
+    mxerror(boost::format(err_msg) % arg);
+
+  if (1 != modifier)
+    s.erase(s.size() - 1);
+
+  if (!parse_int(s, g_async_output_block_size) || (0 >= g_async_output_block_size))
+    mxerror(boost::format(err_msg) % arg);
+
+  g_async_output_block_size *= modifier;
+}
+
 /** \brief Parse the \c --split argument
 
    The \c --split option takes several formats.
@@ -1158,6 +1282,37 @@ parse_arg_track_order(const std::string &s) {
   }
 }
 
+/** \brief Parse the argument for \c --additional-output-tracks
+
+   The argument must be a comma separated list of track IDs. Each track
+   ID consists of a file ID and a track ID separated by a colon.
+*/
+static void
+parse_arg_additional_output_tracks(const std::string &s) {
+  if (g_additional_outputs.empty())
+    mxerror(Y("'--additional-output-tracks' must be preceded by '--additional-output'.\n"));
+
+  track_order_t track;
+
+  std::vector<std::string> parts = split(s, ",");
+  strip(parts);
+
+  for (auto &part : parts) {
+    std::vector<std::string> pair = split(part.c_str(), ":");
+
+    if (pair.size() != 2)
+      mxerror(boost::format(Y("'%1%' is not a valid pair of file ID and track ID in '--additional-output-tracks %2%'.\n")) % part % s);
+
+    if (!parse_int(pair[0], track.file_id))
+      mxerror(boost::format(Y("'%1%' is not a valid file ID in '--additional-output-tracks %2%'.\n")) % pair[0] % s);
+
+    if (!parse_int(pair[1], track.track_id))
+      mxerror(boost::format(Y("'%1%' is not a valid track ID in '--additional-output-tracks %2%'.\n")) % pair[1] % s);
+
+    g_additional_outputs.back()->add_requested_track(track);
+  }
+}
+
 /** \brief Parse the argument for \c --append-to
 
    The argument must be a comma separated list. Each of the list's items
@@ -1643,27 +1798,41 @@ parse_args(std::vector<std::string> args) {
     set_usage();
 
   // Check if only information about the file is wanted. In this mode only
-  // two parameters are allowed: the --identify switch and the file.
-  if ((   (2 == args.size())
-       || (3 == args.size()))
+  // two parameters are allowed: the --identify switch and the file. The
+  // identification cache options may be given in addition to them.
+  if (   !args.empty()
       && (   (args[0] == "-i")
           || (args[0] == "--identify")
           || (args[0] == "--identify-verbose")
           || (args[0] == "-I")
           || (args[0] == "--identify-for-mmg"))) {
-    if ((args[0] == "--identify-verbose") || (args[0] == "-I"))
-      g_identify_verbose = true;
+    std::vector<std::string> identify_args;
+    for (auto &arg : args)
+      if (arg == "--identification-cache") {
+        if (IDENTIFICATION_CACHE_OFF == g_identification_cache_mode)
+          g_identification_cache_mode = IDENTIFICATION_CACHE_USE;
 
-    if (args[0] == "--identify-for-mmg") {
-      g_identify_verbose = true;
-      g_identify_for_mmg = true;
-    }
+      } else if (arg == "--refresh-identification-cache")
+        g_identification_cache_mode = IDENTIFICATION_CACHE_REFRESH;
+
+      else
+        identify_args.push_back(arg);
+
+    if ((2 == identify_args.size()) || (3 == identify_args.size())) {
+      if ((identify_args[0] == "--identify-verbose") || (identify_args[0] == "-I"))
+        g_identify_verbose = true;
+
+      if (identify_args[0] == "--identify-for-mmg") {
+        g_identify_verbose = true;
+        g_identify_for_mmg = true;
+      }
 
-    if (3 == args.size())
-      verbose = 3;
+      if (3 == identify_args.size())
+        verbose = 3;
 
-    identify(args[1]);
-    mxexit();
+      identify(identify_args[1]);
+      mxexit();
+    }
   }
 
   // First parse options that either just print some infos and then exit.
@@ -1691,8 +1860,6 @@ parse_args(std::vector<std::string> args) {
 
   }
 
-  mxinfo(boost::format("%1%\n") % get_version_info("mkvmerge", vif_full));
-
   // Now parse options that are needed right at the beginning.
   mxforeach(sit, args) {
     const std::string &this_arg = *sit;
@@ -1717,8 +1884,23 @@ parse_args(std::vector<std::string> args) {
 
     } else if ((this_arg == "-w") || (this_arg == "--webm"))
       set_output_compatibility(OC_WEBM);
+
+    else if (this_arg == "--memory-map") {
+      if (!mm_mmap_io_c::is_available())
+        mxwarn(Y("Memory mapping input files is not supported on this platform. '--memory-map' will be ignored.\n"));
+      mm_mmap_io_c::enable(true);
+    }
+  }
+
+  // The standard output is reserved for the file's content. All
+  // messages go to the standard error output instead.
+  if (g_outfile == "-") {
+    g_live_output = true;
+    redirect_stdio(mm_io_cptr(new mm_stdio_c(stderr)));
   }
 
+  mxinfo(boost::format("%1%\n") % get_version_info("mkvmerge", vif_full));
+
   if (g_outfile.empty()) {
     mxinfo(Y("Error: no output file name was given.\n\n"));
     usage(2);
@@ -1749,11 +1931,15 @@ parse_args(std::vector<std::string> args) {
     }
 
     if (   (this_arg == "-w")
-        || (this_arg == "--webm"))
+        || (this_arg == "--webm")
+        || (this_arg == "--memory-map"))
       continue;
 
     // Global options
-    if ((this_arg == "--priority")) {
+    if ((this_arg == "--identification-cache") || (this_arg == "--refresh-identification-cache"))
+      mxerror(boost::format(Y("'%1%' can only be used together with '--identify'.\n")) % this_arg);
+
+    else if ((this_arg == "--priority")) {
       if (no_next_arg)
         mxerror(Y("'--priority' lacks its argument.\n"));
 
@@ -1824,6 +2010,9 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-cues")
       g_write_cues = false;
 
+    else if (this_arg == "--live")
+      g_live_output = true;
+
     else if (this_arg == "--clusters-in-meta-seek")
       g_write_meta_seek_for_clusters = true;
 
@@ -1833,7 +2022,48 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--enable-durations")
       g_use_durations = true;
 
-    else if (this_arg == "--attachment-description") {
+    else if (this_arg == "--read-ahead") {
+      if (no_next_arg)
+        mxerror(Y("'--read-ahead' lacks the number of packets.\n"));
+
+      if (!parse_int(next_arg, g_read_ahead_queue_size) || (0 > g_read_ahead_queue_size))
+        mxerror(boost::format(Y("Invalid number of packets in '--read-ahead %1%'.\n")) % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--async-output") {
+      if (no_next_arg)
+        mxerror(Y("'--async-output' lacks the number of buffers.\n"));
+
+      parse_arg_async_output(next_arg);
+      sit++;
+
+    } else if (this_arg == "--mp4-read-buffer") {
+      if (no_next_arg)
+        mxerror(Y("'--mp4-read-buffer' lacks the size.\n"));
+
+      parse_arg_mp4_read_buffer(next_arg);
+      sit++;
+
+    } else if (this_arg == "--direct-output") {
+      if (!mm_async_write_io_c::is_direct_io_available())
+        mxwarn(Y("Bypassing the operating system's cache is not supported on this platform. '--direct-output' will be ignored.\n"));
+      else {
+        g_direct_output = true;
+        if (0 == g_async_output_blocks)
+          g_async_output_blocks = 4;
+      }
+
+    } else if (this_arg == "--compression-threads") {
+      if (no_next_arg)
+        mxerror(Y("'--compression-threads' lacks the number of threads.\n"));
+
+      if (!parse_int(next_arg, g_compression_threads) || (0 > g_compression_threads))
+        mxerror(boost::format(Y("Invalid number of threads in '--compression-threads %1%'.\n")) % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--attachment-description") {
       if (no_next_arg)
         mxerror(Y("'--attachment-description' lacks the description.\n"));
 
@@ -1938,7 +2168,15 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-global-tags")
       ti->m_no_global_tags = true;
 
-    else if (this_arg == "--meta-seek-size") {
+    else if (this_arg == "--start-at") {
+      if (no_next_arg)
+        mxerror(Y("'--start-at' lacks the timecode.\n"));
+
+      if (!parse_timecode(next_arg, ti->m_start_at))
+        mxerror(boost::format(Y("Invalid timecode for '--start-at' in '--start-at %1%'. Additional error message: %2%\n")) % next_arg % timecode_parser_error);
+      sit++;
+
+    } else if (this_arg == "--meta-seek-size") {
       mxwarn(Y("The option '--meta-seek-size' is no longer supported. Please read mkvmerge's documentation, especially the section about the MATROSKA FILE LAYOUT.\n"));
       sit++;
 
@@ -2144,6 +2382,35 @@ parse_args(std::vector<std::string> args) {
       parse_arg_track_order(next_arg);
       sit++;
 
+    } else if (this_arg == "--additional-output") {
+      if (no_next_arg || next_arg.empty())
+        mxerror(Y("'--additional-output' lacks the file name.\n"));
+
+      bool already_used = next_arg == g_outfile;
+      for (auto &output : g_additional_outputs)
+        already_used |= output->get_file_name() == next_arg;
+
+      if (already_used)
+        mxerror(boost::format(Y("The file '%1%' is used as an output file more than once.\n")) % next_arg);
+
+      g_additional_outputs.push_back(additional_output_cptr(new additional_output_c(next_arg)));
+      if (is_webm_file_name(next_arg))
+        g_additional_outputs.back()->set_webm(true);
+      sit++;
+
+    } else if (this_arg == "--additional-output-tracks") {
+      if (no_next_arg)
+        mxerror(Y("'--additional-output-tracks' lacks its argument.\n"));
+
+      parse_arg_additional_output_tracks(next_arg);
+      sit++;
+
+    } else if (this_arg == "--additional-output-webm") {
+      if (g_additional_outputs.empty())
+        mxerror(Y("'--additional-output-webm' must be preceded by '--additional-output'.\n"));
+
+      g_additional_outputs.back()->set_webm(true);
+
     } else if (this_arg == "--append-to") {
       if (no_next_arg)
         mxerror(Y("'--append-to' lacks its argument.\n"));
@@ -2186,6 +2453,12 @@ parse_args(std::vector<std::string> args) {
   if (!g_cluster_helper->splitting() && !g_no_linking)
     mxwarn(Y("'--link' is only useful in combination with '--split'.\n"));
 
+  if (g_live_output && g_cluster_helper->splitting())
+    mxerror(Y("Splitting cannot be used together with live output ('--live' or '-o -').\n"));
+
+  if (g_live_output && !g_additional_outputs.empty())
+    mxerror(Y("Additional output files cannot be used together with live output ('--live' or '-o -').\n"));
+
   delete ti;
 
   if (!inputs_found && g_files.empty())
@@ -2240,8 +2513,14 @@ main(int argc,
     mxerror(Y("No streams to output were found. Aborting.\n"));
 
   create_next_output_file();
+  for (auto &output : g_additional_outputs)
+    output->open();
+
   main_loop();
+
   finish_file(true);
+  for (auto &output : g_additional_outputs)
+    output->finish();
 
   mxinfo(boost::format(Y("Muxing took %1%.\n")) % create_minutes_seconds_time_string((get_current_time_millis() - start + 500) / 1000, true));
 
@@ -28,6 +28,8 @@
 #include <unistd.h>
 #endif
 #if defined(SYS_WINDOWS)
+#include <fcntl.h>
+#include <io.h>
 #include <windows.h>
 #endif
 
@@ -63,14 +65,20 @@
 #include <matroska/KaxTrackVideo.h>
 #include <matroska/KaxVersion.h>
 
+#include "common/aac.h"
+#include "common/ac3.h"
 #include "common/chapters/chapters.h"
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
+#include "common/id3.h"
 #include "common/math.h"
 #include "common/mm_io.h"
+#include "common/mm_mmap_io.h"
 #include "common/mm_read_cache_io.h"
+#include "common/mm_async_write_io.h"
 #include "common/mm_write_cache_io.h"
+#include "common/mp3.h"
 #include "common/strings/formatting.h"
 #include "common/tags/tags.h"
 #include "common/translation.h"
@@ -111,10 +119,14 @@
 #include "input/r_vobsub.h"
 #include "input/r_wav.h"
 #include "input/r_wavpack.h"
+#include "merge/additional_output.h"
 #include "merge/cluster_helper.h"
+#include "merge/cues.h"
 #include "merge/mkvmerge.h"
 #include "merge/output_control.h"
 #include "merge/debugging.h"
+#include "merge/packet_scheduler.h"
+#include "merge/read_ahead.h"
 #include "merge/webm.h"
 
 using namespace libmatroska;
@@ -154,6 +166,13 @@ bool g_write_meta_seek_for_clusters         = false;
 bool g_no_lacing                            = false;
 bool g_no_linking                           = true;
 bool g_use_durations                        = false;
+int g_async_output_blocks                   = 0;
+int64_t g_async_output_block_size           = 4 * 1024 * 1024;
+bool g_direct_output                        = false;
+int64_t g_qtmp4_read_buffer_size            = 32 * 1024 * 1024;
+bool g_live_output                          = false;
+int g_compression_threads                   = 0;
+thread_pool_c *g_compression_pool           = NULL;
 
 double g_timecode_scale                     = TIMECODE_SCALE;
 timecode_scale_mode_e g_timecode_scale_mode = TIMECODE_SCALE_MODE_NORMAL;
@@ -169,7 +188,7 @@ bool g_identify_for_mmg                     = false;
 KaxSegment *g_kax_segment                   = NULL;
 KaxTracks *g_kax_tracks                     = NULL;
 KaxTrackEntry *g_kax_last_entry             = NULL;
-KaxCues *g_kax_cues                         = NULL;
+cues_c *g_cues                              = NULL;
 KaxSeekHead *g_kax_sh_main                  = NULL;
 KaxSeekHead *g_kax_sh_cues                  = NULL;
 KaxChapters *g_kax_chapters                 = NULL;
@@ -216,6 +235,11 @@ static EbmlVoid *s_void_after_track_headers = NULL;
 
 static mm_io_cptr s_out;
 
+// In live mode everything up to the first cluster is written to this
+// buffer instead of s_live_out. See write_live_headers().
+static mm_mem_io_c *s_live_header_buffer    = NULL;
+static mm_io_cptr s_live_out;
+
 static bitvalue_c s_seguid_prev(128), s_seguid_current(128), s_seguid_next(128);
 
 static int s_display_files_done           = 0;
@@ -271,10 +295,20 @@ sighandler(int /* signum */) {
            "Ctrl+C). Trying to sanitize the file. If mkvmerge hangs during "
            "this process you'll have to kill it manually.\n"));
 
+  if (g_live_output) {
+    // Nothing that has already been written can be fixed in live mode.
+    write_live_headers();
+    if (g_write_cues && g_cue_writing_requested)
+      g_cues->write(*s_out, (int64_t)g_timecode_scale);
+    s_out->flush();
+
+    mxerror(Y("mkvmerge was interrupted by a SIGINT (Ctrl+C?)\n"));
+  }
+
   mxinfo(Y("The file is being fixed, part 1/4..."));
   // Render the cues.
   if (g_write_cues && g_cue_writing_requested)
-    g_kax_cues->Render(*s_out);
+    g_cues->write(*s_out, (int64_t)g_timecode_scale);
   mxinfo(Y(" done\n"));
 
   mxinfo(Y("The file is being fixed, part 2/4..."));
@@ -289,7 +323,7 @@ sighandler(int /* signum */) {
   mxinfo(Y("The file is being fixed, part 3/4..."));
   // Write meta seek information if it is not disabled.
   if (g_cue_writing_requested)
-    g_kax_sh_main->IndexThis(*g_kax_cues, *g_kax_segment);
+    g_kax_sh_main->IndexThis(*g_cues->get_kax_cues(), *g_kax_segment);
 
   if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
     g_kax_sh_main->UpdateSize();
@@ -322,7 +356,11 @@ static mm_io_cptr
 open_input_file(filelist_t &file,
                 bool use_probe_cache) {
   try {
-    if (file.all_names.size() == 1)
+    if ((file.all_names.size() == 1) && mm_mmap_io_c::is_enabled())
+      // The mapping makes the probe cache unnecessary.
+      return mm_mmap_io_c::open(file.name);
+
+    else if (file.all_names.size() == 1)
       return use_probe_cache ? mm_io_cptr(mm_probe_cache_io_c::open(file.name, 20 * 1024 * 1024)) : mm_file_io_c::open(file.name);
     else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
@@ -334,6 +372,136 @@ open_input_file(filelist_t &file,
   }
 }
 
+/* Probes for raw MP3, AC3 and AAC streams by looking for a number of
+   consecutive frames in ranges of growing size at the start of the file.
+
+   Calling each reader's probe_file() for each range would read and scan
+   the same data over and over again. Instead the largest range is read
+   only once. A format is only scanned in the smaller ranges if it has
+   been found in the largest one at all: frames found in a range are also
+   found in every larger range, so the result does not change.
+*/
+class consecutive_frames_prober_c {
+protected:
+  mm_io_c *m_in;
+  memory_cptr m_data, m_data_after_id3v2;
+  int m_size, m_size_after_id3v2;
+
+public:
+  consecutive_frames_prober_c(mm_io_c *in)
+    : m_in(in)
+    , m_size(-1)
+    , m_size_after_id3v2(-1)
+  {
+  }
+
+  file_type_e probe(const int *probe_sizes, int num_headers);
+
+protected:
+  int read(memory_cptr &data, int max_size, bool skip_id3v2);
+  int find_smallest_range(file_type_e type, const int *probe_sizes, int num_headers);
+  int find_headers(file_type_e type, int size, int num_headers);
+};
+
+/** \brief Determines the type of a raw audio stream
+
+   \param probe_sizes The range sizes to try in ascending order,
+     terminated by 0.
+   \param num_headers The number of consecutive frames required.
+   \return The first type found in the smallest range. Ties are broken
+     in the order MP3, AC3, AAC. \c FILE_TYPE_IS_UNKNOWN if none is found.
+*/
+file_type_e
+consecutive_frames_prober_c::probe(const int *probe_sizes,
+                                   int num_headers) {
+  static const file_type_e s_types[] = { FILE_TYPE_MP3, FILE_TYPE_AC3, FILE_TYPE_AAC, FILE_TYPE_IS_UNKNOWN };
+
+  int max_size = 0, i;
+  for (i = 0; 0 != probe_sizes[i]; ++i)
+    max_size = std::max(max_size, probe_sizes[i]);
+
+  if (-1 == m_size) {
+    m_size             = read(m_data,             max_size, false);
+    m_size_after_id3v2 = read(m_data_after_id3v2, max_size, true);
+  }
+
+  file_type_e type = FILE_TYPE_IS_UNKNOWN;
+  int type_range   = -1;
+
+  for (i = 0; FILE_TYPE_IS_UNKNOWN != s_types[i]; ++i) {
+    int range = find_smallest_range(s_types[i], probe_sizes, num_headers);
+    if ((-1 != range) && ((-1 == type_range) || (range < type_range))) {
+      type       = s_types[i];
+      type_range = range;
+    }
+  }
+
+  return type;
+}
+
+int
+consecutive_frames_prober_c::read(memory_cptr &data,
+                                  int max_size,
+                                  bool skip_id3v2) {
+  try {
+    data = memory_c::alloc(max_size);
+
+    m_in->setFilePointer(0, seek_beginning);
+    if (skip_id3v2)
+      skip_id3v2_tag(*m_in);
+
+    int num_read = m_in->read(data->get_buffer(), max_size);
+    m_in->setFilePointer(0, seek_beginning);
+
+    return num_read;
+
+  } catch (...) {
+    return 0;
+  }
+}
+
+/** \brief Finds the index of the smallest range containing frames of \a type
+
+   \return The index into \a probe_sizes or -1 if there are not enough
+     consecutive frames even in the largest range.
+*/
+int
+consecutive_frames_prober_c::find_smallest_range(file_type_e type,
+                                                 const int *probe_sizes,
+                                                 int num_headers) {
+  int available = FILE_TYPE_AC3 == type ? m_size_after_id3v2 : m_size;
+
+  if (-1 == find_headers(type, available, num_headers))
+    return -1;
+
+  int i;
+  for (i = 0; 0 != probe_sizes[i]; ++i)
+    if (-1 != find_headers(type, std::min(available, probe_sizes[i]), num_headers))
+      return i;
+
+  return -1;
+}
+
+int
+consecutive_frames_prober_c::find_headers(file_type_e type,
+                                          int size,
+                                          int num_headers) {
+  if (0 >= size)
+    return -1;
+
+  try {
+    if (FILE_TYPE_MP3 == type)
+      return find_consecutive_mp3_headers(m_data->get_buffer(), size, num_headers);
+    else if (FILE_TYPE_AC3 == type)
+      return find_consecutive_ac3_headers(m_data_after_id3v2->get_buffer(), size, num_headers);
+    else
+      return find_consecutive_aac_headers(m_data->get_buffer(), size, num_headers);
+
+  } catch (...) {
+    return -1;
+  }
+}
+
 /** \brief Probe the file type
 
    Opens the input file and calls the \c probe_file function for each known
@@ -345,6 +513,8 @@ get_file_type(filelist_t &file) {
   mm_io_c *io      = af_io.get_object();
   int64_t size     = io->get_size();
 
+  consecutive_frames_prober_c consecutive_frames_prober(io);
+
   file_type_e type = FILE_TYPE_IS_UNKNOWN;
   // File types that can be detected unambiguously but are not supported
   if (aac_adif_reader_c::probe_file(io, size))
@@ -399,14 +569,7 @@ get_file_type(filelist_t &file) {
     static const int s_probe_sizes[]                          = { 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024, 0 };
     static const int s_probe_num_required_consecutive_packets = 64;
 
-    int i;
-    for (i = 0; (0 != s_probe_sizes[i]) && (FILE_TYPE_IS_UNKNOWN == type); ++i)
-      if (mp3_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_MP3;
-      else if (ac3_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_AC3;
-      else if (aac_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_AAC;
+    type = consecutive_frames_prober.probe(s_probe_sizes, s_probe_num_required_consecutive_packets);
   }
   // More file types with detection issues.
   if (type != FILE_TYPE_IS_UNKNOWN)
@@ -425,14 +588,7 @@ get_file_type(filelist_t &file) {
     static const int s_probe_sizes[]                          = { 32 * 1024, 64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024, 0 };
     static const int s_probe_num_required_consecutive_packets = 20;
 
-    int i;
-    for (i = 0; (0 != s_probe_sizes[i]) && (FILE_TYPE_IS_UNKNOWN == type); ++i)
-      if (mp3_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_MP3;
-      else if (ac3_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_AC3;
-      else if (aac_reader_c::probe_file(io, size, s_probe_sizes[i], s_probe_num_required_consecutive_packets))
-        type = FILE_TYPE_AAC;
+    type = consecutive_frames_prober.probe(s_probe_sizes, s_probe_num_required_consecutive_packets);
   }
   if (FILE_TYPE_IS_UNKNOWN == type) {
     // All text file types (subtitles).
@@ -491,7 +647,8 @@ display_progress() {
   }
 
   bool display_progress  = false;
-  int current_percentage = (s_display_reader->get_progress() + s_display_files_done * 100) / s_display_path_length;
+  int reader_progress    = NULL != g_read_ahead ? g_read_ahead->get_progress(s_display_reader) : s_display_reader->get_progress();
+  int current_percentage = (reader_progress + s_display_files_done * 100) / s_display_path_length;
   int64_t current_time   = get_current_time_millis();
 
   if (   (-1 == s_previous_percentage)
@@ -602,8 +759,6 @@ set_timecode_scale() {
 
   g_max_ns_per_cluster                                    = std::min((int64_t)(32700 * g_timecode_scale), g_max_ns_per_cluster);
   GetChildAs<KaxTimecodeScale, EbmlUInteger>(s_kax_infos) = (int64_t)g_timecode_scale;
-
-  g_kax_cues->SetGlobalTimecodeScale((int64_t)g_timecode_scale);
 }
 
 static void
@@ -621,8 +776,51 @@ render_ebml_head(mm_io_c *out) {
   s_head->Render(*out, true);
 }
 
+static void
+warn_about_live_header_changes() {
+  static bool s_warning_issued = false;
+
+  if (s_warning_issued)
+    return;
+
+  mxwarn(Y("The track headers have changed after they had been written. In live mode the headers cannot be rewritten; the output file will contain the original ones.\n"));
+  s_warning_issued = true;
+}
+
+/** \brief Writes the headers that have been buffered in live mode
+
+   In live mode the headers are kept in memory until the first cluster
+   is about to be written. Up to that point the packetizers can still
+   modify them while they process their first packets. Afterwards all
+   data is written to the destination right away.
+*/
+void
+write_live_headers() {
+  if (NULL == s_live_header_buffer)
+    return;
+
+  s_live_header_buffer->setFilePointer(0, seek_end);
+  uint64_t size = s_live_header_buffer->getFilePointer();
+  memory_cptr headers(new memory_c(s_live_header_buffer->get_and_lock_buffer(), size, true));
+
+  s_live_out->write(headers);
+  s_live_header_buffer = NULL;
+  s_out                = s_live_out;
+  s_live_out.clear();
+
+  g_cluster_helper->set_output(s_out.get_object());
+}
+
 void
 rerender_ebml_head() {
+  if ((NULL != g_read_ahead) && g_read_ahead->defer_ebml_head_rerendering())
+    return;
+
+  if (g_live_output && (NULL == s_live_header_buffer)) {
+    warn_about_live_header_changes();
+    return;
+  }
+
   mm_io_c *out = g_cluster_helper->get_output();
   out->save_pos(s_head->GetElementPosition());
   render_ebml_head(out);
@@ -642,13 +840,16 @@ render_headers(mm_io_c *out) {
 
     s_kax_infos = &GetChild<KaxInfo>(*g_kax_segment);
 
-    if ((NULL == g_video_packetizer) || (TIMECODE_SCALE_MODE_AUTO == g_timecode_scale_mode))
-      s_kax_duration = new KaxMyDuration(EbmlFloat::FLOAT_64);
-    else
-      s_kax_duration = new KaxMyDuration(EbmlFloat::FLOAT_32);
+    // The duration is not known in live mode.
+    if (!g_live_output) {
+      if ((NULL == g_video_packetizer) || (TIMECODE_SCALE_MODE_AUTO == g_timecode_scale_mode))
+        s_kax_duration = new KaxMyDuration(EbmlFloat::FLOAT_64);
+      else
+        s_kax_duration = new KaxMyDuration(EbmlFloat::FLOAT_32);
 
-    *(static_cast<EbmlFloat *>(s_kax_duration)) = 0.0;
-    s_kax_infos->PushElement(*s_kax_duration);
+      *(static_cast<EbmlFloat *>(s_kax_duration)) = 0.0;
+      s_kax_infos->PushElement(*s_kax_duration);
+    }
 
     if (!hack_engaged(ENGAGE_NO_VARIABLE_DATA)) {
       std::string muxing_app                                    = std::string("libebml v") + EbmlCodeVersion + std::string(" + libmatroska v") + KaxCodeVersion;
@@ -736,11 +937,24 @@ render_headers(mm_io_c *out) {
 
     g_kax_segment->WriteHead(*out, 8);
 
-    // Reserve some space for the meta seek stuff.
     g_kax_sh_main = new KaxSeekHead();
-    s_kax_sh_void = new EbmlVoid();
-    s_kax_sh_void->SetSize(4096);
-    s_kax_sh_void->Render(*out);
+
+    if (g_live_output) {
+      // The segment's size will never be written in live mode. A size
+      // with all bits set means "unknown". The meta seek information
+      // cannot be written either.
+      static const unsigned char s_unknown_size[8] = { 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+      out->save_pos(g_kax_segment->GetElementPosition() + g_kax_segment->HeadSize() - 8);
+      out->write(s_unknown_size, 8);
+      out->restore_pos();
+
+    } else {
+      // Reserve some space for the meta seek stuff.
+      s_kax_sh_void = new EbmlVoid();
+      s_kax_sh_void->SetSize(4096);
+      s_kax_sh_void->Render(*out);
+    }
 
     if (g_write_meta_seek_for_clusters)
       g_kax_sh_cues = new KaxSeekHead();
@@ -797,6 +1011,14 @@ render_headers(mm_io_c *out) {
 */
 void
 rerender_track_headers() {
+  if ((NULL != g_read_ahead) && g_read_ahead->defer_track_headers_rerendering())
+    return;
+
+  if (g_live_output && (NULL == s_live_header_buffer)) {
+    warn_about_live_header_changes();
+    return;
+  }
+
   g_kax_tracks->UpdateSize(false);
 
   int64_t new_void_size = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->GetSize()
@@ -1235,6 +1457,10 @@ create_readers() {
     for (auto &file : g_files) {
       file.reader->m_appending = file.appending;
       file.reader->create_packetizers();
+
+      if ((0 < file.ti->m_start_at) && !file.reader->seek_to_timecode(file.ti->m_start_at))
+        mxerror_fn(file.ti->m_fname, boost::format(Y("Reading cannot start at %1% because the file type does not support seeking or because the file does not contain an index.\n"))
+                   % format_timecode(file.ti->m_start_at, 3));
     }
     // Check if all track IDs given on the command line are actually
     // present.
@@ -1375,6 +1601,17 @@ render_chapter_void_placeholder() {
     return;
   }
 
+  if (g_live_output) {
+    // There's no way to fill a placeholder in live mode. As splitting
+    // isn't possible either all chapters are written right away.
+    s_chapters_in_this_file = copy_chapters(g_kax_chapters);
+    merge_chapter_entries(*s_chapters_in_this_file);
+    sort_ebml_master(s_chapters_in_this_file);
+    s_chapters_in_this_file->Render(*s_out, true);
+
+    return;
+  }
+
   s_kax_chapters_void = new EbmlVoid;
   s_kax_chapters_void->SetSize(s_max_chapter_size + 100);
   s_kax_chapters_void->Render(*s_out);
@@ -1413,6 +1650,26 @@ prepare_tags_for_rendering() {
   g_tags_size = s_kax_tags->ElementSize();
 }
 
+/** \brief Opens the destination for live mode
+
+   The file name \c - stands for the standard output. Everything is
+   written to a memory buffer until \c write_live_headers() is called.
+*/
+static void
+open_live_output(const std::string &file_name) {
+  if (file_name == "-") {
+#if defined(SYS_WINDOWS)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    s_live_out = mm_io_cptr(new mm_write_cache_io_c(new mm_stdio_c(stdout), 20 * 1024 * 1024));
+
+  } else
+    s_live_out = mm_write_cache_io_c::open(file_name, 20 * 1024 * 1024);
+
+  s_live_header_buffer = new mm_mem_io_c(NULL, 0, 64 * 1024);
+  s_out                = mm_io_cptr(s_live_header_buffer);
+}
+
 /** \brief Creates the next output file
 
    Creates a new file name depending on the split settings. Opens that
@@ -1424,12 +1681,16 @@ create_next_output_file() {
   std::string this_outfile = g_cluster_helper->splitting() ? create_output_name() : g_outfile;
 
   g_kax_segment       = new KaxSegment();
-  g_kax_cues          = new KaxCues();
-  g_kax_cues->SetGlobalTimecodeScale((int64_t)g_timecode_scale);
+  g_cues              = new cues_c;
 
   // Open the output file.
   try {
-    s_out = mm_write_cache_io_c::open(this_outfile, 20 * 1024 * 1024);
+    if (g_live_output)
+      open_live_output(this_outfile);
+    else if (0 < g_async_output_blocks)
+      s_out = mm_async_write_io_c::open(this_outfile, g_async_output_blocks, g_async_output_block_size, g_direct_output);
+    else
+      s_out = mm_write_cache_io_c::open(this_outfile, 20 * 1024 * 1024);
   } catch (...) {
     mxerror(boost::format(Y("The output file '%1%' could not be opened for writing (%2%).\n")) % this_outfile % strerror(errno));
   }
@@ -1439,6 +1700,7 @@ create_next_output_file() {
 
   g_cluster_helper->set_output(s_out.get_object());
   render_headers(s_out.get_object());
+  g_cluster_helper->set_segment(g_kax_segment, g_cues, g_kax_sh_cues);
   render_attachments(s_out.get_object());
   render_chapter_void_placeholder();
   add_tags_from_cue_chapters();
@@ -1459,6 +1721,10 @@ int64_t
 finish_file(bool last_file) {
   mxinfo("\n");
 
+  // Files without any cluster still have their headers in the buffer.
+  if (g_live_output)
+    write_live_headers();
+
   // Render the track headers a second time if the user has requested that.
   if (hack_engaged(ENGAGE_WRITE_HEADERS_TWICE)) {
     EbmlElement *second_tracks = g_kax_tracks->Clone();
@@ -1471,66 +1737,69 @@ finish_file(bool last_file) {
   if (g_write_cues && g_cue_writing_requested) {
     if (1 <= verbose)
       mxinfo(Y("The cue entries (the index) are being written..."));
-    g_kax_cues->Render(*s_out);
+    g_cues->write(*s_out, (int64_t)g_timecode_scale);
     if (1 <= verbose)
       mxinfo("\n");
   }
 
-  // Now re-render the s_kax_duration and fill in the biggest timecode
-  // as the file's duration.
-  s_out->save_pos(s_kax_duration->GetElementPosition());
-  mxverb(3,
-         boost::format("mkvmerge: s_kax_duration: gdur %1% tcs %2% du %3%\n")
-         % g_cluster_helper->get_duration() % g_timecode_scale
-         % irnd((double)g_cluster_helper->get_duration() / (double)((int64_t)g_timecode_scale)));
+  // Nothing that has already been written can be modified in live mode.
+  if (!g_live_output) {
+    // Now re-render the s_kax_duration and fill in the biggest timecode
+    // as the file's duration.
+    s_out->save_pos(s_kax_duration->GetElementPosition());
+    mxverb(3,
+           boost::format("mkvmerge: s_kax_duration: gdur %1% tcs %2% du %3%\n")
+           % g_cluster_helper->get_duration() % g_timecode_scale
+           % irnd((double)g_cluster_helper->get_duration() / (double)((int64_t)g_timecode_scale)));
 
-  *(static_cast<EbmlFloat *>(s_kax_duration)) = irnd((double)g_cluster_helper->get_duration() / (double)((int64_t)g_timecode_scale));
-  s_kax_duration->Render(*s_out);
+    *(static_cast<EbmlFloat *>(s_kax_duration)) = irnd((double)g_cluster_helper->get_duration() / (double)((int64_t)g_timecode_scale));
+    s_kax_duration->Render(*s_out);
 
-  // If splitting is active and this is the last part then handle the
-  // 'next segment UID'. If it was given on the command line then set it here.
-  // Otherwise remove an existing one (e.g. from file linking during
-  // splitting).
-
-  s_kax_infos->UpdateSize(true);
-  int64_t info_size = s_kax_infos->ElementSize();
-  int changed       = 0;
-
-  if (last_file && g_seguid_link_next.is_set()) {
-    GetChild<KaxNextUID>(*s_kax_infos).CopyBuffer(g_seguid_link_next->data(), 128 / 8);
-    changed = 1;
-
-  } else if (!last_file && g_no_linking) {
-    size_t i;
-    for (i = 0; s_kax_infos->ListSize() > i; ++i)
-      if (EbmlId(*(*s_kax_infos)[i]) == EBML_ID(KaxNextUID)) {
-        delete (*s_kax_infos)[i];
-        s_kax_infos->Remove(i);
-        changed = 2;
-        break;
-      }
-  }
+    // If splitting is active and this is the last part then handle the
+    // 'next segment UID'. If it was given on the command line then set it here.
+    // Otherwise remove an existing one (e.g. from file linking during
+    // splitting).
 
-  if (0 != changed) {
-    s_out->setFilePointer(s_kax_infos->GetElementPosition());
     s_kax_infos->UpdateSize(true);
-    info_size -= s_kax_infos->ElementSize();
-    s_kax_infos->Render(*s_out, true);
-    if (2 == changed) {
-      if (2 < info_size) {
-        EbmlVoid void_after_infos;
-        void_after_infos.SetSize(info_size);
-        void_after_infos.UpdateSize();
-        void_after_infos.SetSize(info_size - void_after_infos.HeadSize());
-        void_after_infos.Render(*s_out);
-
-      } else if (0 < info_size) {
-        char zero[2] = {0, 0};
-        s_out->write(zero, info_size);
+    int64_t info_size = s_kax_infos->ElementSize();
+    int changed       = 0;
+
+    if (last_file && g_seguid_link_next.is_set()) {
+      GetChild<KaxNextUID>(*s_kax_infos).CopyBuffer(g_seguid_link_next->data(), 128 / 8);
+      changed = 1;
+
+    } else if (!last_file && g_no_linking) {
+      size_t i;
+      for (i = 0; s_kax_infos->ListSize() > i; ++i)
+        if (EbmlId(*(*s_kax_infos)[i]) == EBML_ID(KaxNextUID)) {
+          delete (*s_kax_infos)[i];
+          s_kax_infos->Remove(i);
+          changed = 2;
+          break;
+        }
+    }
+
+    if (0 != changed) {
+      s_out->setFilePointer(s_kax_infos->GetElementPosition());
+      s_kax_infos->UpdateSize(true);
+      info_size -= s_kax_infos->ElementSize();
+      s_kax_infos->Render(*s_out, true);
+      if (2 == changed) {
+        if (2 < info_size) {
+          EbmlVoid void_after_infos;
+          void_after_infos.SetSize(info_size);
+          void_after_infos.UpdateSize();
+          void_after_infos.SetSize(info_size - void_after_infos.HeadSize());
+          void_after_infos.Render(*s_out);
+
+        } else if (0 < info_size) {
+          char zero[2] = {0, 0};
+          s_out->write(zero, info_size);
+        }
       }
     }
+    s_out->restore_pos();
   }
-  s_out->restore_pos();
 
   // Render the segment info a second time if the user has requested that.
   if (hack_engaged(ENGAGE_WRITE_HEADERS_TWICE)) {
@@ -1542,7 +1811,7 @@ finish_file(bool last_file) {
   // that was resesrved at the beginning.
   KaxChapters *chapters_here = NULL;
 
-  if (NULL != g_kax_chapters) {
+  if ((NULL != g_kax_chapters) && !g_live_output) {
     int64_t offset = g_no_linking ? g_cluster_helper->get_first_timecode_in_file() : 0;
     int64_t start  = g_cluster_helper->get_first_timecode_in_file();
     int64_t end    = start + g_cluster_helper->get_duration();
@@ -1590,7 +1859,7 @@ finish_file(bool last_file) {
 
   // Write meta seek information if it is not disabled.
   if (g_cue_writing_requested)
-    g_kax_sh_main->IndexThis(*g_kax_cues, *g_kax_segment);
+    g_kax_sh_main->IndexThis(*g_cues->get_kax_cues(), *g_kax_segment);
 
   if (NULL != tags_here) {
     g_kax_sh_main->IndexThis(*tags_here, *g_kax_segment);
@@ -1617,7 +1886,7 @@ finish_file(bool last_file) {
     s_kax_as = NULL;
   }
 
-  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
+  if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK) && !g_live_output) {
     g_kax_sh_main->UpdateSize();
     if (s_kax_sh_void->ReplaceWith(*g_kax_sh_main, *s_out, true) == INVALID_FILEPOS_T)
       mxwarn(boost::format(Y("This should REALLY not have happened. The space reserved for the first meta seek element was too small. Size needed: %1%. %2%\n"))
@@ -1626,9 +1895,12 @@ finish_file(bool last_file) {
 
   // Set the correct size for the segment.
   int64_t final_file_size = s_out->getFilePointer();
-  if (g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
+  if (!g_live_output && g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
     g_kax_segment->OverwriteHead(*s_out);
 
+  // Closing explicitly makes sure that write errors are reported even if
+  // the data is written in the background.
+  s_out->close();
   s_out.clear();
 
   // The tracks element must not be deleted.
@@ -1639,7 +1911,7 @@ finish_file(bool last_file) {
   g_kax_segment->RemoveAll();
 
   delete g_kax_segment;
-  delete g_kax_cues;
+  delete g_cues;
   delete s_kax_sh_void;
   delete g_kax_sh_main;
   delete s_void_after_track_headers;
@@ -1888,6 +2160,38 @@ establish_deferred_connections(filelist_t &file) {
   // \todo Select a new file that the subs will defer to.
 }
 
+/** \brief Starts one read-ahead thread per input file if requested
+
+   Appending is not supported in this mode as it requires the packetizers
+   of several files to be connected to each other while reading.
+*/
+static void
+start_read_ahead_maybe() {
+  if (0 >= g_read_ahead_queue_size)
+    return;
+
+  for (auto &file : g_files)
+    if (file.appending) {
+      mxwarn(Y("Reading files in separate threads is not supported when appending files. The files will be read sequentially.\n"));
+      return;
+    }
+
+  g_read_ahead = new read_ahead_c(g_read_ahead_queue_size);
+  g_read_ahead->start();
+}
+
+static void
+stop_read_ahead() {
+  if (NULL == g_read_ahead)
+    return;
+
+  g_read_ahead->stop();
+  g_read_ahead->run_deferred_rerendering();
+
+  delete g_read_ahead;
+  g_read_ahead = NULL;
+}
+
 /** \brief Request packets and handle the next one
 
    Requests packets from each packetizer, selects the packet with the
@@ -1896,29 +2200,51 @@ establish_deferred_connections(filelist_t &file) {
 */
 void
 main_loop() {
+  // Without background threads the packetizers compress each packet
+  // themselves in add_packet().
+  if (0 < g_compression_threads)
+    g_compression_pool = new thread_pool_c(g_compression_threads);
+
+  start_read_ahead_maybe();
+
+  packet_scheduler_c scheduler(g_packetizers);
+  bool check_appending = true;
+
   // Let's go!
   while (1) {
     debug_run_main_loop_hooks();
 
     // Step 1: Make sure a packet is available for each output
-    // as long we haven't already processed the last one.
-    for (auto &ptzr : g_packetizers) {
+    // as long we haven't already processed the last one. Only those
+    // packetizers that don't have a packet yet are polled.
+    scheduler.start_pass();
+
+    size_t idx;
+    while (scheduler.next_to_poll(idx)) {
+      packetizer_t &ptzr = g_packetizers[idx];
+
       if (FILE_STATUS_HOLDING == ptzr.status)
         ptzr.status = FILE_STATUS_MOREDATA;
 
       ptzr.old_status = ptzr.status;
 
-      while (   !ptzr.pack.is_set()
-             && (FILE_STATUS_MOREDATA == ptzr.status)
-             && !ptzr.packetizer->packet_available())
-        ptzr.status = ptzr.packetizer->read();
+      if (NULL != g_read_ahead) {
+        if (!ptzr.pack.is_set())
+          g_read_ahead->fetch_packet(ptzr);
+
+      } else {
+        while (   !ptzr.pack.is_set()
+               && (FILE_STATUS_MOREDATA == ptzr.status)
+               && !ptzr.packetizer->packet_available())
+          ptzr.status = ptzr.packetizer->read();
 
-      if (   (FILE_STATUS_MOREDATA != ptzr.status)
-          && (FILE_STATUS_MOREDATA == ptzr.old_status))
-        ptzr.packetizer->force_duration_on_last_packet();
+        if (   (FILE_STATUS_MOREDATA != ptzr.status)
+            && (FILE_STATUS_MOREDATA == ptzr.old_status))
+          ptzr.packetizer->force_duration_on_last_packet();
 
-      if (!ptzr.pack.is_set())
-        ptzr.pack = ptzr.packetizer->get_packet();
+        if (!ptzr.pack.is_set())
+          ptzr.pack = ptzr.packetizer->get_packet();
+      }
 
       if (!ptzr.pack.is_set() && (FILE_STATUS_DONE == ptzr.status))
         ptzr.status = FILE_STATUS_DONE_AND_DRY;
@@ -1930,41 +2256,57 @@ main_loop() {
           && (ptzr.old_status != ptzr.status)) {
         filelist_t &file = g_files[ptzr.file];
         file.num_unfinished_packetizers--;
+        check_appending = true;
 
         // If all packetizers for a file have finished then establish the
         // deferred connections.
         if ((0 >= file.num_unfinished_packetizers) && (0 < file.old_num_unfinished_packetizers)) {
           establish_deferred_connections(file);
           file.done = true;
+          scheduler.invalidate();
         }
         file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
       }
+
+      scheduler.polled(idx);
     }
 
+    if (NULL != g_read_ahead)
+      g_read_ahead->run_deferred_rerendering();
+
+    // The rest of this iteration reads and modifies packetizer state
+    // and releases packets and their buffers. The reference counts of
+    // those are shared with the workers' readers and are not thread-safe.
+    readers_paused_c pause;
+
     // Step 2: Pick the packet with the lowest timecode and
     // stuff it into the Matroska file.
-    packetizer_t * winner = NULL;
-    for (auto &ptzr : g_packetizers) {
-      if (ptzr.pack.is_set()) {
-        if ((NULL == winner) || !winner->pack.is_set())
-          winner = &ptzr;
-
-        else if (ptzr.pack.is_set() && (ptzr.pack->assigned_timecode < winner->pack->assigned_timecode))
-          winner = &ptzr;
-      }
-    }
+    packetizer_t *winner = scheduler.get_winner();
 
-    // Append the next track if appending is wanted.
-    bool appended_a_track = append_tracks_maybe();
+    // Append the next track if appending is wanted. Only packetizers
+    // that have just finished can be appended to.
+    bool appended_a_track = false;
+    if (check_appending) {
+      appended_a_track = append_tracks_maybe();
+      check_appending  = false;
+
+      if (appended_a_track)
+        scheduler.invalidate();
+    }
 
-    if ((NULL != winner) && winner->pack.is_set()) {
+    if (NULL != winner) {
       packet_cptr pack = winner->pack;
 
       // Step 3: Add the winning packet to a cluster. Full clusters will be
-      // rendered automatically.
+      // rendered automatically. Its data may still be compressed in the
+      // background.
+      pack->source->finish_compression(pack);
+      for (auto &output : g_additional_outputs)
+        output->add_packet(pack);
       g_cluster_helper->add_packet(pack);
 
       winner->pack = packet_cptr(NULL);
+      scheduler.winner_handled();
 
       // display some progress information
       if (1 <= verbose)
@@ -1974,12 +2316,19 @@ main_loop() {
       break;
   }
 
+  stop_read_ahead();
+
+  delete g_compression_pool;
+  g_compression_pool = NULL;
+
   // Render all remaining packets (if there are any).
   if ((NULL != g_cluster_helper) && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
 
   if (1 <= verbose)
     mxinfo(boost::format(Y("Progress: 100%%%1%")) % "\r");
+
+  scheduler.dump_statistics();
 }
 
 /** \brief Deletes the file readers and other associated objects
@@ -2004,6 +2353,8 @@ cleanup() {
   delete g_cluster_helper;
   g_cluster_helper = NULL;
 
+  g_additional_outputs.clear();
+
   destroy_readers();
   g_attachments.clear();
 
@@ -27,7 +27,6 @@
 
 namespace libmatroska {
   class KaxChapters;
-  class KaxCues;
   class KaxSeekHead;
   class KaxSegment;
   class KaxTag;
@@ -40,6 +39,7 @@ namespace libmatroska {
 
 using namespace libmatroska;
 
+class cues_c;
 class mm_io_c;
 class generic_packetizer_c;
 class generic_reader_c;
@@ -186,7 +186,7 @@ extern KaxTags *g_tags_from_cue_chapters;
 extern KaxSegment *g_kax_segment;
 extern KaxTracks *g_kax_tracks;
 extern KaxTrackEntry *g_kax_last_entry;
-extern KaxCues *g_kax_cues;
+extern cues_c *g_cues;
 extern KaxSeekHead *g_kax_sh_main, *g_kax_sh_cues;
 extern KaxChapters *g_kax_chapters;
 extern int64_t g_tags_size;
@@ -200,6 +200,15 @@ extern generic_packetizer_c *g_video_packetizer;
 extern bool g_write_cues, g_cue_writing_requested;
 extern bool g_no_lacing, g_no_linking, g_use_durations;
 
+extern int g_async_output_blocks;
+extern int64_t g_async_output_block_size;
+extern bool g_direct_output;
+extern int64_t g_qtmp4_read_buffer_size;
+extern bool g_live_output;
+
+extern int g_compression_threads;
+extern thread_pool_c *g_compression_pool;
+
 extern bool g_identifying, g_identify_verbose, g_identify_for_mmg;
 
 extern int g_file_num;
@@ -227,6 +236,7 @@ void add_tags(KaxTag *tags);
 void create_next_output_file();
 int64_t finish_file(bool last_file = false);
 void rerender_track_headers();
+void write_live_headers();
 void rerender_ebml_head();
 std::string create_output_name();
 
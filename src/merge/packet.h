@@ -30,6 +30,7 @@ namespace libmatroska {
 using namespace libmatroska;
 
 class generic_packetizer_c;
+class packet_compression_task_c;
 
 class packet_extension_c {
 public:
@@ -63,11 +64,19 @@ struct packet_t {
   int64_t timecode, bref, fref, duration, packet_num, assigned_timecode;
   int64_t timecode_before_factory;
   int64_t unmodified_assigned_timecode, unmodified_duration;
+  // The number of bytes the packet is counted with in its packetizer's
+  // queue: the size of its data before compression.
+  int64_t queued_size;
   bool duration_mandatory, superseeded, gap_following, factory_applied;
   generic_packetizer_c *source;
 
   std::vector<packet_extension_cptr> extensions;
 
+  // Set while the data is being compressed in a background thread. It is
+  // declared last so that it is waited for before the buffers it reads
+  // from are released.
+  counted_ptr<packet_compression_task_c> compression_task;
+
   packet_t()
     : group(NULL)
     , block(NULL)
@@ -83,6 +92,7 @@ struct packet_t {
     , timecode_before_factory(0)
     , unmodified_assigned_timecode(0)
     , unmodified_duration(0)
+    , queued_size(0)
     , duration_mandatory(false)
     , superseeded(false)
     , gap_following(false)
@@ -111,6 +121,7 @@ struct packet_t {
     , timecode_before_factory(0)
     , unmodified_assigned_timecode(0)
     , unmodified_duration(0)
+    , queued_size(0)
     , duration_mandatory(false)
     , superseeded(false)
     , gap_following(false)
@@ -139,6 +150,7 @@ struct packet_t {
     , timecode_before_factory(0)
     , unmodified_assigned_timecode(0)
     , unmodified_duration(0)
+    , queued_size(0)
     , duration_mandatory(false)
     , superseeded(false)
     , gap_following(false)
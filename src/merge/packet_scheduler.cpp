@@ -0,0 +1,121 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the scheduler deciding which packet to mux next
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/fs_sys_helpers.h"
+#include "merge/output_control.h"
+#include "merge/packet_scheduler.h"
+
+packet_scheduler_c::packet_scheduler_c(std::vector<packetizer_t> &packetizers)
+  : m_packetizers(packetizers)
+  , m_queued(packetizers.size(), false)
+  , m_last_polled(0)
+  , m_poll_all_next(true)
+  , m_debug(debugging_requested("packet_scheduler"))
+  , m_start_time(get_current_time_millis())
+  , m_num_packets(0)
+  , m_num_polls(0)
+{
+}
+
+/** \brief Determines the packetizers to poll in the next iteration
+
+   Those are the ones that didn't have a packet and weren't done at the end
+   of the previous iteration plus the previous winner.
+*/
+void
+packet_scheduler_c::start_pass() {
+  if (m_poll_all_next) {
+    m_to_poll.clear();
+    size_t idx;
+    for (idx = 0; m_packetizers.size() > idx; ++idx)
+      m_to_poll.insert(idx);
+
+  } else
+    m_to_poll.swap(m_to_poll_next);
+
+  m_to_poll_next.clear();
+  m_poll_all_next = false;
+}
+
+bool
+packet_scheduler_c::next_to_poll(size_t &idx) {
+  if (m_to_poll.empty())
+    return false;
+
+  idx           = *m_to_poll.begin();
+  m_last_polled = idx;
+  m_to_poll.erase(m_to_poll.begin());
+
+  return true;
+}
+
+void
+packet_scheduler_c::polled(size_t idx) {
+  packetizer_t &ptzr = m_packetizers[idx];
+
+  ++m_num_polls;
+
+  if (ptzr.pack.is_set()) {
+    if (!m_queued[idx]) {
+      m_packets.push(entry_t(ptzr.pack->assigned_timecode, idx));
+      m_queued[idx] = true;
+    }
+
+  } else if (FILE_STATUS_DONE_AND_DRY != ptzr.status)
+    m_to_poll_next.insert(idx);
+}
+
+packetizer_t *
+packet_scheduler_c::get_winner() {
+  return m_packets.empty() ? NULL : &m_packetizers[m_packets.top().m_idx];
+}
+
+void
+packet_scheduler_c::winner_handled() {
+  size_t idx = m_packets.top().m_idx;
+
+  m_packets.pop();
+  m_queued[idx] = false;
+  m_to_poll_next.insert(idx);
+
+  ++m_num_packets;
+}
+
+/** \brief Makes sure that all packetizers are polled again
+
+   Appending tracks modifies packetizers that the scheduler considers to
+   be done or that it doesn't expect to change otherwise. If this happens
+   in the middle of an iteration then the remaining packetizers are
+   polled in the current iteration as well.
+*/
+void
+packet_scheduler_c::invalidate() {
+  m_poll_all_next = true;
+
+  size_t idx;
+  for (idx = m_last_polled + 1; m_packetizers.size() > idx; ++idx)
+    m_to_poll.insert(idx);
+}
+
+void
+packet_scheduler_c::dump_statistics() const {
+  if (!m_debug)
+    return;
+
+  int64_t duration = std::max<int64_t>(get_current_time_millis() - m_start_time, 1);
+
+  mxinfo(boost::format("packet_scheduler: %1% packetizers, %2% packets, %3% polls, %4% ms, %5% packets/s\n")
+         % m_packetizers.size() % m_num_packets % m_num_polls % duration % (m_num_packets * 1000 / duration));
+}
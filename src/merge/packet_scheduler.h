@@ -0,0 +1,81 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for the scheduler deciding which packet to mux next
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_MERGE_PACKET_SCHEDULER_H
+#define __MTX_MERGE_PACKET_SCHEDULER_H
+
+#include "common/common_pch.h"
+
+#include <queue>
+#include <set>
+
+struct packetizer_t;
+
+/* Keeps track of which packetizers main_loop() has to ask for packets and
+   which of the packets already retrieved has the lowest timecode.
+
+   A packetizer only has to be polled if it does not hold a packet and if
+   it is not done yet. Packetizers holding a packet are kept in a heap
+   ordered by the packet's timecode and by the packetizer's position in
+   g_packetizers. Both are updated incrementally, so the work per muxed
+   packet does not depend on the number of tracks anymore.
+
+   The packetizers are polled in the same order and the same packet is
+   chosen as if all of them were examined in each iteration. Appending
+   changes the state of packetizers behind the scheduler's back; after
+   invalidate() has been called all of them are polled again.
+*/
+class packet_scheduler_c {
+protected:
+  struct entry_t {
+    int64_t m_timecode;
+    size_t m_idx;
+
+    entry_t(int64_t timecode, size_t idx)
+      : m_timecode(timecode)
+      , m_idx(idx)
+    {
+    }
+
+    // std::priority_queue puts the largest element on top.
+    bool operator <(const entry_t &cmp) const {
+      return (m_timecode > cmp.m_timecode) || ((m_timecode == cmp.m_timecode) && (m_idx > cmp.m_idx));
+    }
+  };
+
+  std::vector<packetizer_t> &m_packetizers;
+  std::priority_queue<entry_t> m_packets;
+  std::vector<bool> m_queued;
+  std::set<size_t> m_to_poll, m_to_poll_next;
+  size_t m_last_polled;
+  bool m_poll_all_next;
+
+  bool m_debug;
+  int64_t m_start_time, m_num_packets, m_num_polls;
+
+public:
+  packet_scheduler_c(std::vector<packetizer_t> &packetizers);
+
+  void start_pass();
+  bool next_to_poll(size_t &idx);
+  void polled(size_t idx);
+
+  packetizer_t *get_winner();
+  void winner_handled();
+
+  void invalidate();
+
+  void dump_statistics() const;
+};
+
+#endif // __MTX_MERGE_PACKET_SCHEDULER_H
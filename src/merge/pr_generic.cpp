@@ -52,6 +52,49 @@
 int64_t packet_t::sm_packet_number_counter = 0;
 
 packet_t::~packet_t() {
+  if (!compression_task.is_set())
+    return;
+
+  try {
+    compression_task->wait();
+  } catch (...) {
+  }
+}
+
+// ---------------------------------------------------------------------
+
+/** \brief Takes over the packet's buffers for compression
+
+   The task works on its own references to the packet's buffers so that
+   the packet's reference counters are never touched from another thread.
+*/
+packet_compression_task_c::packet_compression_task_c(compressor_c &compressor,
+                                                     packet_t &packet)
+  : m_compressor(compressor)
+{
+  m_buffers.push_back(memory_cptr(new memory_c(packet.data->get_buffer(), packet.data->get_size(), false)));
+  for (auto &data_add : packet.data_adds)
+    m_buffers.push_back(memory_cptr(new memory_c(data_add->get_buffer(), data_add->get_size(), false)));
+}
+
+void
+packet_compression_task_c::run() {
+  for (auto &buffer : m_buffers)
+    m_compressor.compress(buffer);
+}
+
+/** \brief Waits for the compression and replaces the packet's buffers
+
+   Exceptions thrown during the compression are rethrown.
+*/
+void
+packet_compression_task_c::finish(packet_t &packet) {
+  wait();
+
+  packet.data = m_buffers[0];
+  size_t i;
+  for (i = 0; packet.data_adds.size() > i; ++i)
+    packet.data_adds[i] = m_buffers[i + 1];
 }
 
 // ---------------------------------------------------------------------
@@ -90,7 +133,6 @@ generic_packetizer_c::generic_packetizer_c(generic_reader_c *reader,
   , m_hvideo_display_height(-1)
   , m_hcompression(COMPRESSION_UNSPECIFIED)
   , m_timecode_factory_application_mode(TFA_AUTOMATIC)
-  , m_last_cue_timecode(-1)
   , m_has_been_flushed(false)
   , m_ti(ti)
   , m_reader(reader)
@@ -767,7 +809,17 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
       && (pack->data_adds.size()  > static_cast<size_t>(m_htrack_max_add_block_ids)))
     pack->data_adds.resize(m_htrack_max_add_block_ids);
 
-  if (m_compressor.is_set()) {
+  // Compressors that can be used from several threads compress the
+  // packet in the background. main_loop() waits for the result before
+  // the packet is handed over to the cluster helper.
+  bool compress_in_background = m_compressor.is_set() && (NULL != g_compression_pool) && m_compressor->can_compress_in_parallel();
+
+  // The queue is accounted for with the uncompressed size in both
+  // cases. Readers base their decisions on get_queued_bytes(), so it
+  // must not depend on how far the background compression has come.
+  pack->queued_size = pack->data->get_size();
+
+  if (m_compressor.is_set() && !compress_in_background) {
     try {
       m_compressor->compress(pack->data);
       size_t i;
@@ -783,9 +835,14 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
   for (auto &data_add : pack->data_adds)
     data_add->grab();
 
+  if (compress_in_background) {
+    pack->compression_task = packet_compression_task_cptr(new packet_compression_task_c(*m_compressor, *pack));
+    g_compression_pool->add(*pack->compression_task);
+  }
+
   pack->source = this;
 
-  m_enqueued_bytes += pack->data->get_size();
+  m_enqueued_bytes += pack->queued_size;
 
   if ((0 > pack->bref) && (0 <= pack->fref)) {
     int64_t tmp = pack->bref;
@@ -879,7 +936,7 @@ generic_packetizer_c::get_packet() {
   packet_cptr pack = m_packet_queue.front();
   m_packet_queue.pop_front();
 
-  m_enqueued_bytes -= pack->data->get_size();
+  m_enqueued_bytes -= pack->queued_size;
 
   --m_next_packet_wo_assigned_timecode;
   if (0 > m_next_packet_wo_assigned_timecode)
@@ -888,6 +945,33 @@ generic_packetizer_c::get_packet() {
   return pack;
 }
 
+void
+generic_packetizer_c::finish_compression(packet_cptr &packet) {
+  if (!packet->compression_task.is_set())
+    return;
+
+  try {
+    packet->compression_task->finish(*packet);
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
+
+  packet->compression_task.clear();
+}
+
+/** \brief Returns the number of bytes queued in this packetizer
+
+   Readers use this for limiting how much they read ahead of other
+   files. Packets are counted with their size before compression whether
+   or not they are compressed in the background. The result is therefore
+   the same with and without compression threads.
+*/
+int64_t
+generic_packetizer_c::get_queued_bytes() {
+  return m_enqueued_bytes;
+}
+
 void
 generic_packetizer_c::apply_factory_once(packet_cptr &packet) {
   if (!m_timecode_factory.is_set()) {
@@ -1065,7 +1149,7 @@ generic_packetizer_c::connect(generic_packetizer_c *src,
   m_huid                       = src->m_huid;
   m_hcompression               = src->m_hcompression;
   m_compressor                 = compressor_c::create(m_hcompression);
-  m_last_cue_timecode          = src->m_last_cue_timecode;
+  m_last_cue_timecodes         = src->m_last_cue_timecodes;
   m_timecode_factory           = src->m_timecode_factory;
   m_correction_timecode_offset = 0;
 
@@ -1202,6 +1286,21 @@ generic_reader_c::attachment_requested(int64_t id) {
   return ATTACH_MODE_SKIP;
 }
 
+/** \brief Continue reading at a timecode instead of the start of the file
+
+   Called once after the packetizers have been created and before the
+   first call to read(). Readers supporting this use their container's
+   index for finding the position of the key frame at or before \a
+   timecode so that the data in front of it doesn't have to be read.
+
+   \return \c false if the reader does not support seeking or if the
+     file does not contain a usable index.
+*/
+bool
+generic_reader_c::seek_to_timecode(int64_t /* timecode */) {
+  return false;
+}
+
 int
 generic_reader_c::add_packetizer(generic_packetizer_c *ptzr) {
   if (outputting_webm() && !ptzr->is_compatible_with(OC_WEBM))
@@ -1315,16 +1414,16 @@ generic_reader_c::flush_packetizers() {
 
 void
 generic_reader_c::id_result_container(const std::string &verbose_info) {
-  m_id_results_container.info = get_format_name();
-  m_id_results_container.verbose_info.clear();
+  m_id_results.container.info = get_format_name();
+  m_id_results.container.verbose_info.clear();
   if (!verbose_info.empty())
-    m_id_results_container.verbose_info.push_back(verbose_info);
+    m_id_results.container.verbose_info.push_back(verbose_info);
 }
 
 void
 generic_reader_c::id_result_container(const std::vector<std::string> &verbose_info) {
-  m_id_results_container.info         = get_format_name();
-  m_id_results_container.verbose_info = verbose_info;
+  m_id_results.container.info         = get_format_name();
+  m_id_results.container.verbose_info = verbose_info;
 }
 
 void
@@ -1335,7 +1434,7 @@ generic_reader_c::id_result_track(int64_t track_id,
   id_result_t result(track_id, type, info, empty_string, 0);
   if (!verbose_info.empty())
     result.verbose_info.push_back(verbose_info);
-  m_id_results_tracks.push_back(result);
+  m_id_results.tracks.push_back(result);
 }
 
 void
@@ -1345,7 +1444,7 @@ generic_reader_c::id_result_track(int64_t track_id,
                                   const std::vector<std::string> &verbose_info) {
   id_result_t result(track_id, type, info, empty_string, 0);
   result.verbose_info = verbose_info;
-  m_id_results_tracks.push_back(result);
+  m_id_results.tracks.push_back(result);
 }
 
 void
@@ -1355,24 +1454,35 @@ generic_reader_c::id_result_attachment(int64_t attachment_id,
                                        const std::string &file_name,
                                        const std::string &description) {
   id_result_t result(attachment_id, type, file_name, description, size);
-  m_id_results_attachments.push_back(result);
+  m_id_results.attachments.push_back(result);
 }
 
 void
 generic_reader_c::id_result_chapters(int num_entries) {
   id_result_t result(0, ID_RESULT_CHAPTERS, empty_string, empty_string, num_entries);
-  m_id_results_chapters.push_back(result);
+  m_id_results.chapters.push_back(result);
 }
 
 void
 generic_reader_c::id_result_tags(int64_t track_id,
                                  int num_entries) {
   id_result_t result(track_id, ID_RESULT_TAGS, empty_string, empty_string, num_entries);
-  m_id_results_tags.push_back(result);
+  m_id_results.tags.push_back(result);
 }
 
 void
 generic_reader_c::display_identification_results() {
+  ::display_identification_results(m_ti.m_fname, m_id_results);
+}
+
+static std::string
+id_escape_string(const std::string &s) {
+  return g_identify_for_mmg ? escape(s) : s;
+}
+
+void
+display_identification_results(const std::string &file_name,
+                               const identification_results_t &results) {
   std::string format_file, format_track, format_attachment, format_att_description, format_att_file_name, format_chapters, format_tags_global, format_tags_track;
 
   if (g_identify_for_mmg) {
@@ -1396,14 +1506,14 @@ generic_reader_c::display_identification_results() {
     format_tags_track      = Y("Tags for track ID %1%: %2% entries");
   }
 
-  mxinfo(boost::format(format_file) % m_ti.m_fname % m_id_results_container.info);
+  mxinfo(boost::format(format_file) % file_name % results.container.info);
 
-  if (g_identify_verbose && !m_id_results_container.verbose_info.empty())
-    mxinfo(boost::format(" [%1%]") % join(" ", m_id_results_container.verbose_info));
+  if (g_identify_verbose && !results.container.verbose_info.empty())
+    mxinfo(boost::format(" [%1%]") % join(" ", results.container.verbose_info));
 
   mxinfo("\n");
 
-  for (auto &result : m_id_results_tracks) {
+  for (auto &result : results.tracks) {
     mxinfo(boost::format(format_track) % result.id % result.type % result.info);
 
     if (g_identify_verbose && !result.verbose_info.empty())
@@ -1412,7 +1522,7 @@ generic_reader_c::display_identification_results() {
     mxinfo("\n");
   }
 
-  for (auto &result : m_id_results_attachments) {
+  for (auto &result : results.attachments) {
     mxinfo(boost::format(format_attachment) % result.id % id_escape_string(result.type) % result.size);
 
     if (!result.description.empty())
@@ -1424,12 +1534,12 @@ generic_reader_c::display_identification_results() {
     mxinfo("\n");
   }
 
-  for (auto &result : m_id_results_chapters) {
+  for (auto &result : results.chapters) {
     mxinfo(boost::format(format_chapters) % result.size);
     mxinfo("\n");
   }
 
-  for (auto &result : m_id_results_tags) {
+  for (auto &result : results.tags) {
     if (ID_RESULT_GLOBAL_TAGS_ID == result.id)
       mxinfo(boost::format(format_tags_global) % result.size);
     else
@@ -1441,7 +1551,7 @@ generic_reader_c::display_identification_results() {
 
 std::string
 generic_reader_c::id_escape_string(const std::string &s) {
-  return g_identify_for_mmg ? escape(s) : s;
+  return ::id_escape_string(s);
 }
 
 void
@@ -1466,6 +1576,7 @@ track_info_c::track_info_c()
   : m_initialized(true)
   , m_id(0)
   , m_disable_multi_file(false)
+  , m_start_at(0)
   , m_private_data(NULL)
   , m_private_size(0)
   , m_aspect_ratio(0.0)
@@ -1520,6 +1631,7 @@ track_info_c::operator =(const track_info_c &src) {
   m_vtracks                    = src.m_vtracks;
   m_track_tags                 = src.m_track_tags;
   m_disable_multi_file         = src.m_disable_multi_file;
+  m_start_at                   = src.m_start_at;
 
   m_private_size               = src.m_private_size;
   m_private_data               = (unsigned char *)safememdup(src.m_private_data, m_private_size);
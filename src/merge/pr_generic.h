@@ -34,6 +34,7 @@
 #include "common/smart_pointers.h"
 #include "common/stereo_mode.h"
 #include "common/strings/editing.h"
+#include "common/thread_pool.h"
 #include "merge/item_selector.h"
 #include "merge/packet.h"
 #include "merge/timecode_factory.h"
@@ -146,11 +147,48 @@ struct id_result_t {
     , size(src.size)
   {
   }
+
+  id_result_t &operator =(const id_result_t &src) {
+    id           = src.id;
+    type         = src.type;
+    info         = src.info;
+    description  = src.description;
+    verbose_info = src.verbose_info;
+    size         = src.size;
+
+    return *this;
+  }
+};
+
+/* Everything a reader reports about a file when identifying it. */
+struct identification_results_t {
+  id_result_t container;
+  std::vector<id_result_t> tracks, attachments, chapters, tags;
 };
 
+class cluster_helper_c;
 class generic_packetizer_c;
 class generic_reader_c;
 
+/* Compresses a packet's frame and its block additions in one of the
+   compression pool's threads. The packet keeps its uncompressed data
+   until finish() is called from the muxing thread.
+*/
+class packet_compression_task_c: public thread_pool_task_c {
+protected:
+  compressor_c &m_compressor;
+  std::vector<memory_cptr> m_buffers;
+
+public:
+  packet_compression_task_c(compressor_c &compressor, packet_t &packet);
+
+  void finish(packet_t &packet);
+
+protected:
+  virtual void run();
+};
+typedef counted_ptr<packet_compression_task_c> packet_compression_task_cptr;
+
 enum file_status_e {
   FILE_STATUS_DONE         = 0,
   FILE_STATUS_DONE_AND_DRY,
@@ -232,6 +270,7 @@ public:
   std::string m_fname;
   item_selector_c<bool> m_atracks, m_vtracks, m_stracks, m_btracks, m_track_tags;
   bool m_disable_multi_file;
+  int64_t m_start_at;
 
   // Options used by the packetizers.
   unsigned char *m_private_data;
@@ -353,8 +392,7 @@ public:
   int64_t m_reference_timecode_tolerance;
 
 private:
-  id_result_t m_id_results_container;
-  std::vector<id_result_t> m_id_results_tracks, m_id_results_attachments, m_id_results_chapters, m_id_results_tags;
+  identification_results_t m_id_results;
 
 public:
   generic_reader_c(const track_info_c &ti, const mm_io_cptr &in);
@@ -374,6 +412,8 @@ public:
     create_packetizer(0);
   }
 
+  virtual bool seek_to_timecode(int64_t timecode);
+
   virtual int add_packetizer(generic_packetizer_c *ptzr);
   virtual size_t get_num_packetizers() const;
   virtual void set_timecode_offset(int64_t offset);
@@ -395,6 +435,9 @@ public:
   virtual attach_mode_e attachment_requested(int64_t id);
 
   virtual void display_identification_results();
+  virtual const identification_results_t &get_identification_results() const {
+    return m_id_results;
+  }
 
 protected:
   virtual bool demuxing_requested(char type, int64_t id);
@@ -412,6 +455,7 @@ protected:
 };
 
 void id_result_container_unsupported(const std::string &filename, const std::string &info);
+void display_identification_results(const std::string &file_name, const identification_results_t &results);
 
 enum connection_result_e {
   CAN_CONNECT_YES,
@@ -498,7 +542,9 @@ protected:
   timecode_factory_cptr m_timecode_factory;
   timecode_factory_application_e m_timecode_factory_application_mode;
 
-  int64_t m_last_cue_timecode;
+  // The timecode of the last cue entry for each output file's cluster
+  // helper.
+  std::map<cluster_helper_c *, int64_t> m_last_cue_timecodes;
 
   bool m_has_been_flushed;
 
@@ -528,6 +574,7 @@ public:
   virtual void process_deferred_packets();
 
   virtual packet_cptr get_packet();
+  virtual void finish_compression(packet_cptr &packet);
   inline bool packet_available() {
     return !m_packet_queue.empty() && m_packet_queue.front()->factory_applied;
   }
@@ -535,8 +582,9 @@ public:
   virtual int64_t get_smallest_timecode() {
     return m_packet_queue.empty() ? 0x0FFFFFFF : m_packet_queue.front()->timecode;
   }
-  inline int64_t get_queued_bytes() {
-    return m_enqueued_bytes;
+  virtual int64_t get_queued_bytes();
+  inline size_t get_queued_packets() {
+    return m_packet_queue.size();
   }
 
   inline void set_free_refs(int64_t free_refs) {
@@ -559,11 +607,12 @@ public:
   virtual cue_strategy_e get_cue_creation() {
     return m_ti.m_cues;
   }
-  virtual int64_t get_last_cue_timecode() {
-    return m_last_cue_timecode;
+  virtual int64_t get_last_cue_timecode(cluster_helper_c *cluster_helper) {
+    auto timecode = m_last_cue_timecodes.find(cluster_helper);
+    return m_last_cue_timecodes.end() == timecode ? -1 : timecode->second;
   }
-  virtual void set_last_cue_timecode(int64_t timecode) {
-    m_last_cue_timecode = timecode;
+  virtual void set_last_cue_timecode(cluster_helper_c *cluster_helper, int64_t timecode) {
+    m_last_cue_timecodes[cluster_helper] = timecode;
   }
 
   virtual KaxTrackEntry *get_track_entry() {
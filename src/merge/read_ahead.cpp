@@ -0,0 +1,363 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   threaded read-ahead of input files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/output_control.h"
+#include "merge/read_ahead.h"
+
+read_ahead_c *g_read_ahead     = NULL;
+int g_read_ahead_queue_size    = 0;
+
+read_ahead_worker_c::read_ahead_worker_c(generic_reader_c *reader,
+                                         size_t queue_size)
+  : m_reader(reader)
+  , m_wanted(NULL)
+  , m_queue_size(queue_size)
+  , m_next_track(0)
+  , m_stop(false)
+  , m_progress(0)
+{
+}
+
+void
+read_ahead_worker_c::add_packetizer(generic_packetizer_c *packetizer) {
+  m_tracks.push_back(track_t(packetizer));
+}
+
+void
+read_ahead_worker_c::start() {
+  m_thread = boost::thread(&read_ahead_worker_c::run, this);
+}
+
+void
+read_ahead_worker_c::stop() {
+  {
+    boost::lock_guard<boost::mutex> gate_lock(m_gate);
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_worker_cond.notify_all();
+  m_thread.join();
+}
+
+void
+read_ahead_worker_c::lock() {
+  boost::lock_guard<boost::mutex> gate_lock(m_gate);
+  m_mutex.lock();
+}
+
+void
+read_ahead_worker_c::unlock() {
+  m_mutex.unlock();
+}
+
+read_ahead_worker_c::track_t *
+read_ahead_worker_c::find_track(generic_packetizer_c *packetizer) {
+  for (auto &track : m_tracks)
+    if (track.m_packetizer == packetizer)
+      return &track;
+
+  return NULL;
+}
+
+/** \brief Decides which packetizer to call read() for next
+
+   The packetizer the main thread is waiting for always comes first
+   regardless of its queue size; it might need more than m_queue_size
+   packets before its timecode factory can assign timecodes. All other
+   packetizers are served round-robin as long as their queues aren't full.
+*/
+read_ahead_worker_c::track_t *
+read_ahead_worker_c::next_track_to_read() {
+  if ((NULL != m_wanted) && (FILE_STATUS_MOREDATA == m_wanted->m_status))
+    return m_wanted;
+
+  size_t i;
+  for (i = 0; m_tracks.size() > i; ++i) {
+    track_t &track = m_tracks[(m_next_track + i) % m_tracks.size()];
+    if (   (FILE_STATUS_MOREDATA == track.m_status)
+        && (m_queue_size         >  track.m_packetizer->get_queued_packets())) {
+      m_next_track = (m_next_track + i + 1) % m_tracks.size();
+      return &track;
+    }
+  }
+
+  return NULL;
+}
+
+void
+read_ahead_worker_c::run() {
+  // Readers use mxerror() for invalid input. Terminating the program
+  // from this thread would pull the rug out from under the main thread.
+  set_thread_mxerror_throws(true);
+
+  try {
+    while (true) {
+      boost::unique_lock<boost::mutex> gate_lock(m_gate);
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      gate_lock.unlock();
+
+      track_t *track = NULL;
+      while (!m_stop && (NULL == (track = next_track_to_read())))
+        m_worker_cond.wait(lock);
+
+      if (m_stop)
+        break;
+
+      size_t num_queued = track->m_packetizer->get_queued_packets();
+      track->m_status   = track->m_packetizer->read();
+
+      // In serial mode main_loop() forces the duration on the last packet
+      // queued when read() returns anything but FILE_STATUS_MOREDATA. The
+      // main thread only notices the status change once the queue has
+      // been drained, so packets added by this very call are handled here.
+      if (   (FILE_STATUS_MOREDATA != track->m_status)
+          && (track->m_packetizer->get_queued_packets() > num_queued))
+        track->m_packetizer->force_duration_on_last_packet();
+
+      {
+        boost::lock_guard<boost::mutex> progress_lock(m_progress_mutex);
+        m_progress = m_reader->get_progress();
+      }
+
+      m_main_cond.notify_all();
+    }
+
+  } catch (...) {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_exception = std::current_exception();
+    m_main_cond.notify_all();
+  }
+}
+
+/** \brief Passes an exception thrown by the worker on to the main thread
+
+   Errors reported with mxerror() are output and terminate the program
+   just like they do in serial mode.
+*/
+void
+read_ahead_worker_c::rethrow_worker_exception() {
+  if (!m_exception)
+    return;
+
+  try {
+    std::rethrow_exception(m_exception);
+  } catch (mtx::mxerror_x &error) {
+    mxerror(error.what());
+  }
+}
+
+/** \brief Equivalent of step 1 in main_loop() for one packetizer
+
+   Waits until the worker has either queued a packet for \a ptzr or
+   signalled that it won't deliver more packets. The status transitions are
+   the same as if \c read() had been called directly by main_loop().
+*/
+void
+read_ahead_worker_c::fetch_packet(packetizer_t &ptzr) {
+  lock();
+  boost::unique_lock<boost::mutex> lock(m_mutex, boost::adopt_lock);
+
+  generic_packetizer_c *packetizer = ptzr.packetizer;
+
+  if (FILE_STATUS_MOREDATA == ptzr.status) {
+    track_t *track      = find_track(packetizer);
+    bool read_requested = false;
+
+    while (!packetizer->packet_available()) {
+      rethrow_worker_exception();
+
+      // A reader that is holding gets exactly one more try per call, just
+      // like in serial mode.
+      if (FILE_STATUS_HOLDING == track->m_status) {
+        if (read_requested) {
+          ptzr.status = FILE_STATUS_HOLDING;
+          break;
+        }
+        track->m_status = FILE_STATUS_MOREDATA;
+
+      } else if (FILE_STATUS_MOREDATA != track->m_status) {
+        ptzr.status = track->m_status;
+        break;
+      }
+
+      read_requested = true;
+      m_wanted       = track;
+      m_worker_cond.notify_all();
+      m_main_cond.wait(lock);
+    }
+
+    m_wanted = NULL;
+
+    if (FILE_STATUS_MOREDATA != ptzr.status)
+      packetizer->force_duration_on_last_packet();
+  }
+
+  if (!ptzr.pack.is_set())
+    ptzr.pack = packetizer->get_packet();
+
+  m_worker_cond.notify_all();
+}
+
+int
+read_ahead_worker_c::get_progress() {
+  boost::lock_guard<boost::mutex> progress_lock(m_progress_mutex);
+  return m_progress;
+}
+
+// ------------------------------------------------------------
+
+read_ahead_c::read_ahead_c(size_t queue_size)
+  : m_main_thread_id(boost::this_thread::get_id())
+  , m_pause_depth(0)
+  , m_rerender_track_headers(false)
+  , m_rerender_ebml_head(false)
+{
+  m_workers.resize(g_files.size());
+
+  for (auto &ptzr : g_packetizers) {
+    read_ahead_worker_cptr &worker = m_workers[ptzr.file];
+    if (!worker.is_set())
+      worker = read_ahead_worker_cptr(new read_ahead_worker_c(g_files[ptzr.file].reader, queue_size));
+    worker->add_packetizer(ptzr.packetizer);
+  }
+}
+
+read_ahead_c::~read_ahead_c() {
+  stop();
+}
+
+void
+read_ahead_c::start() {
+  for (auto &worker : m_workers)
+    if (worker.is_set())
+      worker->start();
+}
+
+void
+read_ahead_c::stop() {
+  for (auto &worker : m_workers)
+    if (worker.is_set())
+      worker->stop();
+
+  m_workers.clear();
+}
+
+void
+read_ahead_c::fetch_packet(packetizer_t &ptzr) {
+  if (FILE_STATUS_DONE_AND_DRY != ptzr.status)
+    m_workers[ptzr.file]->fetch_packet(ptzr);
+}
+
+int
+read_ahead_c::get_progress(generic_reader_c *reader) {
+  for (size_t i = 0; m_workers.size() > i; ++i)
+    if (g_files[i].reader == reader)
+      return m_workers[i].is_set() ? m_workers[i]->get_progress() : reader->get_progress();
+
+  return reader->get_progress();
+}
+
+void
+read_ahead_c::pause() {
+  ++m_pause_depth;
+  if (1 != m_pause_depth)
+    return;
+
+  for (auto &worker : m_workers)
+    if (worker.is_set())
+      worker->lock();
+}
+
+void
+read_ahead_c::resume() {
+  --m_pause_depth;
+  if (0 != m_pause_depth)
+    return;
+
+  for (auto &worker : m_workers)
+    if (worker.is_set())
+      worker->unlock();
+}
+
+bool
+read_ahead_c::on_worker_thread() {
+  return boost::this_thread::get_id() != m_main_thread_id;
+}
+
+bool
+read_ahead_c::defer_track_headers_rerendering() {
+  if (!on_worker_thread())
+    return false;
+
+  boost::lock_guard<boost::mutex> lock(m_deferred_mutex);
+  m_rerender_track_headers = true;
+
+  return true;
+}
+
+bool
+read_ahead_c::defer_ebml_head_rerendering() {
+  if (!on_worker_thread())
+    return false;
+
+  boost::lock_guard<boost::mutex> lock(m_deferred_mutex);
+  m_rerender_ebml_head = true;
+
+  return true;
+}
+
+/** \brief Rerenders headers on behalf of the workers
+
+   Packetizers call \c rerender_track_headers() and \c rerender_ebml_head()
+   from within \c read(). The output file may only be written to from the
+   main thread, so the workers only record the request. This function is
+   called regularly by main_loop() and performs the actual rendering while
+   all workers are paused.
+*/
+void
+read_ahead_c::run_deferred_rerendering() {
+  bool track_headers, ebml_head;
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_deferred_mutex);
+    track_headers            = m_rerender_track_headers;
+    ebml_head                = m_rerender_ebml_head;
+    m_rerender_track_headers = false;
+    m_rerender_ebml_head     = false;
+  }
+
+  if (!track_headers && !ebml_head)
+    return;
+
+  readers_paused_c pause;
+
+  if (ebml_head)
+    rerender_ebml_head();
+  if (track_headers)
+    rerender_track_headers();
+}
+
+// ------------------------------------------------------------
+
+readers_paused_c::readers_paused_c() {
+  if (NULL != g_read_ahead)
+    g_read_ahead->pause();
+}
+
+readers_paused_c::~readers_paused_c() {
+  if (NULL != g_read_ahead)
+    g_read_ahead->resume();
+}
@@ -0,0 +1,137 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for the threaded read-ahead of input files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_MERGE_READ_AHEAD_H
+#define __MTX_MERGE_READ_AHEAD_H
+
+#include "common/common_pch.h"
+
+#include <exception>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "merge/pr_generic.h"
+
+struct packetizer_t;
+
+/* One worker per input file. The worker calls the reader's read() function
+   on its own thread and keeps the packet queues of all of the reader's
+   packetizers filled up to a certain number of packets.
+
+   m_mutex is held by the worker for the whole duration of each read() call.
+   The main thread must hold it as well whenever it accesses the packet
+   queues of the reader's packetizers. m_gate makes sure that the worker
+   does not starve the main thread by re-locking m_mutex immediately after
+   each read() call.
+
+   Packets handed over by fetch_packet() belong to the main thread, but
+   their buffers may still be referenced by the reader and its
+   packetizers. counted_ptr's reference counts are not thread-safe.
+   The main thread therefore pauses all workers with readers_paused_c
+   whenever it copies or releases packets or looks at other packetizer
+   state.
+*/
+class read_ahead_worker_c {
+protected:
+  struct track_t {
+    generic_packetizer_c *m_packetizer;
+    file_status_e m_status;
+
+    track_t(generic_packetizer_c *packetizer)
+      : m_packetizer(packetizer)
+      , m_status(FILE_STATUS_MOREDATA)
+    {
+    }
+  };
+
+  generic_reader_c *m_reader;
+  std::vector<track_t> m_tracks;
+  track_t *m_wanted;
+  size_t m_queue_size, m_next_track;
+  bool m_stop;
+  int m_progress;
+  std::exception_ptr m_exception;
+
+  boost::mutex m_mutex, m_gate, m_progress_mutex;
+  boost::condition_variable m_worker_cond, m_main_cond;
+  boost::thread m_thread;
+
+public:
+  read_ahead_worker_c(generic_reader_c *reader, size_t queue_size);
+
+  void add_packetizer(generic_packetizer_c *packetizer);
+  void start();
+  void stop();
+
+  void fetch_packet(packetizer_t &ptzr);
+  int get_progress();
+
+  void lock();
+  void unlock();
+
+protected:
+  void run();
+  track_t *find_track(generic_packetizer_c *packetizer);
+  track_t *next_track_to_read();
+  void rethrow_worker_exception();
+};
+typedef counted_ptr<read_ahead_worker_c> read_ahead_worker_cptr;
+
+class read_ahead_c {
+protected:
+  std::vector<read_ahead_worker_cptr> m_workers;
+  boost::thread::id m_main_thread_id;
+  int m_pause_depth;
+
+  boost::mutex m_deferred_mutex;
+  bool m_rerender_track_headers, m_rerender_ebml_head;
+
+public:
+  read_ahead_c(size_t queue_size);
+  ~read_ahead_c();
+
+  void start();
+  void stop();
+
+  void fetch_packet(packetizer_t &ptzr);
+  int get_progress(generic_reader_c *reader);
+
+  void pause();
+  void resume();
+
+  bool defer_track_headers_rerendering();
+  bool defer_ebml_head_rerendering();
+  void run_deferred_rerendering();
+
+protected:
+  bool on_worker_thread();
+};
+
+/* Blocks all read-ahead workers for the life time of the object. Used
+   around every operation of the main thread that accesses packetizer or
+   track header state which the workers might modify at the same time,
+   e.g. rendering a cluster. Can be nested.
+*/
+class readers_paused_c {
+public:
+  readers_paused_c();
+  ~readers_paused_c();
+};
+
+extern read_ahead_c *g_read_ahead;
+extern int g_read_ahead_queue_size;
+
+#endif // __MTX_MERGE_READ_AHEAD_H
@@ -25,6 +25,7 @@
 #include <wx/confbase.h>
 #include <wx/file.h>
 #include <wx/fileconf.h>
+#include <wx/filename.h>
 #include <wx/listctrl.h>
 #include <wx/notebook.h>
 #include <wx/statusbr.h>
@@ -32,6 +33,8 @@
 
 #if defined(SYS_WINDOWS)
 # include <windows.h>
+#else
+# include <sys/stat.h>
 #endif
 
 #include "common/common_pch.h"
@@ -45,15 +48,47 @@
 #define JOB_LOG_DIALOG_WIDTH 600
 #define JOB_RUN_DIALOG_WIDTH 500
 
+/** \brief Determines the volume a job's output file will be written to
+
+   On Windows this is the drive letter or the server name of an UNC
+   path. Elsewhere it is the device the output directory resides on.
+
+   \return The volume's name or an empty string if it cannot be
+     determined, e.g. because the directory does not exist yet.
+*/
+static wxString
+get_output_volume(const wxString &job_file_name) {
+  wxFileConfig cfg(wxT("mkvmerge GUI"), wxT("Moritz Bunkus"), job_file_name);
+  cfg.SetPath(wxT("/mkvmergeGUI"));
+
+  wxString output_file_name;
+  if (!cfg.Read(wxT("output_file_name"), &output_file_name) || output_file_name.IsEmpty())
+    return wxEmptyString;
+
+  wxFileName file_name(output_file_name);
+  file_name.MakeAbsolute();
+
+#if defined(SYS_WINDOWS)
+  return file_name.GetVolume().Lower();
+
+#else
+  struct stat st;
+  if (0 != stat(wxMB(file_name.GetPath()), &st))
+    return wxEmptyString;
+
+  return wxString::Format(wxT("%lu"), static_cast<unsigned long>(st.st_dev));
+#endif
+}
+
 job_run_dialog::job_run_dialog(wxWindow *,
                                std::vector<int> &n_jobs_to_start)
   : wxDialog(NULL, -1, Z("mkvmerge is running"), wxDefaultPosition, wxSize(400, 700), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER | wxMINIMIZE_BOX | wxMAXIMIZE_BOX)
   , t_update(new wxTimer(this, 1))
-  , out(NULL)
-  , process(NULL)
   , abort(false)
   , jobs_to_start(n_jobs_to_start)
-  , current_job(-1)
+  , max_running_jobs(std::max(mdlg->options.max_parallel_jobs, 1))
+  , num_started_jobs(0)
+  , num_finished_jobs(0)
   , m_progress(0)
 #if defined(SYS_WINDOWS)
   , m_taskbar_progress(NULL)
@@ -119,78 +154,112 @@ job_run_dialog::job_run_dialog(wxWindow *,
     m_taskbar_progress = new taskbar_progress_c(this);
 #endif
 
+  size_t i;
+  for (i = 0; jobs_to_start.size() > i; ++i)
+    pending_jobs.push_back(i);
+
+  if ((1 < max_running_jobs) && mdlg->options.one_job_per_output_volume)
+    for (i = 0; jobs_to_start.size() > i; ++i)
+      output_volumes.push_back(get_output_volume(wxString::Format(wxT("%s/%d.mmg"), app->get_jobs_folder().c_str(), jobs[jobs_to_start[i]].id)));
+
   m_start_time_total                 = get_current_time_millis();
   m_next_remaining_time_update_total = m_start_time_total + 8000;
 
-  start_next_job();
+  start_next_jobs();
 
   ShowModal();
 }
 
 void
-job_run_dialog::start_next_job() {
-  t_update->Stop();
-
-  ++current_job;
+job_run_dialog::start_next_jobs() {
+  while (!abort && !cb_abort_after_current->IsChecked() && (running_jobs.size() < max_running_jobs)) {
+    std::deque<size_t>::iterator next = find_startable_job();
+    if (pending_jobs.end() == next)
+      break;
 
-  if ((static_cast<int>(jobs_to_start.size()) <= current_job) || cb_abort_after_current->IsChecked() || abort) {
-    if (   abort
-        || (   cb_abort_after_current->IsChecked()
-            && (current_job < static_cast<int>(jobs_to_start.size()))))
-      add_to_log(wxString::Format(Z("Aborted processing on %s"), format_date_time(wxGetUTCTime()).c_str()));
-    else
-      add_to_log(wxString::Format(Z("Finished processing on %s"), format_date_time(wxGetUTCTime()).c_str()));
+    size_t position = *next;
+    pending_jobs.erase(next);
 
-    b_abort->Enable(false);
-    cb_abort_after_current->Enable(false);
-    b_ok->Enable(true);
-    b_ok->SetFocus();
-    SetTitle(Z("mkvmerge has finished"));
+    if (!start_job(position)) {
+      ++num_finished_jobs;
+      update_progress();
+    }
+  }
 
-    st_remaining_time->SetLabel(wxT("---"));
-    st_remaining_time_total->SetLabel(wxT("---"));
+  if (running_jobs.empty()) {
+    finish();
+    return;
+  }
 
-#if defined(SYS_WINDOWS)
-    if (NULL != m_taskbar_progress)
-      m_taskbar_progress->set_state(TBPF_NOPROGRESS);
-#endif
+  st_jobs->SetLabel(wxString::Format(Z("Processing job %d/%d"), (int)num_started_jobs, (int)jobs_to_start.size()));
 
+  if (1 == running_jobs.size()) {
+    st_current->SetLabel(wxString::Format(Z("Current job ID %d:"), jobs[jobs_to_start[running_jobs.front().position]].id));
     return;
   }
 
-  m_start_time                 = get_current_time_millis();
-  m_next_remaining_time_update = m_start_time + 8000;
-  st_remaining_time->SetLabel(Z("is being estimated"));
+  std::vector<wxString> ids;
+  for (auto &job : running_jobs)
+    ids.push_back(wxString::Format(wxT("%d"), jobs[jobs_to_start[job.position]].id));
 
-#if defined(SYS_WINDOWS)
-  if (NULL != m_taskbar_progress) {
-    m_taskbar_progress->set_state(TBPF_NORMAL);
-    m_taskbar_progress->set_value(current_job * 100, jobs_to_start.size() * 100);
+  st_current->SetLabel(wxString::Format(Z("Current job IDs %s:"), join(wxT(", "), ids).c_str()));
+}
+
+/** \brief Returns the first pending job that may be started right now
+
+   If only one job may write to each output volume then jobs whose output
+   volume is busy are skipped.
+*/
+std::deque<size_t>::iterator
+job_run_dialog::find_startable_job() {
+  if (output_volumes.empty())
+    return pending_jobs.begin();
+
+  std::deque<size_t>::iterator candidate;
+  for (candidate = pending_jobs.begin(); pending_jobs.end() != candidate; ++candidate) {
+    const wxString &volume = output_volumes[*candidate];
+    if (volume.IsEmpty())
+      return candidate;
+
+    bool volume_busy = false;
+    for (auto &job : running_jobs)
+      if (output_volumes[job.position] == volume) {
+        volume_busy = true;
+        break;
+      }
+
+    if (!volume_busy)
+      return candidate;
   }
-#endif
 
-  int ndx = jobs_to_start[current_job];
-  st_jobs->SetLabel(wxString::Format(Z("Processing job %d/%d"), current_job + 1, (int)jobs_to_start.size()));
-  st_current->SetLabel(wxString::Format(Z("Current job ID %d:"), jobs[ndx].id));
+  return pending_jobs.end();
+}
+
+bool
+job_run_dialog::start_job(size_t position) {
+  int ndx = jobs_to_start[position];
+  ++num_started_jobs;
 
   mdlg->load(wxString::Format(wxT("%s/%d.mmg"), app->get_jobs_folder().c_str(), jobs[ndx].id), true);
 
-  opt_file_name.Printf(wxT("%smmg-mkvmerge-options-%d-%d"), get_temp_dir().c_str(), (int)wxGetProcessId(), (int)wxGetUTCTime());
+  running_job_t job;
+  job.position   = position;
+  job.process    = NULL;
+  job.out        = NULL;
+  job.pid        = 0;
+  job.progress   = 0;
+  job.start_time = get_current_time_millis();
+  job.opt_file_name.Printf(wxT("%smmg-mkvmerge-options-%d-%d-%d"), get_temp_dir().c_str(), (int)wxGetProcessId(), (int)wxGetUTCTime(), jobs[ndx].id);
 
   wxFile *opt_file;
   try {
-    opt_file = new wxFile(opt_file_name, wxFile::write);
+    opt_file = new wxFile(job.opt_file_name, wxFile::write);
   } catch (...) {
     jobs[ndx].log->Printf(Z("Could not create a temporary file for mkvmerge's command line option called '%s' (error code %d, %s)."),
-                          opt_file_name.c_str(), errno, wxUCS(strerror(errno)));
+                          job.opt_file_name.c_str(), errno, wxUCS(strerror(errno)));
     jobs[ndx].status = JOBS_FAILED;
     mdlg->save_job_queue();
-    if (NULL != process) {
-      delete process;
-      process = NULL;
-    }
-    start_next_job();
-    return;
+    return false;
   }
 
   static const unsigned char utf8_bom[3] = {0xef, 0xbb, 0xbf};
@@ -211,15 +280,19 @@ job_run_dialog::start_next_job() {
   }
   delete opt_file;
 
-  process = new wxProcess(this, 1);
-  process->Redirect();
-  wxString command_line = wxString::Format(wxT("\"%s\" \"@%s\""), (*arg_list)[0].c_str(), opt_file_name.c_str());
-  pid = wxExecute(command_line, wxEXEC_ASYNC, process);
-  if (0 == pid) {
+  job.process = new wxProcess(this, 1);
+  job.process->Redirect();
+  wxString command_line = wxString::Format(wxT("\"%s\" \"@%s\""), (*arg_list)[0].c_str(), job.opt_file_name.c_str());
+  job.pid = wxExecute(command_line, wxEXEC_ASYNC, job.process);
+  if (0 == job.pid) {
     wxLogError(wxT("Execution of '%s' failed."), command_line.c_str());
-    return;
+    delete job.process;
+    wxRemoveFile(job.opt_file_name);
+    jobs[ndx].status = JOBS_FAILED;
+    mdlg->save_job_queue();
+    return false;
   }
-  out = process->GetInputStream();
+  job.out = job.process->GetInputStream();
 
   *jobs[ndx].log        = wxEmptyString;
   jobs[ndx].started_on  = wxGetUTCTime();
@@ -227,25 +300,72 @@ job_run_dialog::start_next_job() {
 
   add_to_log(wxString::Format(Z("Starting job ID %d (%s) on %s"), jobs[ndx].id, jobs[ndx].description->c_str(), format_date_time(jobs[ndx].started_on).c_str()));
 
-  t_update->Start(100);
+  running_jobs.push_back(job);
+
+#if defined(SYS_WINDOWS)
+  if (NULL != m_taskbar_progress) {
+    m_taskbar_progress->set_state(TBPF_NORMAL);
+    m_taskbar_progress->set_value(m_progress, jobs_to_start.size() * 100);
+  }
+#endif
+
+  if (1 == running_jobs.size()) {
+    m_next_remaining_time_update = job.start_time + 8000;
+    st_remaining_time->SetLabel(Z("is being estimated"));
+    t_update->Start(100);
+  }
+
+  return true;
+}
+
+void
+job_run_dialog::finish() {
+  t_update->Stop();
+
+  if (   abort
+      || (   cb_abort_after_current->IsChecked()
+          && !pending_jobs.empty()))
+    add_to_log(wxString::Format(Z("Aborted processing on %s"), format_date_time(wxGetUTCTime()).c_str()));
+  else
+    add_to_log(wxString::Format(Z("Finished processing on %s"), format_date_time(wxGetUTCTime()).c_str()));
+
+  b_abort->Enable(false);
+  cb_abort_after_current->Enable(false);
+  b_ok->Enable(true);
+  b_ok->SetFocus();
+  SetTitle(Z("mkvmerge has finished"));
+
+  st_remaining_time->SetLabel(wxT("---"));
+  st_remaining_time_total->SetLabel(wxT("---"));
+
+#if defined(SYS_WINDOWS)
+  if (NULL != m_taskbar_progress)
+    m_taskbar_progress->set_state(TBPF_NOPROGRESS);
+#endif
 }
 
 void
 job_run_dialog::process_input() {
-  if (NULL == process)
+  for (auto &job : running_jobs)
+    process_input(job);
+}
+
+void
+job_run_dialog::process_input(running_job_t &job) {
+  if (NULL == job.process)
     return;
 
-  while (process->IsInputAvailable()) {
+  while (job.process->IsInputAvailable()) {
     bool got_char = false;
     char c        = 0;
 
-    if (!out->Eof()) {
-      c = out->GetC();
+    if (!job.out->Eof()) {
+      c = job.out->GetC();
       got_char = true;
     }
 
-    if (got_char && ((c == '\n') || (c == '\r') || out->Eof())) {
-      wxString wx_line = wxU(line);
+    if (got_char && ((c == '\n') || (c == '\r') || job.out->Eof())) {
+      wxString wx_line = wxU(job.line);
       if (wx_line.Find(Z("Progress")) == 0) {
         int percent_pos = wx_line.Find(wxT("%"));
         if (0 < percent_pos) {
@@ -254,31 +374,42 @@ job_run_dialog::process_input() {
 
           long value;
           tmp.ToLong(&value);
-          if ((value >= 0) && (value <= 100))
-            set_progress_value(value);
+          if ((value >= 0) && (value <= 100)) {
+            job.progress = value;
+            update_progress();
+          }
         }
       } else if (wx_line.Length() > 0)
-        *jobs[jobs_to_start[current_job]].log += wx_line + wxT("\n");
-      line = "";
+        *jobs[jobs_to_start[job.position]].log += wx_line + wxT("\n");
+      job.line = "";
     } else if ((unsigned char)c != 0xff)
-      line += c;
+      job.line += c;
 
     update_remaining_time();
 
-    if (out->Eof())
+    if (job.out->Eof())
       break;
   }
 }
 
+/** \brief Shows the progress of the running jobs and of the whole queue
+
+   The gauge for the current job shows the average progress of all
+   running jobs.
+*/
 void
-job_run_dialog::set_progress_value(long value) {
-  m_progress = current_job * 100 + value;
-  g_progress->SetValue(value);
+job_run_dialog::update_progress() {
+  int running_progress = 0;
+  for (auto &job : running_jobs)
+    running_progress += job.progress;
+
+  m_progress = num_finished_jobs * 100 + running_progress;
+  g_progress->SetValue(running_jobs.empty() ? 0 : running_progress / running_jobs.size());
   g_jobs->SetValue(m_progress);
 
 #if defined(SYS_WINDOWS)
   if (NULL != m_taskbar_progress)
-    m_taskbar_progress->set_value(current_job * 100 + value, jobs_to_start.size() * 100);
+    m_taskbar_progress->set_value(m_progress, jobs_to_start.size() * 100);
 #endif
 }
 
@@ -289,14 +420,23 @@ job_run_dialog::update_remaining_time() {
 
   int64_t now = get_current_time_millis();
 
-  if ((0 != (m_progress % 100)) && (now >= m_next_remaining_time_update)) {
-    int64_t total_time           = (now - m_start_time) * 100 / (m_progress % 100);
-    int64_t remaining_time       = total_time - now + m_start_time;
-    m_next_remaining_time_update = now + 1000;
-
-    st_remaining_time->SetLabel(wxU(create_minutes_seconds_time_string(static_cast<unsigned int>(remaining_time / 1000))));
+  // The running jobs are finished once the slowest of them is.
+  if (now >= m_next_remaining_time_update) {
+    int64_t remaining_time = -1;
+    for (auto &job : running_jobs)
+      if ((0 < job.progress) && (100 > job.progress)) {
+        int64_t total_time = (now - job.start_time) * 100 / job.progress;
+        remaining_time     = std::max(remaining_time, total_time - now + job.start_time);
+      }
+
+    if (0 <= remaining_time) {
+      m_next_remaining_time_update = now + 1000;
+      st_remaining_time->SetLabel(wxU(create_minutes_seconds_time_string(static_cast<unsigned int>(remaining_time / 1000))));
+    }
   }
 
+  // The queue's progress is the sum of all jobs' progress. Running
+  // several jobs at once therefore shortens the estimate automatically.
   if (now >= m_next_remaining_time_update_total) {
     int64_t total_percentage = m_progress / jobs_to_start.size();
     if (0 != total_percentage) {
@@ -322,20 +462,32 @@ job_run_dialog::on_idle(wxIdleEvent &) {
 void
 job_run_dialog::on_abort(wxCommandEvent &) {
   abort = true;
+  for (auto &job : running_jobs) {
+#if defined(SYS_WINDOWS)
+    wxKill(job.pid, wxSIGKILL);
+#else
+    wxKill(job.pid, wxSIGTERM);
+#endif
+  }
+
 #if defined(SYS_WINDOWS)
-  wxKill(pid, wxSIGKILL);
   if (NULL != m_taskbar_progress)
     m_taskbar_progress->set_state(TBPF_ERROR);
-#else
-  wxKill(pid, wxSIGTERM);
 #endif
 }
 
 void
 job_run_dialog::on_end_process(wxProcessEvent &evt) {
-  process_input();
+  std::vector<running_job_t>::iterator job = running_jobs.begin();
+  while ((running_jobs.end() != job) && (job->pid != evt.GetPid()))
+    ++job;
 
-  int ndx       = jobs_to_start[current_job];
+  if (running_jobs.end() == job)
+    return;
+
+  process_input(*job);
+
+  int ndx       = jobs_to_start[job->position];
   int exit_code = evt.GetExitCode();
   wxString status;
 
@@ -358,16 +510,18 @@ job_run_dialog::on_end_process(wxProcessEvent &evt) {
   add_to_log(wxString::Format(Z("Finished job ID %d on %s: status '%s'"), jobs[ndx].id, format_date_time(jobs[ndx].finished_on).c_str(), status.c_str()));
 
   mdlg->save_job_queue();
-  delete process;
-  process = NULL;
-  out     = NULL;
+  delete job->process;
 
-  wxRemoveFile(opt_file_name);
+  wxRemoveFile(job->opt_file_name);
 
-  if (!abort)
-    g_jobs->SetValue((current_job + 1) * 100);
+  running_jobs.erase(job);
+
+  if (!abort) {
+    ++num_finished_jobs;
+    update_progress();
+  }
 
-  start_next_job();
+  start_next_jobs();
 }
 
 void
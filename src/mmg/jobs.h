@@ -14,6 +14,8 @@
 #ifndef __JOBS_H
 #define __JOBS_H
 
+#include <deque>
+
 #include <wx/dialog.h>
 #include <wx/listctrl.h>
 #include <wx/process.h>
@@ -50,6 +52,17 @@ struct job_t {
 
 extern std::vector<job_t> jobs;
 
+struct running_job_t {
+  size_t position;              // index into job_run_dialog::jobs_to_start
+  wxProcess *process;
+  wxInputStream *out;
+  std::string line;
+  long pid;
+  wxString opt_file_name;
+  int progress;
+  int64_t start_time;
+};
+
 class job_log_dialog: public wxDialog {
   DECLARE_CLASS(job_log_dialog);
   DECLARE_EVENT_TABLE();
@@ -73,17 +86,15 @@ protected:
   wxTextCtrl *tc_log;
 
   wxTimer *t_update;
-  wxInputStream *out;
-  std::string line;
-  wxProcess *process;
-  wxString opt_file_name;
   bool abort;
-  long pid;
   std::vector<int> jobs_to_start;
-  int current_job;
+  std::deque<size_t> pending_jobs;
+  std::vector<running_job_t> running_jobs;
+  std::vector<wxString> output_volumes;
+  size_t max_running_jobs, num_started_jobs, num_finished_jobs;
 
   int m_progress;
-  int64_t m_next_remaining_time_update, m_next_remaining_time_update_total, m_start_time, m_start_time_total;
+  int64_t m_next_remaining_time_update, m_next_remaining_time_update_total, m_start_time_total;
 
 #if defined(SYS_WINDOWS)
   taskbar_progress_c *m_taskbar_progress;
@@ -97,10 +108,14 @@ public:
   void on_timer(wxTimerEvent &evt);
   void on_idle(wxIdleEvent &evt);
 
-  void start_next_job();
+  void start_next_jobs();
+  bool start_job(size_t position);
+  void finish();
+  std::deque<size_t>::iterator find_startable_job();
   void process_input();
+  void process_input(running_job_t &job);
   void add_to_log(wxString text);
-  void set_progress_value(long value);
+  void update_progress();
   void update_remaining_time();
 };
 
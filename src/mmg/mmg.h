@@ -203,6 +203,8 @@ struct mmg_options_t {
   bool disable_a_v_compression;
   bool check_for_updates;
   wxString priority;
+  int max_parallel_jobs;
+  bool one_job_per_output_volume;
   wxArrayString popular_languages;
 
   mmg_options_t()
@@ -217,6 +219,8 @@ struct mmg_options_t {
     , set_delay_from_filename(false)
     , disable_a_v_compression(false)
     , check_for_updates(true)
+    , max_parallel_jobs(1)
+    , one_job_per_output_volume(false)
   {
     init_popular_languages();
   }
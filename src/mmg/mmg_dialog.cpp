@@ -1566,6 +1566,8 @@ mmg_dialog::save_preferences() {
 
   cfg->Write(wxU("mkvmerge_executable"),             options.mkvmerge);
   cfg->Write(wxU("process_priority"),                options.priority);
+  cfg->Write(wxU("max_parallel_jobs"),               options.max_parallel_jobs);
+  cfg->Write(wxU("one_job_per_output_volume"),       options.one_job_per_output_volume);
   cfg->Write(wxU("autoset_output_filename"),         options.autoset_output_filename);
   cfg->Write(wxU("output_directory_mode"),           (long)options.output_directory_mode);
   cfg->Write(wxU("output_directory"),                options.output_directory);
@@ -1602,6 +1604,8 @@ mmg_dialog::load_preferences() {
 
   cfg->Read(wxU("mkvmerge_executable"),           &options.mkvmerge, wxU("mkvmerge"));
   cfg->Read(wxU("process_priority"),              &options.priority, wxU("normal"));
+  cfg->Read(wxU("max_parallel_jobs"),             &options.max_parallel_jobs, 1);
+  cfg->Read(wxU("one_job_per_output_volume"),     &options.one_job_per_output_volume, false);
   cfg->Read(wxU("autoset_output_filename"),       &options.autoset_output_filename, true);
   cfg->Read(wxU("output_directory_mode"),         (long *)&options.output_directory_mode, ODM_FROM_FIRST_INPUT_FILE);
   cfg->Read(wxU("output_directory"),              &options.output_directory, wxU(""));
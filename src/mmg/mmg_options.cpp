@@ -56,6 +56,9 @@ mmg_options_t::validate() {
   if (   (priority != wxU("highest")) && (priority != wxU("higher")) && (priority != wxU("normal"))
       && (priority != wxU("lower"))   && (priority != wxU("lowest")))
     priority = wxU("normal");
+
+  if (1 > max_parallel_jobs)
+    max_parallel_jobs = 1;
 }
 
 wxString
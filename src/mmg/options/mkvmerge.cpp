@@ -25,6 +25,7 @@
 #include <wx/notebook.h>
 #include <wx/process.h>
 #include <wx/statline.h>
+#include <wx/thread.h>
 
 #include "common/common_pch.h"
 #include "common/strings/editing.h"
@@ -67,9 +68,26 @@ optdlg_mkvmerge_tab::optdlg_mkvmerge_tab(wxWindow *parent,
   for (i = 0; cob_priority_translations.entries.size() > i; ++i)
     cob_priority->Append(cob_priority_translations.entries[i].translated);
 
+  wxStaticText *st_max_parallel_jobs = new wxStaticText(this, -1, Z("Jobs to run at the same time:"));
+  cob_max_parallel_jobs              = new wxMTX_COMBOBOX_TYPE(this, ID_COB_MAX_PARALLEL_JOBS, wxEmptyString, wxDefaultPosition, wxDefaultSize, 0, NULL, wxCB_DROPDOWN | wxCB_READONLY);
+  cob_max_parallel_jobs->SetToolTip(TIP("Sets the number of jobs from the job queue that are run at the same time. "
+                                        "Running several jobs at once only speeds the queue up if the computer has several CPU cores "
+                                        "and if the files are not all read from and written to the same hard disk."));
+
+  int max_parallel_jobs = std::max(std::max(wxThread::GetCPUCount(), 4), m_options.max_parallel_jobs);
+  for (i = 1; static_cast<int>(i) <= max_parallel_jobs; ++i)
+    cob_max_parallel_jobs->Append(wxString::Format(wxT("%d"), static_cast<int>(i)));
+
+  cb_one_job_per_output_volume = new wxCheckBox(this, ID_CB_ONE_JOB_PER_OUTPUT_VOLUME, Z("Run at most one job per output drive"));
+  cb_one_job_per_output_volume->SetToolTip(TIP("If several jobs are run at the same time then a job is only started if no other job "
+                                               "is currently writing to the same drive. This avoids the slowdown caused by several "
+                                               "processes writing to one hard disk at the same time."));
+
   // Set the defaults.
 
   select_priority(m_options.priority);
+  cob_max_parallel_jobs->SetValue(wxString::Format(wxT("%d"), m_options.max_parallel_jobs));
+  cb_one_job_per_output_volume->SetValue(m_options.one_job_per_output_volume);
 
   // Create the layout.
 
@@ -91,9 +109,16 @@ optdlg_mkvmerge_tab::optdlg_mkvmerge_tab(wxWindow *parent,
 
   siz_fg->Add(st_priority, 0, wxALIGN_CENTER_VERTICAL, 0);
   siz_fg->Add(cob_priority, 0, wxALIGN_CENTER_VERTICAL | wxLEFT, 5);
+  siz_fg->AddSpacer(0);
+
+  siz_fg->Add(st_max_parallel_jobs, 0, wxALIGN_CENTER_VERTICAL, 0);
+  siz_fg->Add(cob_max_parallel_jobs, 0, wxALIGN_CENTER_VERTICAL | wxTOP | wxLEFT, 5);
+  siz_fg->AddSpacer(0);
 
   siz_all->Add(siz_fg, 0, wxGROW | wxLEFT | wxRIGHT, 5);
   siz_all->AddSpacer(5);
+  siz_all->Add(cb_one_job_per_output_volume, 0, wxLEFT, 5);
+  siz_all->AddSpacer(5);
 
   SetSizer(siz_all);
 }
@@ -135,6 +160,12 @@ void
 optdlg_mkvmerge_tab::save_options() {
   m_options.mkvmerge = tc_mkvmerge->GetValue();
   m_options.priority = get_selected_priority();
+
+  long max_parallel_jobs = 1;
+  cob_max_parallel_jobs->GetValue().ToLong(&max_parallel_jobs);
+
+  m_options.max_parallel_jobs         = std::max<long>(max_parallel_jobs, 1);
+  m_options.one_job_per_output_volume = cb_one_job_per_output_volume->IsChecked();
 }
 
 wxString
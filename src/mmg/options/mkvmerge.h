@@ -21,16 +21,19 @@
 
 #include "mmg/options/tab_base.h"
 
-#define ID_TC_MKVMERGE      15000
-#define ID_B_BROWSEMKVMERGE 15001
-#define ID_COB_PRIORITY     15002
+#define ID_TC_MKVMERGE                  15000
+#define ID_B_BROWSEMKVMERGE             15001
+#define ID_COB_PRIORITY                 15002
+#define ID_COB_MAX_PARALLEL_JOBS        15003
+#define ID_CB_ONE_JOB_PER_OUTPUT_VOLUME 15004
 
 class optdlg_mkvmerge_tab: public optdlg_base_tab {
   DECLARE_CLASS(optdlg_mkvmerge_tab);
   DECLARE_EVENT_TABLE();
 protected:
   wxTextCtrl *tc_mkvmerge;
-  wxMTX_COMBOBOX_TYPE *cob_priority;
+  wxMTX_COMBOBOX_TYPE *cob_priority, *cob_max_parallel_jobs;
+  wxCheckBox *cb_one_job_per_output_volume;
 
 public:                         // Static
   static translation_table_c cob_priority_translations;
@@ -100,6 +100,18 @@ public:
       return m_buf[i - bbw];
   }
 
+  //Returns a pointer to the i-th byte and the number of bytes that are
+  //stored contiguously from there on.
+  const binary* GetContiguous(uint32_t i, uint32_t& length){
+    uint32_t bbw = bytes_before_wrap_read();
+    if(i < bbw){
+      length = (bbw < bytes_in_buf ? bbw : bytes_in_buf) - i;
+      return read_ptr + i;
+    }
+    length = bytes_in_buf - i;
+    return m_buf + (i - bbw);
+  }
+
   int32_t Read(binary* dest, uint32_t numBytes);
   int32_t Skip(uint32_t numBytes);
   int32_t Write(binary* data, uint32_t numBytes);
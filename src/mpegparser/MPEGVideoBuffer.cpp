@@ -20,6 +20,7 @@
 
  **/
 
+#include "common/start_code.h"
 #include "MPEGVideoBuffer.h"
 #include <cstring>
 #include <stddef.h>
@@ -36,6 +37,16 @@ MPEG2PictureHeader::MPEG2PictureHeader() {
   memset(this, 0, sizeof(*this));
 }
 
+static inline bool IsWantedStartCode(binary code){
+  switch(code){
+    case MPEG_VIDEO_SEQUENCE_START_CODE:
+    case MPEG_VIDEO_GOP_START_CODE:
+    case MPEG_VIDEO_PICTURE_START_CODE:
+      return true;
+  }
+  return false;
+}
+
 int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
   //How many bytes can we look through?
   uint32_t window = myBuffer->GetLength() - startPos;
@@ -43,23 +54,37 @@ int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
   if(window < 4) //Make sure we have enough bytes to search.
     return -1;
 
-  for(unsigned int i = startPos; i < (window - 3); i++){
-    CircBuffer& buf = *myBuffer;
-    binary a,b,c,d;
-    a = buf[i];
-    b = buf[i+1];
-    c = buf[i+2];
-    d = buf[i+3];
-    if((a == 0x00) && (b == 0x00) && (c == 0x01)){
-      switch(d){
-        case MPEG_VIDEO_SEQUENCE_START_CODE:
-        case MPEG_VIDEO_GOP_START_CODE:
-        case MPEG_VIDEO_PICTURE_START_CODE:
-          return i;  //Return our position if we found
-          //one of the codes we want
+  CircBuffer& buf = *myBuffer;
+  uint32_t end = window - 3;
+  uint32_t i = startPos;
 
-      }
+  while(i < end){
+    uint32_t length;
+    const binary* data = buf.GetContiguous(i, length);
+    //Only look at start codes beginning before 'end'.
+    uint32_t scan = end + 2 - i;
+    if(length < scan)
+      scan = length;
+
+    if(scan < 3){
+      //This start code would cross the buffer's wrap-around.
+      if((buf[i] == 0x00) && (buf[i+1] == 0x00) && (buf[i+2] == 0x01) && IsWantedStartCode(buf[i+3]))
+        return i;
+      i++;
+      continue;
+    }
+
+    uint32_t found = find_start_code(data, scan);
+    if(found == scan){
+      i += scan - 2;
+      continue;
     }
+
+    i += found;
+    if(IsWantedStartCode(buf[i+3]))
+      return i;  //Return our position if we found
+                 //one of the codes we want
+    i += 3;
   }
 
   //If we get here we have no _wanted_ start code found.
@@ -50,7 +50,7 @@ aac_packetizer_c::aac_packetizer_c(generic_reader_c *p_reader,
 aac_packetizer_c::~aac_packetizer_c() {
 }
 
-unsigned char *
+memory_cptr
 aac_packetizer_c::get_aac_packet(aac_header_t *aacheader) {
   unsigned char *packet_buffer = m_byte_buffer.get_buffer();
   int size                     = m_byte_buffer.get_size();
@@ -61,23 +61,24 @@ aac_packetizer_c::get_aac_packet(aac_header_t *aacheader) {
       m_bytes_skipped += size - 10;
       m_byte_buffer.remove(size - 10);
     }
-    return NULL;
+    return memory_cptr(NULL);
   }
   if ((pos + aacheader->bytes) > size)
-    return NULL;
+    return memory_cptr(NULL);
 
   m_bytes_skipped += pos;
   if (verbose && (0 < m_bytes_skipped))
     mxwarn_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Skipping %1% bytes (no valid AAC header found). This might cause audio/video desynchronisation.\n")) % m_bytes_skipped);
   m_bytes_skipped = 0;
 
-  unsigned char *buf;
+  memory_cptr mem;
   if ((aacheader->header_bit_size % 8) == 0)
-    buf = (unsigned char *)safememdup(packet_buffer + pos + aacheader->header_byte_size, aacheader->data_byte_size);
+    mem = m_byte_buffer.slice(pos + aacheader->header_byte_size, aacheader->data_byte_size);
   else {
     // Header is not byte aligned, i.e. MPEG-4 ADTS
     // This code is from mpeg4ip/server/mp4creator/aac.cpp
-    buf = (unsigned char *)safemalloc(aacheader->data_byte_size);
+    mem                = memory_c::alloc(aacheader->data_byte_size);
+    unsigned char *buf = mem->get_buffer();
 
     int up_shift       = aacheader->header_bit_size % 8;
     int down_shift     = 8 - up_shift;
@@ -93,7 +94,7 @@ aac_packetizer_c::get_aac_packet(aac_header_t *aacheader) {
 
   m_byte_buffer.remove(pos + aacheader->bytes);
 
-  return buf;
+  return mem;
 }
 
 void
@@ -179,12 +180,12 @@ aac_packetizer_c::process(packet_cptr packet) {
   if (m_headerless)
     return process_headerless(packet);
 
-  unsigned char *aac_packet;
+  memory_cptr aac_packet;
   aac_header_t aacheader;
 
-  m_byte_buffer.add(packet->data->get_buffer(), packet->data->get_size());
-  while ((aac_packet = get_aac_packet(&aacheader)) != NULL) {
-    add_packet(new packet_t(new memory_c(aac_packet, aacheader.data_byte_size, true), -1 == packet->timecode ? m_packetno * m_s2tc : packet->timecode, m_single_packet_duration));
+  m_byte_buffer.add(packet->data);
+  while ((aac_packet = get_aac_packet(&aacheader)).is_set()) {
+    add_packet(new packet_t(aac_packet, -1 == packet->timecode ? m_packetno * m_s2tc : packet->timecode, m_single_packet_duration));
     m_packetno++;
   }
 
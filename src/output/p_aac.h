@@ -17,7 +17,7 @@
 #include "common/common_pch.h"
 
 #include "common/aac.h"
-#include "common/byte_buffer.h"
+#include "common/frame_reassembler.h"
 #include "common/samples_timecode_conv.h"
 #include "merge/pr_generic.h"
 
@@ -27,7 +27,7 @@ private:
   int64_t m_bytes_skipped;
   int m_samples_per_sec, m_channels, m_id, m_profile;
   bool m_headerless, m_emphasis_present;
-  byte_buffer_c m_byte_buffer;
+  frame_reassembler_c m_byte_buffer;
   samples_to_timecode_converter_c m_s2tc;
   int64_t m_single_packet_duration;
 
@@ -45,7 +45,7 @@ public:
   virtual connection_result_e can_connect_to(generic_packetizer_c *src, std::string &error_message);
 
 private:
-  virtual unsigned char *get_aac_packet(aac_header_t *aacheader);
+  virtual memory_cptr get_aac_packet(aac_header_t *aacheader);
   virtual int process_headerless(packet_cptr packet);
 };
 
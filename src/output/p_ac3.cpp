@@ -51,23 +51,22 @@ ac3_packetizer_c::~ac3_packetizer_c() {
 }
 
 void
-ac3_packetizer_c::add_to_buffer(unsigned char *buf,
-                                int size) {
-  m_byte_buffer.add(buf, size);
+ac3_packetizer_c::add_to_buffer(memory_cptr &buf) {
+  m_byte_buffer.add(buf);
 }
 
-unsigned char *
+memory_cptr
 ac3_packetizer_c::get_ac3_packet(ac3_header_t *ac3header) {
   unsigned char *packet_buffer = m_byte_buffer.get_buffer();
   size_t size                  = m_byte_buffer.get_size();
 
   if (NULL == packet_buffer)
-    return NULL;
+    return memory_cptr(NULL);
 
   int pos = find_ac3_header(packet_buffer, size, ac3header, m_first_packet || m_first_ac3_header.has_dependent_frames);
 
   if ((0 > pos) || (static_cast<size_t>(pos + ac3header->bytes) > size))
-    return NULL;
+    return memory_cptr(NULL);
 
   m_bytes_skipped += pos;
   if (0 < m_bytes_skipped) {
@@ -92,17 +91,10 @@ ac3_packetizer_c::get_ac3_packet(ac3_header_t *ac3header) {
                                  "The audio/video synchronization may have been lost.\n")) % m_bytes_skipped);
 
     m_byte_buffer.remove(pos);
-    packet_buffer   = m_byte_buffer.get_buffer();
-    size            = m_byte_buffer.get_size();
-    pos             = 0;
     m_bytes_skipped = 0;
   }
 
-  unsigned char *buf = (unsigned char *)safememdup(packet_buffer, ac3header->bytes);
-
-  m_byte_buffer.remove(ac3header->bytes);
-
-  return buf;
+  return m_byte_buffer.get_frame(ac3header->bytes);
 }
 
 void
@@ -125,11 +117,11 @@ ac3_packetizer_c::set_headers() {
 
 int
 ac3_packetizer_c::process(packet_cptr packet) {
-  unsigned char *ac3_packet;
+  memory_cptr ac3_packet;
   ac3_header_t ac3header;
 
-  add_to_buffer(packet->data->get_buffer(), packet->data->get_size());
-  while ((ac3_packet = get_ac3_packet(&ac3header)) != NULL) {
+  add_to_buffer(packet->data);
+  while ((ac3_packet = get_ac3_packet(&ac3header)).is_set()) {
     adjust_header_values(ac3header);
 
     int64_t new_timecode;
@@ -148,7 +140,7 @@ ac3_packetizer_c::process(packet_cptr packet) {
     } else
       new_timecode = m_packetno * m_s2tc;
 
-    add_packet(new packet_t(new memory_c(ac3_packet, ac3header.bytes, true), new_timecode, m_single_packet_duration));
+    add_packet(new packet_t(ac3_packet, new_timecode, m_single_packet_duration));
     m_packetno++;
   }
 
@@ -203,8 +195,10 @@ ac3_bs_packetizer_c::ac3_bs_packetizer_c(generic_reader_c *p_reader,
 static bool s_warning_printed = false;
 
 void
-ac3_bs_packetizer_c::add_to_buffer(unsigned char *buf,
-                                   int size) {
+ac3_bs_packetizer_c::add_to_buffer(memory_cptr &buf) {
+  unsigned char *sptr = buf->get_buffer();
+  int size            = buf->get_size();
+
   if (((size % 2) == 1) && !s_warning_printed) {
     mxwarn(Y("ac3_bs_packetizer::add_to_buffer(): Untested code ('size' is odd). "
              "If mkvmerge crashes or if the resulting file does not contain the complete and correct audio track, "
@@ -218,10 +212,10 @@ ac3_bs_packetizer_c::add_to_buffer(unsigned char *buf,
 
   if (m_bsb_present) {
     size_add = 1;
-    sendptr  = buf + size + 1;
+    sendptr  = sptr + size + 1;
   } else {
     size_add = 0;
-    sendptr  = buf + size;
+    sendptr  = sptr + size;
   }
 
   size_add += size;
@@ -231,9 +225,8 @@ ac3_bs_packetizer_c::add_to_buffer(unsigned char *buf,
     new_bsb_present = true;
   }
 
-  unsigned char *new_buffer = (unsigned char *)safemalloc(size_add);
-  unsigned char *dptr       = new_buffer;
-  unsigned char *sptr       = buf;
+  memory_cptr new_buffer = memory_c::alloc(size_add);
+  unsigned char *dptr    = new_buffer->get_buffer();
 
   if (m_bsb_present) {
     dptr[1]  = m_bsb;
@@ -254,7 +247,5 @@ ac3_bs_packetizer_c::add_to_buffer(unsigned char *buf,
 
   m_bsb_present = new_bsb_present;
 
-  m_byte_buffer.add(new_buffer, size_add);
-
-  safefree(new_buffer);
+  m_byte_buffer.add(new_buffer);
 }
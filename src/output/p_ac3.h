@@ -17,7 +17,7 @@
 #include "common/common_pch.h"
 
 #include "common/ac3.h"
-#include "common/byte_buffer.h"
+#include "common/frame_reassembler.h"
 #include "common/samples_timecode_conv.h"
 #include "merge/pr_generic.h"
 
@@ -25,7 +25,7 @@ class ac3_packetizer_c: public generic_packetizer_c {
 protected:
   int64_t m_bytes_output, m_packetno, m_bytes_skipped, m_last_timecode, m_num_packets_same_tc;
   int m_samples_per_sec;
-  byte_buffer_c m_byte_buffer;
+  frame_reassembler_c m_byte_buffer;
   bool m_first_packet;
   ac3_header_t m_first_ac3_header;
   samples_to_timecode_converter_c m_s2tc;
@@ -45,8 +45,8 @@ public:
   virtual connection_result_e can_connect_to(generic_packetizer_c *src, std::string &error_message);
 
 protected:
-  virtual unsigned char *get_ac3_packet(ac3_header_t *ac3header);
-  virtual void add_to_buffer(unsigned char *buf, int size);
+  virtual memory_cptr get_ac3_packet(ac3_header_t *ac3header);
+  virtual void add_to_buffer(memory_cptr &buf);
   virtual void adjust_header_values(ac3_header_t &ac3_header);
 };
 
@@ -59,7 +59,7 @@ public:
   ac3_bs_packetizer_c(generic_reader_c *p_reader, track_info_c &p_ti, unsigned long samples_per_sec, int channels, int bsid);
 
 protected:
-  virtual void add_to_buffer(unsigned char *buf, int size);
+  virtual void add_to_buffer(memory_cptr &buf);
 };
 
 #endif // __P_AC3_H
@@ -29,7 +29,6 @@ dts_packetizer_c::dts_packetizer_c(generic_reader_c *p_reader,
   : generic_packetizer_c(p_reader, p_ti)
   , m_samples_written(0)
   , m_bytes_written(0)
-  , m_packet_buffer(128 * 1024)
   , m_get_first_header_later(get_first_header_later)
   , m_first_header(dtsheader)
   , m_previous_header(dtsheader)
@@ -42,10 +41,10 @@ dts_packetizer_c::dts_packetizer_c(generic_reader_c *p_reader,
 dts_packetizer_c::~dts_packetizer_c() {
 }
 
-unsigned char *
+memory_cptr
 dts_packetizer_c::get_dts_packet(dts_header_t &dtsheader) {
   if (0 == m_packet_buffer.get_size())
-    return NULL;
+    return memory_cptr(NULL);
 
   const unsigned char *buf = m_packet_buffer.get_buffer();
   int buf_size             = m_packet_buffer.get_size();
@@ -54,7 +53,7 @@ dts_packetizer_c::get_dts_packet(dts_header_t &dtsheader) {
   if (0 > pos) {
     if (4 < buf_size)
       m_packet_buffer.remove(buf_size - 4);
-    return NULL;
+    return memory_cptr(NULL);
   }
 
   if (0 < pos) {
@@ -66,7 +65,7 @@ dts_packetizer_c::get_dts_packet(dts_header_t &dtsheader) {
   pos = find_dts_header(buf, buf_size, &dtsheader, m_get_first_header_later ? false : !m_first_header.dts_hd);
 
   if ((0 > pos) || (static_cast<int>(pos + dtsheader.frame_byte_size) > buf_size))
-    return NULL;
+    return memory_cptr(NULL);
 
   if (m_get_first_header_later) {
     m_first_header           = dtsheader;
@@ -99,11 +98,9 @@ dts_packetizer_c::get_dts_packet(dts_header_t &dtsheader) {
       mxwarn_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Skipping %1% bytes (no valid DTS header found). This might cause audio/video desynchronisation.\n")) % pos);
   }
 
-  unsigned char *packet_buf = (unsigned char *)safememdup(buf + pos, dtsheader.frame_byte_size);
+  m_packet_buffer.remove(pos);
 
-  m_packet_buffer.remove(pos + dtsheader.frame_byte_size);
-
-  return packet_buf;
+  return m_packet_buffer.get_frame(dtsheader.frame_byte_size);
 }
 
 void
@@ -127,10 +124,10 @@ dts_packetizer_c::process(packet_cptr packet) {
     m_available_timecodes.push_back(packet->timecode);
 
   dts_header_t dtsheader;
-  unsigned char *dts_packet;
+  memory_cptr dts_packet;
 
-  m_packet_buffer.add(packet->data->get_buffer(), packet->data->get_size());
-  while ((dts_packet = get_dts_packet(dtsheader)) != NULL) {
+  m_packet_buffer.add(packet->data);
+  while ((dts_packet = get_dts_packet(dtsheader)).is_set()) {
     int64_t new_timecode;
     if (!m_available_timecodes.empty()) {
       m_samples_written = 0;
@@ -140,7 +137,7 @@ dts_packetizer_c::process(packet_cptr packet) {
     } else
       new_timecode = static_cast<int64_t>(m_samples_written * 1000000000.0 / static_cast<double>(dtsheader.core_sampling_frequency));
 
-    add_packet(new packet_t(new memory_c(dts_packet, dtsheader.frame_byte_size, true), new_timecode, (int64_t)get_dts_packet_length_in_nanoseconds(&dtsheader)));
+    add_packet(new packet_t(dts_packet, new_timecode, (int64_t)get_dts_packet_length_in_nanoseconds(&dtsheader)));
 
     m_bytes_written   += dtsheader.frame_byte_size;
     m_samples_written += get_dts_packet_length_in_core_samples(&dtsheader);
@@ -17,15 +17,15 @@
 
 #include "common/common_pch.h"
 
-#include "common/byte_buffer.h"
 #include "common/dts.h"
+#include "common/frame_reassembler.h"
 #include "merge/pr_generic.h"
 
 class dts_packetizer_c: public generic_packetizer_c {
 private:
   int64_t m_samples_written, m_bytes_written;
 
-  byte_buffer_c m_packet_buffer;
+  frame_reassembler_c m_packet_buffer;
 
   bool m_get_first_header_later;
   dts_header_t m_first_header, m_previous_header;
@@ -50,7 +50,7 @@ public:
   virtual connection_result_e can_connect_to(generic_packetizer_c *src, std::string &error_message);
 
 private:
-  virtual unsigned char *get_dts_packet(dts_header_t &dts_header);
+  virtual memory_cptr get_dts_packet(dts_header_t &dts_header);
 };
 
 #endif // __P_DTS_H
@@ -32,7 +32,6 @@ mp3_packetizer_c::mp3_packetizer_c(generic_reader_c *p_reader,
   , m_samples_per_sec(samples_per_sec)
   , m_channels(channels)
   , m_samples_per_frame(1152)
-  , m_byte_buffer(128 * 1024)
   , m_codec_id_set(false)
   , m_valid_headers_found(source_is_good)
   , m_previous_timecode(0)
@@ -70,10 +69,10 @@ mp3_packetizer_c::handle_garbage(int64_t bytes) {
                                "The audio/video synchronization may have been lost.\n")) % bytes);
 }
 
-unsigned char *
+memory_cptr
 mp3_packetizer_c::get_mp3_packet(mp3_header_t *mp3header) {
   if (m_byte_buffer.get_size() == 0)
-    return 0;
+    return memory_cptr(NULL);
 
   int pos;
   size_t size;
@@ -85,12 +84,12 @@ mp3_packetizer_c::get_mp3_packet(mp3_header_t *mp3header) {
     pos  = find_mp3_header(buf, size);
 
     if (0 > pos)
-      return NULL;
+      return memory_cptr(NULL);
 
     decode_mp3_header(&buf[pos], mp3header);
 
     if ((pos + mp3header->framesize) > size)
-      return NULL;
+      return memory_cptr(NULL);
 
     if (!mp3header->is_tag)
       break;
@@ -108,7 +107,7 @@ mp3_packetizer_c::get_mp3_packet(mp3_header_t *mp3header) {
   if (!m_valid_headers_found) {
     pos = find_consecutive_mp3_headers(m_byte_buffer.get_buffer(), m_byte_buffer.get_size(), 5);
     if (0 > pos)
-      return NULL;
+      return memory_cptr(NULL);
 
     // Great, we have found five consecutive identical headers. Be happy
     // with those!
@@ -152,13 +151,9 @@ mp3_packetizer_c::get_mp3_packet(mp3_header_t *mp3header) {
     rerender_track_headers();
 
   if (mp3header->framesize > m_byte_buffer.get_size())
-    return NULL;
+    return memory_cptr(NULL);
 
-  buf = (unsigned char *)safememdup(m_byte_buffer.get_buffer(), mp3header->framesize);
-
-  m_byte_buffer.remove(mp3header->framesize);
-
-  return buf;
+  return m_byte_buffer.get_frame(mp3header->framesize);
 }
 
 void
@@ -175,11 +170,11 @@ mp3_packetizer_c::set_headers() {
 
 int
 mp3_packetizer_c::process(packet_cptr packet) {
-  unsigned char *mp3_packet;
+  memory_cptr mp3_packet;
   mp3_header_t mp3header;
 
-  m_byte_buffer.add(packet->data->get_buffer(), packet->data->get_size());
-  while ((mp3_packet = get_mp3_packet(&mp3header)) != NULL) {
+  m_byte_buffer.add(packet->data);
+  while ((mp3_packet = get_mp3_packet(&mp3header)).is_set()) {
     bool timecode_valid =  (-1 != packet->timecode)
                         && (   (0 == m_packetno)
                             || (packet->timecode != m_previous_timecode));
@@ -195,7 +190,7 @@ mp3_packetizer_c::process(packet_cptr packet) {
       ++m_num_packets_since_previous_timecode;
     }
 
-    add_packet(new packet_t(new memory_c(mp3_packet, mp3header.framesize, true), new_timecode, m_single_packet_duration));
+    add_packet(new packet_t(mp3_packet, new_timecode, m_single_packet_duration));
     m_packetno++;
   }
 
@@ -16,7 +16,7 @@
 
 #include "common/common_pch.h"
 
-#include "common/byte_buffer.h"
+#include "common/frame_reassembler.h"
 #include "common/mp3.h"
 #include "common/samples_timecode_conv.h"
 #include "merge/pr_generic.h"
@@ -25,7 +25,7 @@ class mp3_packetizer_c: public generic_packetizer_c {
 private:
   int64_t m_bytes_output, m_packetno, m_bytes_skipped;
   int m_samples_per_sec, m_channels, m_samples_per_frame;
-  byte_buffer_c m_byte_buffer;
+  frame_reassembler_c m_byte_buffer;
   bool m_codec_id_set, m_valid_headers_found;
   int64_t m_previous_timecode, m_num_packets_since_previous_timecode;
   samples_to_timecode_converter_c m_s2tc;
@@ -44,7 +44,7 @@ public:
   virtual connection_result_e can_connect_to(generic_packetizer_c *src, std::string &error_message);
 
 private:
-  virtual unsigned char *get_mp3_packet(mp3_header_t *mp3header);
+  virtual memory_cptr get_mp3_packet(mp3_header_t *mp3header);
 
   virtual void handle_garbage(int64_t bytes);
 };
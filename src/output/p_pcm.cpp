@@ -82,7 +82,26 @@ pcm_packetizer_c::set_headers() {
 
 int
 pcm_packetizer_c::process(packet_cptr packet) {
-  m_buffer.add(packet->data->get_buffer(), packet->data->get_size());
+  size_t size   = packet->data->get_size();
+  size_t offset = 0;
+
+  // If the reader didn't start at the beginning of the file then the
+  // samples have to be counted from the first packet's timecode.
+  if ((0 < m_ti.m_start_at) && (0 == m_samples_output) && (0 == m_buffer.get_size()) && (0 < packet->timecode))
+    m_samples_output = packet->timecode * m_samples_per_sec / 1000000000ll;
+
+  // Pass complete packets on without copying them as long as no data from
+  // earlier calls is still waiting in the buffer.
+  if (0 == m_buffer.get_size()) {
+    while ((size - offset) >= m_packet_size) {
+      add_packet(new packet_t(packet->data->slice(offset, m_packet_size), m_samples_output * m_s2tc, m_samples_per_packet * m_s2tc));
+
+      offset           += m_packet_size;
+      m_samples_output += m_samples_per_packet;
+    }
+  }
+
+  m_buffer.add(packet->data->get_buffer() + offset, size - offset);
 
   while (m_buffer.get_size() >= m_packet_size) {
     add_packet(new packet_t(clone_memory(m_buffer.get_buffer(), m_packet_size), m_samples_output * m_s2tc, m_samples_per_packet * m_s2tc));
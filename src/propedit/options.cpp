@@ -11,24 +11,43 @@
 #include "common/os.h"
 
 #include <cassert>
+#include <set>
+#include <boost/filesystem.hpp>
 #include <boost/range/algorithm.hpp>
 
 #include <matroska/KaxChapters.h>
 #include <matroska/KaxTag.h>
 #include <matroska/KaxTags.h>
 
+#include "common/strings/editing.h"
+#include "common/strings/parsing.h"
 #include "propedit/options.h"
 #include "propedit/propedit.h"
 
+namespace bfs = boost::filesystem;
+
 options_c::options_c()
   : m_show_progress(false)
   , m_parse_mode(kax_analyzer_c::parse_mode_fast)
+  , m_jobs(0)
 {
 }
 
+options_c::~options_c() {
+  // The level 1 elements have been read from the file by
+  // find_elements(). Several targets may share one of them.
+  std::set<EbmlMaster *> level1_elements;
+  for (auto &target : m_targets)
+    if (NULL != target->m_level1_element)
+      level1_elements.insert(target->m_level1_element);
+
+  for (auto &level1_element : level1_elements)
+    delete level1_element;
+}
+
 void
 options_c::validate() {
-  if (m_file_name.empty())
+  if (m_file_names.empty())
     mxerror(Y("No file name given.\n"));
 
   if (!has_changes())
@@ -83,12 +102,54 @@ options_c::add_chapters(const std::string &spec) {
   m_targets.push_back(target);
 }
 
+/** \brief Adds a file name or all file names matching a pattern
+
+   Not all shells expand wildcards. Therefore file names containing
+   '*' or '?' that do not exist are treated as patterns. Only the last
+   part of the path may contain wildcards.
+*/
 void
 options_c::set_file_name(const std::string &file_name) {
-  if (!m_file_name.empty())
-    mxerror(boost::format(Y("More than one file name has been given ('%1%' and '%2%').\n")) % m_file_name % file_name);
+  if ((std::string::npos == file_name.find_first_of("*?")) || bfs::exists(bfs::path(file_name))) {
+    m_file_names.push_back(file_name);
+    return;
+  }
+
+  bfs::path pattern(file_name);
+  bfs::path directory = pattern.branch_path();
+  std::string regex   = "^";
+
+  for (auto c : bfs::basename(pattern) + bfs::extension(pattern)) {
+    if ('*' == c)
+      regex += ".*";
+    else if ('?' == c)
+      regex += ".";
+    else if (std::string::npos != std::string("\\^$.|+()[]{}").find(c))
+      regex += std::string("\\") + c;
+    else
+      regex += c;
+  }
 
-  m_file_name = file_name;
+  boost::regex file_name_re(regex + "$", boost::regex::perl);
+  std::vector<std::string> matching_file_names;
+
+  try {
+    bfs::directory_iterator end_itr;
+    for (bfs::directory_iterator itr(directory.empty() ? bfs::path(".") : directory); itr != end_itr; ++itr)
+      if (   !bfs::is_directory(itr->status())
+          && boost::regex_match(bfs::basename(itr->path()) + bfs::extension(itr->path()), file_name_re))
+        matching_file_names.push_back((directory / (bfs::basename(itr->path()) + bfs::extension(itr->path()))).string());
+  } catch (bfs::filesystem_error &) {
+  }
+
+  // Let the file name fail later on if nothing matches.
+  if (matching_file_names.empty()) {
+    m_file_names.push_back(file_name);
+    return;
+  }
+
+  std::sort(matching_file_names.begin(), matching_file_names.end());
+  m_file_names.insert(m_file_names.end(), matching_file_names.begin(), matching_file_names.end());
 }
 
 void
@@ -103,17 +164,61 @@ options_c::set_parse_mode(const std::string &parse_mode) {
     throw false;
 }
 
+void
+options_c::set_jobs(const std::string &jobs) {
+  if (!parse_int(jobs, m_jobs) || (1 > m_jobs))
+    throw false;
+}
+
+/** \brief Whether or not several files are processed at once
+
+   mkvpropedit processes the files in a pool of worker threads and
+   reports the results for each file afterwards in batch mode.
+*/
+bool
+options_c::is_batch()
+  const
+{
+  return (1 < m_file_names.size()) || (0 < m_jobs) || !m_summary_file_name.empty();
+}
+
+/** \brief Creates the options for processing a single file in batch mode
+
+   The targets and their changes are copied as they hold the elements
+   found in the file.
+*/
+options_cptr
+options_c::clone_for_file(const std::string &file_name)
+  const
+{
+  options_cptr clone(new options_c);
+
+  clone->m_file_name     = file_name;
+  clone->m_show_progress = false;
+  clone->m_parse_mode    = m_parse_mode;
+  clone->m_file_names.push_back(file_name);
+
+  for (auto &target : m_targets)
+    clone->m_targets.push_back(target->clone());
+
+  return clone;
+}
+
 void
 options_c::dump_info()
   const
 {
   mxinfo(boost::format("options:\n"
-                       "  file_name:     %1%\n"
+                       "  file_names:    %1%\n"
                        "  show_progress: %2%\n"
-                       "  parse_mode:    %3%\n")
-         % m_file_name
+                       "  parse_mode:    %3%\n"
+                       "  jobs:          %4%\n"
+                       "  summary_file:  %5%\n")
+         % join(", ", m_file_names)
          % m_show_progress
-         % static_cast<int>(m_parse_mode));
+         % static_cast<int>(m_parse_mode)
+         % m_jobs
+         % m_summary_file_name);
 
   for (auto &target : m_targets)
     target->dump_info();
@@ -220,4 +325,7 @@ void
 options_c::options_parsed() {
   remove_empty_targets();
   m_show_progress = 1 < verbose;
+
+  if (1 == m_file_names.size())
+    m_file_name = m_file_names[0];
 }
@@ -21,15 +21,21 @@
 #include "common/kax_analyzer.h"
 #include "propedit/target.h"
 
+class options_c;
+typedef counted_ptr<options_c> options_cptr;
+
 class options_c {
 public:
-  std::string m_file_name;
+  std::string m_file_name, m_summary_file_name;
+  std::vector<std::string> m_file_names;
   std::vector<target_cptr> m_targets;
   bool m_show_progress;
   kax_analyzer_c::parse_mode_e m_parse_mode;
+  int m_jobs;
 
 public:
   options_c();
+  ~options_c();
 
   void validate();
   void options_parsed();
@@ -40,6 +46,9 @@ public:
   void add_chapters(const std::string &spec);
   void set_file_name(const std::string &file_name);
   void set_parse_mode(const std::string &parse_mode);
+  void set_jobs(const std::string &jobs);
+  bool is_batch() const;
+  options_cptr clone_for_file(const std::string &file_name) const;
   void dump_info() const;
   bool has_changes() const;
 
@@ -52,6 +61,5 @@ protected:
   void remove_empty_targets();
   void merge_targets();
 };
-typedef counted_ptr<options_c> options_cptr;
 
 #endif // __PROPEDIT_OPTIONS_H
@@ -16,6 +16,8 @@
 #include <matroska/KaxTracks.h>
 
 #include "common/command_line.h"
+#include "common/strings/editing.h"
+#include "common/thread_pool.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
 #include "propedit/propedit_cli_parser.h"
@@ -77,7 +79,7 @@ write_changes(options_cptr &options,
 }
 
 static void
-run(options_cptr &options) {
+process_file(options_cptr &options) {
   console_kax_analyzer_cptr analyzer;
 
   try {
@@ -85,6 +87,8 @@ run(options_cptr &options) {
       mxerror(boost::format("The file '%1%' is not a Matroska file or it could not be found.\n") % options->m_file_name);
 
     analyzer = console_kax_analyzer_cptr(new console_kax_analyzer_c(options->m_file_name));
+  } catch (mtx::mxerror_x &) {
+    throw;
   } catch (...) {
     mxerror(boost::format("The file '%1%' could not be opened for read/write access.\n") % options->m_file_name);
   }
@@ -111,10 +115,104 @@ run(options_cptr &options) {
   write_changes(options, analyzer.get_object());
 
   mxinfo(Y("Done.\n"));
+}
+
+static void
+run(options_cptr &options) {
+  process_file(options);
 
   mxexit(0);
 }
 
+/* Processes a single file in batch mode. Errors are kept instead of
+   terminating the program so that the remaining files are still
+   processed.
+*/
+class propedit_task_c: public thread_pool_task_c {
+public:
+  std::string m_file_name, m_error;
+
+protected:
+  options_cptr m_options;
+
+public:
+  propedit_task_c(const options_cptr &options)
+    : m_file_name(options->m_file_name)
+    , m_options(options)
+  {
+  }
+
+protected:
+  virtual void run() {
+    set_thread_mxerror_throws(true);
+    set_thread_info_suppressed(true);
+
+    try {
+      process_file(m_options);
+    } catch (mtx::mxerror_x &error) {
+      m_error = error.what();
+    } catch (std::exception &error) {
+      m_error = error.what();
+    }
+
+    strip(m_error, true);
+
+    // Release the elements read from the file right away.
+    m_options = options_cptr();
+  }
+};
+typedef counted_ptr<propedit_task_c> propedit_task_cptr;
+
+static void
+run_batch(options_cptr &options) {
+  mm_io_cptr summary;
+  if (!options->m_summary_file_name.empty()) {
+    try {
+      summary = mm_io_cptr(new mm_file_io_c(options->m_summary_file_name, MODE_CREATE));
+    } catch (mtx::mm_io::exception &) {
+      mxerror(boost::format(Y("The file '%1%' could not be opened for writing.\n")) % options->m_summary_file_name);
+    }
+  }
+
+  std::vector<propedit_task_cptr> tasks;
+  for (auto &file_name : options->m_file_names)
+    tasks.push_back(propedit_task_cptr(new propedit_task_c(options->clone_for_file(file_name))));
+
+  size_t num_threads = 0 < options->m_jobs ? options->m_jobs : thread_pool_c::get_num_cores();
+  thread_pool_c pool(std::min(num_threads, tasks.size()));
+
+  for (auto &task : tasks)
+    pool.add(*task);
+
+  size_t num_failed = 0;
+
+  for (auto &task : tasks) {
+    task->wait();
+
+    if (task->m_error.empty())
+      mxinfo_fn(task->m_file_name, Y("Done.\n"));
+
+    else {
+      mxmsg(MXMSG_ERROR, boost::format(Y("'%1%': %2%\n")) % task->m_file_name % task->m_error);
+      ++num_failed;
+    }
+
+    // One line per file: the status, the file name and the error
+    // message, all separated by tabs.
+    if (summary.is_set()) {
+      std::string error = task->m_error;
+      ba::replace_all(error, "\n", " ");
+      summary->puts(boost::format("%1%\t%2%\t%3%\n") % (error.empty() ? "ok" : "error") % task->m_file_name % error);
+    }
+  }
+
+  summary = mm_io_cptr();
+
+  mxinfo(boost::format(Y("%1% of %2% files have been modified successfully.\n")) % (tasks.size() - num_failed) % tasks.size());
+
+  mxexit(0 < num_failed ? 2 : -1);
+}
+
 static
 void setup() {
   mtx_common_init();
@@ -140,7 +238,10 @@ main(int argc,
     options->dump_info();
   }
 
-  run(options);
+  if (options->is_batch())
+    run_batch(options);
+  else
+    run(options);
 
   mxexit();
 }
@@ -43,6 +43,23 @@ propedit_cli_parser_c::set_parse_mode() {
   }
 }
 
+void
+propedit_cli_parser_c::set_jobs() {
+  try {
+    m_options->set_jobs(m_next_arg);
+  } catch (...) {
+    mxerror(boost::format(Y("Invalid number of threads in '%1% %2%'.\n")) % m_current_arg % m_next_arg);
+  }
+}
+
+void
+propedit_cli_parser_c::set_summary_file_name() {
+  if (m_next_arg.empty())
+    mxerror(boost::format(Y("Invalid file name in '%1% %2%'.\n")) % m_current_arg % m_next_arg);
+
+  m_options->m_summary_file_name = m_next_arg;
+}
+
 void
 propedit_cli_parser_c::add_target() {
   try {
@@ -151,12 +168,16 @@ propedit_cli_parser_c::set_file_name() {
 
 void
 propedit_cli_parser_c::init_parser() {
-  add_information(YT("mkvpropedit [options] <file> <actions>"));
+  add_information(YT("mkvpropedit [options] <file> [<file> ...] <actions>"));
 
   add_section_header(YT("Options"));
   OPT("l|list-property-names",      list_property_names, YT("List all valid property names and exit"));
   OPT("p|parse-mode=<mode>",        set_parse_mode,      YT("Sets the Matroska parser mode to 'fast' (default) or 'full'"));
 
+  add_section_header(YT("Processing several files"));
+  OPT("j|jobs=<n>",                 set_jobs,            YT("Process up to n files at the same time (default: the number of CPU cores)"));
+  OPT("summary=<filename>",         set_summary_file_name, YT("Write the result for each file to 'filename'"));
+
   add_section_header(YT("Actions"));
   OPT("e|edit=<selector>",          add_target,          YT("Sets the Matroska file section that all following add/set/delete "
                                                             "actions operate on (see below and man page for syntax)"));
@@ -175,6 +196,8 @@ propedit_cli_parser_c::init_parser() {
 
   add_separator();
   add_information(YT("The order of the various options is not important."));
+  add_information(YT("If several files are given then all actions are applied to each of them. File names containing the wildcards '*' or '?' "
+                     "are expanded if no such file exists."));
 
   add_section_header(YT("Edit selectors"), 0);
   add_section_header(YT("Segment information"), 1);
@@ -37,6 +37,8 @@ protected:
   void add_tags();
   void add_chapters();
   void set_parse_mode();
+  void set_jobs();
+  void set_summary_file_name();
   void set_file_name();
 
   void list_property_names();
@@ -51,6 +51,24 @@ target_c::target_c(target_c::target_type_e type)
 {
 }
 
+/** \brief Copies the target and its changes
+
+   Only the parsed edit specification is of interest. The copy is
+   meant to be used before any elements have been looked up.
+*/
+target_cptr
+target_c::clone()
+  const
+{
+  target_cptr copy(new target_c(*this));
+
+  copy->m_changes.clear();
+  for (auto &change : m_changes)
+    copy->m_changes.push_back(change_cptr(new change_c(*change)));
+
+  return copy;
+}
+
 void
 target_c::validate() {
   assert(target_c::tt_undefined != m_type);
@@ -23,6 +23,9 @@
 
 using namespace libebml;
 
+class target_c;
+typedef counted_ptr<target_c> target_cptr;
+
 class target_c {
 public:
   enum target_type_e {
@@ -66,6 +69,7 @@ public:
 public:
   target_c(target_type_e type);
 
+  target_cptr clone() const;
   void validate();
 
   void add_change(change_c::change_type_e type, const std::string &spec);
@@ -95,6 +99,5 @@ protected:
   void parse_chapters_spec(const std::string &spec);
   void add_or_replace_chapters();
 };
-typedef counted_ptr<target_c> target_cptr;
 
 #endif // __PROPEDIT_TARGET_H
@@ -0,0 +1,38 @@
+#!/usr/bin/env ruby
+
+# Measures how many packets per second mkvmerge muxes depending on the
+# number of tracks. The input file is added to the command line several
+# times so that the number of tracks doubles in each round.
+#
+# Usage: benchmark_packet_scheduler.rb <path to mkvmerge> <input file> [max number of copies]
+
+require "tmpdir"
+
+def error_and_exit(text, exit_code = 2)
+  puts text
+  exit exit_code
+end
+
+error_and_exit "Usage: #{$0} <path to mkvmerge> <input file> [max number of copies]" if ARGV.size < 2
+
+mkvmerge   = ARGV[0]
+input_file = ARGV[1]
+max_copies = (ARGV[2] || 64).to_i
+output     = "#{Dir.tmpdir}/benchmark_packet_scheduler_#{$$}.mkv"
+
+puts "copies packetizers    packets      polls   duration  packets/s"
+
+copies = 1
+while copies <= max_copies
+  command = ([ mkvmerge, "--debug", "packet_scheduler", "-o", output ] + [ input_file ] * copies).collect { |arg| "'#{arg}'" }.join(" ")
+  result  = `#{command} 2>&1`[/packet_scheduler:(.*)/, 1]
+
+  error_and_exit "mkvmerge failed:\n#{command}" if result.nil?
+
+  values = result.scan(/\d+/)
+  printf("%6d %11d %10d %10d %8dms %10d\n", copies, *values)
+
+  copies *= 2
+end
+
+File.unlink output if File.exist? output
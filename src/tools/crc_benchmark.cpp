@@ -0,0 +1,117 @@
+/*
+   crc_benchmark - Compares the speed of the CRC implementations.
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   verifies that all CRC implementations agree and measures their speed
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/checksums.h"
+#include "common/command_line.h"
+#include "common/fs_sys_helpers.h"
+#include "common/memory.h"
+#include "common/random.h"
+#include "common/strings/parsing.h"
+#include "common/version.h"
+
+static const struct {
+  crc_implementation_e implementation;
+  const char *name;
+} s_implementations[] = {
+  { CRC_IMPLEMENTATION_BYTEWISE,      "byte-wise"     },
+  { CRC_IMPLEMENTATION_SLICING_BY_8,  "slicing-by-8"  },
+  { CRC_IMPLEMENTATION_HARDWARE,      "hardware"      },
+};
+
+static const size_t s_num_implementations = sizeof(s_implementations) / sizeof(s_implementations[0]);
+
+void
+set_usage() {
+  usage_text = Y(
+    "crc_benchmark [size in MB]\n"
+    "\n"
+    "  Verifies that all CRC implementations calculate the same results and\n"
+    "  measures how fast they calculate CRC-32 checksums over a buffer of\n"
+    "  random data (default size: 64 MB).\n"
+    );
+
+  version_info = get_version_info("crc_benchmark", vif_full);
+}
+
+static void
+verify(const unsigned char *buffer,
+       size_t size) {
+  static const size_t s_lengths[] = { 0, 1, 7, 8, 15, 16, 63, 64, 65, 127, 128, 1000, 4096, 65537 };
+
+  int crc_type;
+  for (crc_type = 0; CRC_MAX > crc_type; ++crc_type) {
+    const uint32_t *table = crc_get_table(static_cast<crc_type_e>(crc_type));
+
+    for (auto length : s_lengths) {
+      size_t offset;
+      for (offset = 0; (4 > offset) && ((offset + length) <= size); ++offset) {
+        uint32_t expected = crc_calc(CRC_IMPLEMENTATION_BYTEWISE, table, 0xffffffff, buffer + offset, length);
+
+        size_t i;
+        for (i = 1; s_num_implementations > i; ++i) {
+          uint32_t actual = crc_calc(s_implementations[i].implementation, table, 0xffffffff, buffer + offset, length);
+          if (actual != expected)
+            mxerror(boost::format(Y("The %1% implementation calculated 0x%|2$08x| instead of 0x%|3$08x| for CRC type %4%, offset %5% and length %6%.\n"))
+                    % s_implementations[i].name % actual % expected % crc_type % offset % length);
+        }
+      }
+    }
+  }
+
+  mxinfo(Y("All implementations calculate the same results.\n"));
+}
+
+static void
+benchmark(const unsigned char *buffer,
+          size_t size) {
+  const uint32_t *table = crc_get_table(CRC_32_IEEE_LE);
+
+  size_t i;
+  for (i = 0; s_num_implementations > i; ++i) {
+    if (!crc_implementation_available(s_implementations[i].implementation)) {
+      mxinfo(boost::format(Y("%|1$-13s| not supported on this CPU\n")) % s_implementations[i].name);
+      continue;
+    }
+
+    int64_t start = get_current_time_millis();
+    uint32_t crc  = crc_calc(s_implementations[i].implementation, table, 0xffffffff, buffer, size);
+    int64_t end   = get_current_time_millis();
+
+    mxinfo(boost::format(Y("%|1$-13s| %|2$6d| ms %|3$8.1f| MB/s (CRC 0x%|4$08x|)\n"))
+           % s_implementations[i].name % (end - start) % (static_cast<double>(size) / 1024 / 1024 * 1000 / std::max<int64_t>(end - start, 1)) % (crc ^ 0xffffffff));
+  }
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init();
+  set_usage();
+
+  std::vector<std::string> args = command_line_utf8(argc, argv);
+  handle_common_cli_args(args, "");
+
+  int size_mb = 64;
+  if ((1 < args.size()) || ((1 == args.size()) && (!parse_int(args[0], size_mb) || (1 > size_mb))))
+    usage(2);
+
+  size_t size = static_cast<size_t>(size_mb) * 1024 * 1024;
+  memory_cptr buffer(memory_c::alloc(size));
+  random_c::generate_bytes(buffer->get_buffer(), size);
+
+  verify(buffer->get_buffer(), size);
+  benchmark(buffer->get_buffer(), size);
+
+  mxexit(0);
+}
@@ -0,0 +1,33 @@
+#!/usr/bin/ruby -w
+
+class T_322identification_cache < Test
+  def description
+    "mkvmerge / identification cache"
+  end
+
+  def identify(home, options)
+    output = tmp_name
+    sys "HOME=#{home} ../src/mkvmerge --identify-verbose #{options} data/mkv/complex.mkv > #{output} 2> /dev/null"
+    hash_file output
+  end
+
+  def run
+    home = tmp_name
+    Dir.mkdir home
+    Dir.mkdir "#{home}/.mkvtoolnix"
+
+    begin
+      expected = identify home, ""
+
+      error "Storing the result changed the output"    if identify(home, "--identification-cache")         != expected
+      error "No entry was stored in the cache"         if Dir.entries("#{home}/.mkvtoolnix/identification-cache").size != 3
+      error "The cached result is different"           if identify(home, "--identification-cache")         != expected
+      error "Refreshing the entry changed the output"  if identify(home, "--refresh-identification-cache") != expected
+      error "Refreshing added another entry"           if Dir.entries("#{home}/.mkvtoolnix/identification-cache").size != 3
+    ensure
+      system "rm -rf #{home}"
+    end
+
+    "ok"
+  end
+end
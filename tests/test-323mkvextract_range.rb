@@ -0,0 +1,31 @@
+#!/usr/bin/ruby -w
+
+class T_323mkvextract_range < Test
+  def description
+    "mkvextract / extracting a timecode range with --range"
+  end
+
+  def timecodes(range)
+    output = tmp_name
+    sys "../src/mkvextract timecodes_v2 data/mkv/complex.mkv --range #{range} 1:#{output}"
+    IO.readlines(output).reject { |line| /^#/.match(line) }.collect(&:to_f)
+  end
+
+  def run
+    all_timecodes = timecodes "00:00:00.000-10:00:00.000"
+    error "The range covering the whole file did not extract all timecodes" if all_timecodes != timecodes("00:00:00.000-")
+
+    range_timecodes = timecodes "00:00:10.500-00:00:20.000"
+    error "Nothing was extracted for the range"                 if range_timecodes.empty?
+    error "The extraction did not start at or before the range" if range_timecodes.first > 10500
+    error "The extraction did not stop before the range's end"  if range_timecodes.last >= 20000
+    error "The timecodes are not a part of the whole file's"    if (all_timecodes & range_timecodes) != range_timecodes
+
+    xtr_tracks "data/mkv/complex.mkv", "1:#{tmp}"
+    expected = hash_tmp
+    xtr_tracks "data/mkv/complex.mkv", "--range 00:00:00.000-10:00:00.000 1:#{tmp}"
+    error "The track's content differs for the range covering the whole file" if hash_tmp != expected
+
+    "ok"
+  end
+end
@@ -0,0 +1,37 @@
+#!/usr/bin/ruby -w
+
+class T_324start_at < Test
+  def description
+    "mkvmerge / starting to read a file at a timecode with --start-at"
+  end
+
+  def timecodes(file_name, track_id)
+    output = tmp_name
+    sys "../src/mkvextract timecodes_v2 #{file_name} #{track_id}:#{output}"
+    IO.readlines(output).reject { |line| /^#/.match(line) }.collect(&:to_f)
+  end
+
+  def run
+    full = tmp_name
+    merge full, "data/mkv/complex.mkv"
+    merge "--start-at 00:00:10.500 data/mkv/complex.mkv"
+
+    error "The output is not smaller than the full file's" if File.size(tmp) >= File.size(full)
+
+    (1..3).each do |track_id|
+      all_timecodes   = timecodes full, track_id
+      start_timecodes = timecodes tmp,  track_id
+
+      error "Track #{track_id}: nothing was read"                         if start_timecodes.empty?
+      error "Track #{track_id}: reading did not start at or before 10.5s" if start_timecodes.first > 10500
+
+      # The PCM packetizer calculates the timecodes from the first
+      # packet's timecode which has been rounded to the timecode scale.
+      all_timecodes[-start_timecodes.size..-1].zip(start_timecodes).each do |expected, actual|
+        error "Track #{track_id}: the timecodes are not the end of the full file's" if (expected - actual).abs > 1
+      end
+    end
+
+    "ok"
+  end
+end
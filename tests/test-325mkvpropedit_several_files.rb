@@ -0,0 +1,29 @@
+#!/usr/bin/ruby -w
+
+class T_325mkvpropedit_several_files < Test
+  def description
+    "mkvpropedit / applying the same changes to several files"
+  end
+
+  def run
+    files   = (1..3).collect { tmp_name }
+    missing = tmp_name
+    summary = tmp_name
+
+    files.each { |file| sys "cp data/mkv/complex.mkv #{file}" }
+    original = hash_file files[0]
+
+    sys "../src/mkvpropedit #{files[0]} --edit info --set title=Batch --edit track:a1 --set language=ger"
+    expected = hash_file files[0]
+    error "The single file was not modified" if expected == original
+
+    sys "../src/mkvpropedit --jobs 2 --summary #{summary} #{files[1]} #{missing} #{files[2]} --edit info --set title=Batch --edit track:a1 --set language=ger", 2
+
+    error "The files were not modified the same way as the single file" if (hash_file(files[1]) != expected) || (hash_file(files[2]) != expected)
+
+    results = IO.readlines(summary).collect { |line| line.chomp.split(/\t/)[0..1] }
+    error "The summary is wrong" if results != [ [ "ok", files[1] ], [ "error", missing ], [ "ok", files[2] ] ]
+
+    "ok"
+  end
+end
@@ -0,0 +1,51 @@
+#!/usr/bin/ruby -w
+
+class T_326cues < Test
+  def description
+    "mkvmerge / cue entries refer to the clusters containing their blocks"
+  end
+
+  def run
+    merge "data/mkv/complex.mkv"
+
+    info = tmp_name
+    sys "../src/mkvinfo -v -v #{tmp} > #{info}"
+
+    in_segment, data_start, clusters, cues = false, nil, {}, []
+    cluster_pos = nil
+
+    IO.readlines(info).each do |line|
+      if /^\+ Segment/.match(line)
+        in_segment = true
+      elsif in_segment && data_start.nil? && /^\|\+ .* at (\d+)/.match(line)
+        data_start = $1.to_i
+      end
+
+      if /^\|\+ Cluster at (\d+)/.match(line)
+        cluster_pos = $1.to_i
+      elsif cluster_pos && /^\| \+ Cluster timecode: ([\d.]+)s/.match(line)
+        clusters[cluster_pos] = $1.to_f
+        cluster_pos           = nil
+      elsif /^\|  \+ Cue time: ([\d.]+)s/.match(line)
+        cues << [ $1.to_f ]
+      elsif /^\|   \+ Cue cluster position: (\d+)/.match(line)
+        cues.last << $1.to_i
+      end
+    end
+
+    error "No cue entries were written" if cues.empty?
+
+    cluster_timecodes = clusters.values.sort
+    cues.each do |timecode, position|
+      cluster_timecode = clusters[data_start + position]
+      error "The cue entry for #{timecode}s does not refer to a cluster" if cluster_timecode.nil?
+
+      next_timecode = cluster_timecodes.detect { |t| t > cluster_timecode }
+      error "The cue entry for #{timecode}s refers to the wrong cluster" if (timecode < cluster_timecode) || (next_timecode && (timecode >= next_timecode))
+    end
+
+    error "The cue entries are not sorted by their timecodes" if cues.collect(&:first) != cues.collect(&:first).sort
+
+    "ok"
+  end
+end
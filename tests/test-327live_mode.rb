@@ -0,0 +1,36 @@
+#!/usr/bin/ruby -w
+
+class T_327live_mode < Test
+  def description
+    "mkvmerge / live mode and writing to stdout"
+  end
+
+  def extract(file_name, track_id)
+    output = tmp_name
+    sys "../src/mkvextract tracks #{file_name} --no-variable-data #{track_id}:#{output}"
+    content = hash_file output
+
+    sys "../src/mkvextract timecodes_v2 #{file_name} #{track_id}:#{output}"
+    content + "-" + hash_file(output)
+  end
+
+  def run
+    normal, live, stdout = tmp_name, tmp_name, tmp_name
+
+    merge normal, "data/mkv/complex.mkv"
+    merge live,   "--live data/mkv/complex.mkv"
+    sys "../src/mkvmerge --engage no_variable_data -o - data/mkv/complex.mkv > #{stdout} 2> /dev/null"
+
+    error "Writing to stdout differs from '--live'" if hash_file(stdout) != hash_file(live)
+
+    info = tmp_name
+    sys "../src/mkvinfo #{live} > #{info}"
+    error "The segment size is not unknown" unless IO.readlines(info).any? { |line| /^\+ Segment, size unknown/.match(line) }
+
+    (1..3).each do |track_id|
+      error "Track #{track_id} differs from the one in the normal file" if extract(live, track_id) != extract(normal, track_id)
+    end
+
+    "ok"
+  end
+end
@@ -0,0 +1,41 @@
+#!/usr/bin/ruby -w
+
+class T_328additional_output < Test
+  def description
+    "mkvmerge / writing additional output files with --additional-output"
+  end
+
+  def extract(file_name, track_id)
+    output = tmp_name
+    sys "../src/mkvextract tracks #{file_name} --no-variable-data #{track_id}:#{output}"
+    content = hash_file output
+
+    sys "../src/mkvextract timecodes_v2 #{file_name} #{track_id}:#{output}"
+    content + "-" + hash_file(output)
+  end
+
+  def track_ids(file_name)
+    output = tmp_name
+    sys "../src/mkvmerge --identify #{file_name} > #{output}"
+    IO.readlines(output).collect { |line| /^Track ID (\d+):/.match(line) ? $1.to_i : nil }.compact
+  end
+
+  def run
+    normal, main, all_tracks, some_tracks = tmp_name, tmp_name, tmp_name, tmp_name
+
+    merge normal, "data/mkv/complex.mkv"
+    merge main,   "--additional-output #{all_tracks} --additional-output #{some_tracks} --additional-output-tracks 0:1,0:3 data/mkv/complex.mkv"
+
+    error "The main file differs from the one written without additional files" if hash_file(main) != hash_file(normal)
+    error "The additional file with all tracks lacks tracks"                     if track_ids(all_tracks)  != track_ids(main)
+    error "The additional file with some tracks contains the wrong tracks"       if track_ids(some_tracks) != [ 1, 3 ]
+
+    [ 1, 2, 3 ].each do |track_id|
+      expected = extract main, track_id
+      error "Track #{track_id} differs in the additional file with all tracks"  if extract(all_tracks,  track_id) != expected
+      error "Track #{track_id} differs in the additional file with some tracks" if (2 != track_id) && (extract(some_tracks, track_id) != expected)
+    end
+
+    "ok"
+  end
+end
@@ -0,0 +1,23 @@
+#!/usr/bin/ruby -w
+
+class T_329mkvinfo_jobs < Test
+  def description
+    "mkvinfo / summary mode with several threads"
+  end
+
+  def summary(jobs)
+    output = tmp_name
+    sys "../src/mkvinfo -s #{jobs} data/mkv/complex.mkv > #{output}"
+    hash_file output
+  end
+
+  def run
+    expected = summary "--jobs 1"
+
+    error "The output with two threads is different"                   if summary("--jobs 2") != expected
+    error "The output with eight threads is different"                 if summary("--jobs 8") != expected
+    error "The output with the default number of threads is different" if summary("")         != expected
+
+    "ok"
+  end
+end
@@ -0,0 +1,89 @@
+#!/usr/bin/ruby -w
+
+class T_330mp4_fragmented < Test
+  SAMPLE_RATE        = 8000
+  SAMPLES_PER_FRAME  = 800
+  FRAMES_PER_FRAGMENT = 10
+
+  def description
+    "mkvmerge / fragmented MP4 files"
+  end
+
+  def box(type, payload)
+    [ 8 + payload.size ].pack("N") + type + payload
+  end
+
+  def full_box(type, version, flags, payload)
+    box type, [ (version << 24) | flags ].pack("N") + payload
+  end
+
+  def matrix
+    [ 0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000 ].pack("N9")
+  end
+
+  # Two tracks with 16 bit mono PCM. The sample tables in 'moov' are
+  # empty, all samples are described by the 'trex' defaults.
+  def movie_header
+    mvhd = full_box "mvhd", 0, 0, [ 0, 0, 1000, 0, 0x10000, 0x100 ].pack("N4Nn") + "\0" * 10 + matrix + "\0" * 24 + [ 3 ].pack("N")
+    traks, trexs = "", ""
+
+    [ 1, 2 ].each do |track_id|
+      tkhd   = full_box "tkhd", 0, 7, [ 0, 0, track_id, 0, 0 ].pack("N5") + "\0" * 8 + [ 0, 0, 0x100, 0 ].pack("n4") + matrix + [ 0, 0 ].pack("N2")
+      mdhd   = full_box "mdhd", 0, 0, [ 0, 0, SAMPLE_RATE, 0, 0x55c4, 0 ].pack("N4n2")
+      hdlr   = full_box "hdlr", 0, 0, [ 0 ].pack("N") + "soun" + "\0" * 12 + "snd\0"
+      sowt   = box "sowt", "\0" * 6 + [ 1, 0, 0, 0, 1, 16, 0, 0, SAMPLE_RATE << 16 ].pack("n3Nn4N")
+      stbl   = box "stbl", full_box("stsd", 0, 0, [ 1 ].pack("N") + sowt) + full_box("stts", 0, 0, [ 0 ].pack("N")) + full_box("stsc", 0, 0, [ 0 ].pack("N")) +
+                           full_box("stsz", 0, 0, [ 0, 0 ].pack("N2")) + full_box("stco", 0, 0, [ 0 ].pack("N"))
+      minf   = box "minf", full_box("smhd", 0, 0, "\0" * 4) + stbl
+      traks << box("trak", tkhd + box("mdia", mdhd + hdlr + minf))
+      trexs << full_box("trex", 0, 0, [ track_id, 1, SAMPLES_PER_FRAME, SAMPLES_PER_FRAME * 2, 0 ].pack("N5"))
+    end
+
+    box "moov", mvhd + traks + box("mvex", trexs)
+  end
+
+  # One 'moof' with a 'traf' per track followed by the 'mdat' with the
+  # samples. The data offsets are relative to the 'moof'.
+  def fragment(sequence_number, decode_time)
+    data = ""
+    [ 1, 2 ].each do |track_id|
+      data << (0...(FRAMES_PER_FRAGMENT * SAMPLES_PER_FRAME)).collect { |idx| (track_id * 1000 + (decode_time + idx) % 3000) & 0x7fff }.pack("v*")
+    end
+
+    moof_size = 0
+    2.times do
+      trafs = [ 1, 2 ].collect do |track_id|
+        offset = moof_size + 8 + (track_id - 1) * FRAMES_PER_FRAGMENT * SAMPLES_PER_FRAME * 2
+        box "traf", full_box("tfhd", 0, 0x020000, [ track_id ].pack("N")) + full_box("tfdt", 0, 0, [ decode_time ].pack("N")) +
+                    full_box("trun", 0, 0x000001, [ FRAMES_PER_FRAGMENT, offset ].pack("NN"))
+      end.join("")
+      @moof     = box "moof", full_box("mfhd", 0, 0, [ sequence_number ].pack("N")) + trafs
+      moof_size = @moof.size
+    end
+
+    @moof + box("mdat", data)
+  end
+
+  def write_file(file_name, fragment_order)
+    content = box("ftyp", "iso5" + [ 0 ].pack("N") + "iso5") + movie_header
+    fragment_order.each_with_index { |fragment_idx, idx| content << fragment(idx + 1, fragment_idx * FRAMES_PER_FRAGMENT * SAMPLES_PER_FRAME) }
+    File.open(file_name, "wb") { |file| file.write content }
+  end
+
+  def run
+    src = tmp_name
+    write_file src, (0..4).to_a
+
+    merge "#{src}"
+    result = hash_tmp
+    merge "--mp4-read-buffer 0 #{src}"
+    error "Reading without the fetch buffer gives a different result" if hash_tmp != result
+
+    # Fragments that aren't stored in the order of their timecodes
+    # cause a warning.
+    write_file src, [ 0, 1, 3, 2, 4 ]
+    merge "#{src}", 1
+
+    result
+  end
+end
@@ -0,0 +1,24 @@
+#!/usr/bin/ruby -w
+
+class T_331audio_frame_reassembly < Test
+  def description
+    "mkvmerge / reassembling AC3 and MP3 frames from raw streams and Matroska"
+  end
+
+  def run
+    [ "data/simple/v.ac3", "data/simple/v.mp3" ].each do |src|
+      from_raw, extracted, from_extracted, from_matroska = tmp_name, tmp_name, tmp_name, tmp_name
+
+      merge from_raw, src
+      xtr_tracks from_raw, "1:#{extracted}"
+      merge from_extracted, extracted
+      merge from_matroska,  from_raw
+
+      expected = hash_file from_raw
+      error "#{src}: muxing the extracted frames gives a different result" if hash_file(from_extracted) != expected
+      error "#{src}: remuxing the Matroska file gives a different result"  if hash_file(from_matroska)  != expected
+    end
+
+    "ok"
+  end
+end